@@ -23,29 +23,26 @@ public:
     }
 
     void registerClient(WebSocketServerProtocolPtr client) {
-        if (_clients.find(client) == _clients.end()) {
+        if (!_clients.contains(client.get())) {
             NET4CXX_LOG_INFO(gAppLog, "register client %s", client->getPeerName());
-            _clients.insert(client);
+            _clients.add(client);
         }
     }
 
     void unregisterClient(WebSocketServerProtocolPtr client) {
-        if (_clients.find(client) != _clients.end()) {
+        if (_clients.remove(client.get())) {
             NET4CXX_LOG_INFO(gAppLog, "unregister client %s", client->getPeerName());
-            _clients.erase(client);
         }
     }
 
     void broadcast(const std::string &msg) {
         NET4CXX_LOG_INFO(gAppLog, "broacasting message '%s' ..", msg);
-        for (auto c: _clients) {
-            c->sendMessage(msg);
-            NET4CXX_LOG_INFO(gAppLog, "message sent to %s", c->getPeerName());
-        }
+        size_t count = _clients.broadcast(msg);
+        NET4CXX_LOG_INFO(gAppLog, "message sent to %u clients", count);
     }
 protected:
     int _tickCount{0};
-    std::set<WebSocketServerProtocolPtr> _clients;
+    WebSocketBroadcastGroup _clients;
 };
 
 
@@ -0,0 +1,395 @@
+//
+// Created by yuwenyong on 19-2-17.
+//
+
+#include "net4cxx/common/compress/compressor.h"
+#include <algorithm>
+#include <mutex>
+#include <tuple>
+
+
+NS_BEGIN
+
+
+constexpr size_t Compressor::MIN_OUTPUT_SIZE;
+
+Compressor::Compressor(int level, int wbits, int memLevel, int strategy)
+        : _level(level)
+        , _wbits(wbits)
+        , _memLevel(memLevel)
+        , _strategy(strategy) {
+    _zst.zalloc = (alloc_func) NULL;
+    _zst.zfree = (free_func) Z_NULL;
+    _zst.opaque = Z_NULL;
+    _zst.next_in = NULL;
+    _zst.avail_in = 0;
+    int err = deflateInit2(&_zst, _level, Zlib::deflated, _wbits, _memLevel, _strategy);
+    if (err == Z_MEM_ERROR) {
+        NET4CXX_THROW_EXCEPTION(MemoryError, "Can't allocate memory for compression object");
+    } else if (err == Z_STREAM_ERROR) {
+        NET4CXX_THROW_EXCEPTION(ValueError, "Invalid initialization option");
+    } else if (err != Z_OK) {
+        Zlib::handleError(_zst, err, "while creating compression object");
+    }
+}
+
+Compressor::~Compressor() {
+    deflateEnd(&_zst);
+}
+
+void Compressor::reset() {
+    int err = deflateReset(&_zst);
+    if (err != Z_OK) {
+        Zlib::handleError(_zst, err, "while resetting compression object");
+    }
+    _finished = false;
+}
+
+size_t Compressor::deflateInto(Byte *out, size_t outLen, int flushMode, bool &more) {
+    _zst.next_out = (Bytef *)out;
+    _zst.avail_out = (unsigned int)outLen;
+    int err = deflate(&_zst, flushMode);
+    if (err == Z_STREAM_ERROR) {
+        Zlib::handleError(_zst, err, "while compressing data");
+    }
+    if (flushMode == Z_FINISH) {
+        _finished = err == Z_STREAM_END;
+        more = !_finished;
+    } else {
+        more = _zst.avail_out == 0 || _zst.avail_in != 0;
+    }
+    return outLen - _zst.avail_out;
+}
+
+
+Decompressor::Decompressor(int wbits)
+        : _wbits(wbits) {
+    _zst.zalloc = (alloc_func) NULL;
+    _zst.zfree = (free_func) Z_NULL;
+    _zst.opaque = Z_NULL;
+    _zst.next_in = NULL;
+    _zst.avail_in = 0;
+    int err = inflateInit2(&_zst, _wbits);
+    if (err == Z_STREAM_ERROR) {
+        NET4CXX_THROW_EXCEPTION(ValueError, "Invalid initialization option");
+    } else if (err == Z_MEM_ERROR) {
+        NET4CXX_THROW_EXCEPTION(MemoryError, "Can't allocate memory for decompression object");
+    } else if (err != Z_OK) {
+        Zlib::handleError(_zst, err, "while creating decompression object");
+    }
+}
+
+Decompressor::~Decompressor() {
+    inflateEnd(&_zst);
+}
+
+void Decompressor::reset() {
+    int err = inflateReset(&_zst);
+    if (err != Z_OK) {
+        Zlib::handleError(_zst, err, "while resetting decompression object");
+    }
+    _eof = false;
+    _unusedData.clear();
+    _unconsumedTail.clear();
+}
+
+size_t Decompressor::inflateInto(Byte *out, size_t outLen, int flushMode, bool &more) {
+    _zst.next_out = (Bytef *)out;
+    _zst.avail_out = (unsigned int)outLen;
+    int err = inflate(&_zst, flushMode);
+    if (err == Z_STREAM_END) {
+        _eof = true;
+    } else if (err != Z_OK && err != Z_BUF_ERROR) {
+        _zst.avail_in = 0;
+        _unconsumedTail.clear();
+        if (err == Z_MEM_ERROR) {
+            NET4CXX_THROW_EXCEPTION(MemoryError, "Out of memory while decompressing data");
+        }
+        Zlib::handleError(_zst, err, "while decompressing data");
+    }
+    more = !_eof && _zst.avail_out == 0;
+    return outLen - _zst.avail_out;
+}
+
+void Decompressor::saveUnconsumedInput() {
+    if (_eof && _zst.avail_in > 0) {
+        _unusedData.insert(_unusedData.end(), _zst.next_in, _zst.next_in + _zst.avail_in);
+        _zst.avail_in = 0;
+    }
+    // The input may point into the current tail, so copy it out before replacing
+    ByteArray tail(_zst.next_in, _zst.next_in + _zst.avail_in);
+    _unconsumedTail.swap(tail);
+    _zst.next_in = NULL;
+    _zst.avail_in = 0;
+}
+
+
+struct CompressorPool::Pools {
+    typedef std::tuple<int, int, int, int> CompressorKey;
+
+    Pools() {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        thread = nextThread()++;
+        registry().emplace_back(this);
+    }
+
+    ~Pools() {
+        destroyed = true;
+        std::lock_guard<std::mutex> lock(registryMutex());
+        auto &pools = registry();
+        pools.erase(std::remove(pools.begin(), pools.end(), this), pools.end());
+    }
+
+    // Only the owning thread writes the counters, other threads read them for the gauges
+    Stats getStats() const {
+        return {thread, contexts.load(std::memory_order_relaxed), idleContexts.load(std::memory_order_relaxed),
+                memory.load(std::memory_order_relaxed), idleMemory.load(std::memory_order_relaxed),
+                created.load(std::memory_order_relaxed), rejected.load(std::memory_order_relaxed)};
+    }
+
+    void add(std::atomic<size_t> &counter, size_t value) {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    void sub(std::atomic<size_t> &counter, size_t value) {
+        counter.store(counter.load(std::memory_order_relaxed) - value, std::memory_order_relaxed);
+    }
+
+    void onCreated(size_t bytes) {
+        add(contexts, 1);
+        add(memory, bytes);
+        add(created, 1);
+    }
+
+    void onIdle(size_t bytes) {
+        add(idleContexts, 1);
+        add(idleMemory, bytes);
+    }
+
+    void onReused(size_t bytes) {
+        sub(idleContexts, 1);
+        sub(idleMemory, bytes);
+    }
+
+    void onFreed(size_t bytes) {
+        sub(contexts, 1);
+        sub(memory, bytes);
+    }
+
+    static std::mutex& registryMutex() {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    static std::vector<Pools *>& registry() {
+        static std::vector<Pools *> pools;
+        return pools;
+    }
+
+    static size_t& nextThread() {
+        static size_t thread = 0;
+        return thread;
+    }
+
+    std::map<CompressorKey, std::vector<std::unique_ptr<Compressor>>> compressors;
+    std::map<int, std::vector<std::unique_ptr<Decompressor>>> decompressors;
+    size_t thread;
+    std::atomic<size_t> contexts{0};
+    std::atomic<size_t> idleContexts{0};
+    std::atomic<size_t> memory{0};
+    std::atomic<size_t> idleMemory{0};
+    std::atomic<size_t> created{0};
+    std::atomic<uint64_t> rejected{0};
+
+    static thread_local bool destroyed;
+};
+
+thread_local bool CompressorPool::Pools::destroyed = false;
+
+constexpr size_t CompressorPool::MAX_IDLE_CONTEXTS;
+
+std::atomic<size_t> CompressorPool::_memoryBudget{0};
+
+void CompressorPool::CompressorReleaser::operator()(Compressor *compressor) const {
+    std::unique_ptr<Compressor> owner(compressor);
+    auto pools = local();
+    if (!pools) {
+        return;
+    }
+    size_t bytes = getCompressorMemory(compressor->getWBits(), compressor->getMemLevel());
+    auto &idle = pools->compressors[std::make_tuple(compressor->getLevel(), compressor->getWBits(),
+                                                    compressor->getMemLevel(), compressor->getStrategy())];
+    if (idle.size() < MAX_IDLE_CONTEXTS) {
+        try {
+            compressor->reset();
+            idle.emplace_back(std::move(owner));
+            pools->onIdle(bytes);
+            return;
+        } catch (...) {
+
+        }
+    }
+    pools->onFreed(bytes);
+}
+
+void CompressorPool::DecompressorReleaser::operator()(Decompressor *decompressor) const {
+    std::unique_ptr<Decompressor> owner(decompressor);
+    auto pools = local();
+    if (!pools) {
+        return;
+    }
+    size_t bytes = getDecompressorMemory(decompressor->getWBits());
+    auto &idle = pools->decompressors[decompressor->getWBits()];
+    if (idle.size() < MAX_IDLE_CONTEXTS) {
+        try {
+            decompressor->reset();
+            idle.emplace_back(std::move(owner));
+            pools->onIdle(bytes);
+            return;
+        } catch (...) {
+
+        }
+    }
+    pools->onFreed(bytes);
+}
+
+CompressorPool::CompressorPtr CompressorPool::acquireCompressor(int level, int wbits, int memLevel, int strategy) {
+    auto pools = local();
+    if (pools) {
+        size_t bytes = getCompressorMemory(wbits, memLevel);
+        auto iter = pools->compressors.find(std::make_tuple(level, wbits, memLevel, strategy));
+        if (iter != pools->compressors.end() && !iter->second.empty()) {
+            CompressorPtr compressor(iter->second.back().release());
+            iter->second.pop_back();
+            pools->onReused(bytes);
+            return compressor;
+        }
+        evictIdle(pools, bytes);
+        CompressorPtr compressor(new Compressor(level, wbits, memLevel, strategy));
+        pools->onCreated(bytes);
+        return compressor;
+    }
+    return CompressorPtr(new Compressor(level, wbits, memLevel, strategy));
+}
+
+CompressorPool::CompressorPtr CompressorPool::tryAcquireCompressor(int level, int wbits, int memLevel, int strategy) {
+    auto pools = local();
+    if (pools) {
+        auto iter = pools->compressors.find(std::make_tuple(level, wbits, memLevel, strategy));
+        bool reusable = iter != pools->compressors.end() && !iter->second.empty();
+        if (!reusable && !hasMemoryFor(getCompressorMemory(wbits, memLevel))) {
+            pools->add(pools->rejected, 1);
+            return nullptr;
+        }
+    }
+    return acquireCompressor(level, wbits, memLevel, strategy);
+}
+
+CompressorPool::DecompressorPtr CompressorPool::acquireDecompressor(int wbits) {
+    auto pools = local();
+    if (pools) {
+        size_t bytes = getDecompressorMemory(wbits);
+        auto iter = pools->decompressors.find(wbits);
+        if (iter != pools->decompressors.end() && !iter->second.empty()) {
+            DecompressorPtr decompressor(iter->second.back().release());
+            iter->second.pop_back();
+            pools->onReused(bytes);
+            return decompressor;
+        }
+        evictIdle(pools, bytes);
+        DecompressorPtr decompressor(new Decompressor(wbits));
+        pools->onCreated(bytes);
+        return decompressor;
+    }
+    return DecompressorPtr(new Decompressor(wbits));
+}
+
+size_t CompressorPool::getIdleCount() {
+    auto pools = local();
+    return pools ? pools->idleContexts.load(std::memory_order_relaxed) : 0;
+}
+
+size_t CompressorPool::getCreatedCount() {
+    auto pools = local();
+    return pools ? pools->created.load(std::memory_order_relaxed) : 0;
+}
+
+size_t CompressorPool::getMemoryUsage() {
+    auto pools = local();
+    return pools ? pools->memory.load(std::memory_order_relaxed) : 0;
+}
+
+size_t CompressorPool::getIdleMemory() {
+    auto pools = local();
+    return pools ? pools->idleMemory.load(std::memory_order_relaxed) : 0;
+}
+
+bool CompressorPool::hasMemoryFor(size_t bytes) {
+    size_t budget = getMemoryBudget();
+    if (budget == 0) {
+        return true;
+    }
+    auto pools = local();
+    size_t inUse = pools ? pools->memory.load(std::memory_order_relaxed) -
+                           pools->idleMemory.load(std::memory_order_relaxed) : 0;
+    return inUse + bytes <= budget;
+}
+
+CompressorPool::Stats CompressorPool::getStats() {
+    auto pools = local();
+    return pools ? pools->getStats() : Stats{0, 0, 0, 0, 0, 0, 0};
+}
+
+std::vector<CompressorPool::Stats> CompressorPool::getAllStats() {
+    std::vector<Stats> stats;
+    std::lock_guard<std::mutex> lock(Pools::registryMutex());
+    for (auto pools: Pools::registry()) {
+        stats.emplace_back(pools->getStats());
+    }
+    return stats;
+}
+
+void CompressorPool::clear() {
+    auto pools = local();
+    if (pools) {
+        pools->compressors.clear();
+        pools->decompressors.clear();
+        pools->sub(pools->contexts, pools->idleContexts.load(std::memory_order_relaxed));
+        pools->sub(pools->memory, pools->idleMemory.load(std::memory_order_relaxed));
+        pools->idleContexts.store(0, std::memory_order_relaxed);
+        pools->idleMemory.store(0, std::memory_order_relaxed);
+    }
+}
+
+void CompressorPool::evictIdle(Pools *pools, size_t bytes) {
+    size_t budget = getMemoryBudget();
+    auto overBudget = [pools, bytes, budget]() {
+        return budget != 0 && pools->memory.load(std::memory_order_relaxed) + bytes > budget;
+    };
+    for (auto &kv: pools->compressors) {
+        size_t size = getCompressorMemory(std::get<1>(kv.first), std::get<2>(kv.first));
+        while (!kv.second.empty() && overBudget()) {
+            kv.second.pop_back();
+            pools->onReused(size);
+            pools->onFreed(size);
+        }
+    }
+    for (auto &kv: pools->decompressors) {
+        size_t size = getDecompressorMemory(kv.first);
+        while (!kv.second.empty() && overBudget()) {
+            kv.second.pop_back();
+            pools->onReused(size);
+            pools->onFreed(size);
+        }
+    }
+}
+
+CompressorPool::Pools* CompressorPool::local() {
+    if (Pools::destroyed) {
+        return nullptr;
+    }
+    static thread_local Pools pools;
+    return &pools;
+}
+
+NS_END
@@ -0,0 +1,290 @@
+//
+// Created by yuwenyong on 19-2-17.
+//
+
+#ifndef NET4CXX_COMMON_COMPRESS_COMPRESSOR_H
+#define NET4CXX_COMMON_COMPRESS_COMPRESSOR_H
+
+#include "net4cxx/common/common.h"
+#include "net4cxx/common/compress/zlib.h"
+#include <atomic>
+
+
+NS_BEGIN
+
+
+class NET4CXX_COMMON_API Compressor: public boost::noncopyable {
+public:
+    explicit Compressor(int level=Zlib::zDefaultCompression, int wbits=Zlib::maxWBits, int memLevel=Zlib::defMemLevel,
+                        int strategy=Zlib::zDefaultStrategy);
+
+    ~Compressor();
+
+    template <typename BufferT>
+    size_t compress(const Byte *data, size_t len, BufferT &out, int flushMode=Zlib::zNoFlush) {
+        if (_finished) {
+            NET4CXX_THROW_EXCEPTION(ZlibError, "Compress after stream finished");
+        }
+        _zst.next_in = (Bytef *)data;
+        _zst.avail_in = (unsigned int)len;
+        return drain(out, flushMode);
+    }
+
+    template <typename BufferT>
+    size_t compress(const ByteArray &data, BufferT &out, int flushMode=Zlib::zNoFlush) {
+        return compress(data.data(), data.size(), out, flushMode);
+    }
+
+    template <typename BufferT>
+    size_t compress(const std::string &data, BufferT &out, int flushMode=Zlib::zNoFlush) {
+        return compress((const Byte *)data.data(), data.size(), out, flushMode);
+    }
+
+    template <typename BufferT>
+    size_t flush(BufferT &out, int flushMode=Zlib::zFinish) {
+        if (flushMode == Zlib::zNoFlush || _finished) {
+            return 0;
+        }
+        _zst.next_in = nullptr;
+        _zst.avail_in = 0;
+        return drain(out, flushMode);
+    }
+
+    void reset();
+
+    bool finished() const {
+        return _finished;
+    }
+
+    size_t bound(size_t len) {
+        return (size_t)deflateBound(&_zst, (uLong)len);
+    }
+
+    int getLevel() const {
+        return _level;
+    }
+
+    int getWBits() const {
+        return _wbits;
+    }
+
+    int getMemLevel() const {
+        return _memLevel;
+    }
+
+    int getStrategy() const {
+        return _strategy;
+    }
+
+    static constexpr size_t MIN_OUTPUT_SIZE = 64;
+protected:
+    size_t deflateInto(Byte *out, size_t outLen, int flushMode, bool &more);
+
+    template <typename BufferT>
+    size_t drain(BufferT &out, int flushMode) {
+        size_t start = out.size();
+        size_t chunk = std::max(bound(_zst.avail_in), MIN_OUTPUT_SIZE);
+        bool more = true;
+        while (more) {
+            size_t pos = out.size();
+            out.resize(pos + chunk);
+            size_t produced = deflateInto((Byte *)&out[0] + pos, chunk, flushMode, more);
+            out.resize(pos + produced);
+            chunk <<= 1;
+        }
+        return out.size() - start;
+    }
+
+    int _level;
+    int _wbits;
+    int _memLevel;
+    int _strategy;
+    bool _finished{false};
+    z_stream _zst;
+};
+
+
+class NET4CXX_COMMON_API Decompressor: public boost::noncopyable {
+public:
+    explicit Decompressor(int wbits=Zlib::maxWBits);
+
+    ~Decompressor();
+
+    template <typename BufferT>
+    size_t decompress(const Byte *data, size_t len, BufferT &out, size_t maxLength=0) {
+        _zst.next_in = (Bytef *)data;
+        _zst.avail_in = (unsigned int)len;
+        size_t start = out.size();
+        size_t chunk = std::max(len << 2, (size_t)DEFAULTALLOC);
+        bool more = true;
+        while (more) {
+            size_t room = chunk;
+            if (maxLength != 0) {
+                size_t produced = out.size() - start;
+                if (produced == maxLength) {
+                    break;
+                }
+                room = std::min(room, maxLength - produced);
+            }
+            size_t pos = out.size();
+            out.resize(pos + room);
+            size_t produced = inflateInto((Byte *)&out[0] + pos, room, Z_SYNC_FLUSH, more);
+            out.resize(pos + produced);
+            chunk <<= 1;
+        }
+        saveUnconsumedInput();
+        return out.size() - start;
+    }
+
+    template <typename BufferT>
+    size_t decompress(const ByteArray &data, BufferT &out, size_t maxLength=0) {
+        return decompress(data.data(), data.size(), out, maxLength);
+    }
+
+    template <typename BufferT>
+    size_t decompress(const std::string &data, BufferT &out, size_t maxLength=0) {
+        return decompress((const Byte *)data.data(), data.size(), out, maxLength);
+    }
+
+    template <typename BufferT>
+    size_t flush(BufferT &out) {
+        ByteArray tail;
+        tail.swap(_unconsumedTail);
+        _zst.next_in = tail.data();
+        _zst.avail_in = (unsigned int)tail.size();
+        size_t start = out.size();
+        size_t chunk = std::max(tail.size() << 2, (size_t)DEFAULTALLOC);
+        bool more = !_eof;
+        while (more) {
+            size_t pos = out.size();
+            out.resize(pos + chunk);
+            size_t produced = inflateInto((Byte *)&out[0] + pos, chunk, Z_FINISH, more);
+            out.resize(pos + produced);
+            chunk <<= 1;
+        }
+        saveUnconsumedInput();
+        return out.size() - start;
+    }
+
+    void reset();
+
+    bool eof() const {
+        return _eof;
+    }
+
+    int getWBits() const {
+        return _wbits;
+    }
+
+    const ByteArray& getUnusedData() const {
+        return _unusedData;
+    }
+
+    const ByteArray& getUnconsumedTail() const {
+        return _unconsumedTail;
+    }
+protected:
+    size_t inflateInto(Byte *out, size_t outLen, int flushMode, bool &more);
+
+    void saveUnconsumedInput();
+
+    int _wbits;
+    bool _eof{false};
+    z_stream _zst;
+    ByteArray _unusedData;
+    ByteArray _unconsumedTail;
+};
+
+
+// Idle contexts are kept per thread, so each reactor reuses its own contexts without locking. The zlib state of a
+// context is accounted to the thread which created it, which is expected to be the one releasing it
+class NET4CXX_COMMON_API CompressorPool {
+public:
+    struct Stats {
+        size_t thread;
+        size_t contexts;
+        size_t idleContexts;
+        size_t memory;
+        size_t idleMemory;
+        size_t created;
+        uint64_t rejected;
+    };
+
+    struct NET4CXX_COMMON_API CompressorReleaser {
+        void operator()(Compressor *compressor) const;
+    };
+
+    struct NET4CXX_COMMON_API DecompressorReleaser {
+        void operator()(Decompressor *decompressor) const;
+    };
+
+    using CompressorPtr = std::unique_ptr<Compressor, CompressorReleaser>;
+    using DecompressorPtr = std::unique_ptr<Decompressor, DecompressorReleaser>;
+
+    static CompressorPtr acquireCompressor(int level=Zlib::zDefaultCompression, int wbits=Zlib::maxWBits,
+                                           int memLevel=Zlib::defMemLevel, int strategy=Zlib::zDefaultStrategy);
+
+    // Null when there is no idle context and creating one would exceed the memory budget even after dropping the
+    // idle ones
+    static CompressorPtr tryAcquireCompressor(int level=Zlib::zDefaultCompression, int wbits=Zlib::maxWBits,
+                                              int memLevel=Zlib::defMemLevel, int strategy=Zlib::zDefaultStrategy);
+
+    static DecompressorPtr acquireDecompressor(int wbits=Zlib::maxWBits);
+
+    static size_t getIdleCount();
+
+    static size_t getCreatedCount();
+
+    // Bytes of zlib state held by this thread's contexts, in use and idle
+    static size_t getMemoryUsage();
+
+    static size_t getIdleMemory();
+
+    // Whether contexts of the given size still fit in this thread's budget once the idle ones are dropped
+    static bool hasMemoryFor(size_t bytes);
+
+    static Stats getStats();
+
+    // One entry per thread which has used the pool
+    static std::vector<Stats> getAllStats();
+
+    // Applies to each thread separately, 0 means unlimited
+    static void setMemoryBudget(size_t memoryBudget) {
+        _memoryBudget.store(memoryBudget, std::memory_order_relaxed);
+    }
+
+    static size_t getMemoryBudget() {
+        return _memoryBudget.load(std::memory_order_relaxed);
+    }
+
+    static void clear();
+
+    // Estimates from zlib's documented memory requirements
+    static size_t getCompressorMemory(int wbits, int memLevel) {
+        return ((size_t)1 << (windowBits(wbits) + 2)) + ((size_t)1 << (memLevel + 9)) + 6 * 1024;
+    }
+
+    static size_t getDecompressorMemory(int wbits) {
+        return ((size_t)1 << windowBits(wbits)) + 7 * 1024;
+    }
+
+    static constexpr size_t MAX_IDLE_CONTEXTS = 8;
+protected:
+    struct Pools;
+
+    // Raw deflate, gzip and automatic header detection all encode the window size in the low four bits
+    static int windowBits(int wbits) {
+        int bits = std::abs(wbits) & 0x0f;
+        return bits >= 8 ? bits : Zlib::maxWBits;
+    }
+
+    static void evictIdle(Pools *pools, size_t bytes);
+
+    static Pools* local();
+
+    static std::atomic<size_t> _memoryBudget;
+};
+
+NS_END
+
+#endif //NET4CXX_COMMON_COMPRESS_COMPRESSOR_H
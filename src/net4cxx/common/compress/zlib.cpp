@@ -3,6 +3,7 @@
 //
 
 #include "net4cxx/common/compress/zlib.h"
+#include "net4cxx/common/compress/compressor.h"
 #include "net4cxx/common/debugging/assert.h"
 
 NS_BEGIN
@@ -56,160 +57,38 @@ NS_BEGIN
 
 
 ByteArray Zlib::compress(const Byte *data, size_t len, int level) {
-    z_stream zst;
-    zst.zalloc = (alloc_func)NULL;
-    zst.zfree = (free_func)Z_NULL;
-    zst.next_in = (Bytef *)data;
-    size_t oBufLen = DEFAULTALLOC;
+    auto compressor = CompressorPool::acquireCompressor(level);
     ByteArray retVal;
-    int err = deflateInit(&zst, level);
-    if (err != Z_OK) {
-        if (err == Z_MEM_ERROR) {
-            NET4CXX_THROW_EXCEPTION(MemoryError, "Out of memory while compressing data");
-        } else if (err == Z_STREAM_ERROR) {
-            NET4CXX_THROW_EXCEPTION(ZlibError, "Bad compression level");
-        } else {
-            deflateEnd(&zst);
-            handleError(zst, err, "while compressing data");
-        }
-    }
-    zst.avail_in = (unsigned int)len;
-    do {
-        ArrangeOutputBuffer(zst, retVal, oBufLen);
-        err = deflate(&zst, Z_FINISH);
-        if (err == Z_STREAM_ERROR) {
-            deflateEnd(&zst);
-            NET4CXX_THROW_EXCEPTION(ZlibError, "while compressing data");
-        }
-    } while (zst.avail_out == 0);
-    NET4CXX_ASSERT(zst.avail_in == 0);
-    NET4CXX_ASSERT(err == Z_STREAM_END);
-    err = deflateEnd(&zst);
-    if (err != Z_OK) {
-        handleError(zst, err, "while finishing compression");
-    }
-    retVal.resize((size_t)(zst.next_out - (Bytef *)retVal.data()));
+    compressor->compress(data, len, retVal, Z_FINISH);
     return retVal;
 }
 
 std::string Zlib::compressToString(const Byte *data, size_t len, int level) {
-    z_stream zst;
-    zst.zalloc = (alloc_func)NULL;
-    zst.zfree = (free_func)Z_NULL;
-    zst.next_in = (Bytef *)data;
-    size_t oBufLen = DEFAULTALLOC;
+    auto compressor = CompressorPool::acquireCompressor(level);
     std::string retVal;
-    int err = deflateInit(&zst, level);
-    if (err != Z_OK) {
-        if (err == Z_MEM_ERROR) {
-            NET4CXX_THROW_EXCEPTION(MemoryError, "Out of memory while compressing data");
-        } else if (err == Z_STREAM_ERROR) {
-            NET4CXX_THROW_EXCEPTION(ZlibError, "Bad compression level");
-        } else {
-            deflateEnd(&zst);
-            handleError(zst, err, "while compressing data");
-        }
-    }
-    zst.avail_in = (unsigned int)len;
-    do {
-        ArrangeOutputBuffer(zst, retVal, oBufLen);
-        err = deflate(&zst, Z_FINISH);
-        if (err == Z_STREAM_ERROR) {
-            deflateEnd(&zst);
-            NET4CXX_THROW_EXCEPTION(ZlibError, "while compressing data");
-        }
-    } while (zst.avail_out == 0);
-    NET4CXX_ASSERT(zst.avail_in == 0);
-    NET4CXX_ASSERT(err == Z_STREAM_END);
-    err = deflateEnd(&zst);
-    if (err != Z_OK) {
-        handleError(zst, err, "while finishing compression");
-    }
-    retVal.resize((size_t)(zst.next_out - (Bytef *)retVal.data()));
+    compressor->compress(data, len, retVal, Z_FINISH);
     return retVal;
 }
 
 ByteArray Zlib::decompress(const Byte *data, size_t len, int wbits) {
-    z_stream zst;
-    zst.zalloc = (alloc_func)NULL;
-    zst.zfree = (free_func)Z_NULL;
-    zst.avail_in = 0;
-    zst.next_in = (Bytef *)data;
-    size_t oBufLen = DEFAULTALLOC;
+    auto decompressor = CompressorPool::acquireDecompressor(wbits);
     ByteArray retVal;
-    int err = inflateInit2(&zst, wbits);
-    if (err != Z_OK) {
-        if (err == Z_MEM_ERROR) {
-            NET4CXX_THROW_EXCEPTION(MemoryError, "Out of memory while decompressing data");
-        } else {
-            inflateEnd(&zst);
-            handleError(zst, err, "while preparing to decompress data");
-        }
-    }
-    zst.avail_in = (unsigned int)len;
-    do {
-        ArrangeOutputBuffer(zst, retVal, oBufLen);
-        err = inflate(&zst, Z_FINISH);
-        if (err != Z_OK && err != Z_BUF_ERROR && err != Z_STREAM_END) {
-            inflateEnd(&zst);
-            if (err == Z_MEM_ERROR) {
-                NET4CXX_THROW_EXCEPTION(MemoryError, "Out of memory while decompressing data");
-            } else {
-                handleError(zst, err, "while decompressing data");
-            }
-        }
-    } while (zst.avail_out == 0);
-    if (err != Z_STREAM_END) {
-        inflateEnd(&zst);
-        handleError(zst, err, "while decompressing data");
+    decompressor->decompress(data, len, retVal);
+    if (!decompressor->eof()) {
+        NET4CXX_THROW_EXCEPTION(ZlibError, "Error %d while decompressing data: incomplete or truncated stream",
+                                Z_BUF_ERROR);
     }
-    err = inflateEnd(&zst);
-    if (err != Z_OK) {
-        handleError(zst, err, "while finishing data decompression");
-    }
-    retVal.resize((size_t)(zst.next_out - (Bytef *)retVal.data()));
     return retVal;
 }
 
 std::string Zlib::decompressToString(const Byte *data, size_t len, int wbits) {
-    z_stream zst;
-    zst.zalloc = (alloc_func)NULL;
-    zst.zfree = (free_func)Z_NULL;
-    zst.avail_in = 0;
-    zst.next_in = (Bytef *)data;
-    size_t oBufLen = DEFAULTALLOC;
+    auto decompressor = CompressorPool::acquireDecompressor(wbits);
     std::string retVal;
-    int err = inflateInit2(&zst, wbits);
-    if (err != Z_OK) {
-        if (err == Z_MEM_ERROR) {
-            NET4CXX_THROW_EXCEPTION(MemoryError, "Out of memory while decompressing data");
-        } else {
-            inflateEnd(&zst);
-            handleError(zst, err, "while preparing to decompress data");
-        }
-    }
-    zst.avail_in = (unsigned int)len;
-    do {
-        ArrangeOutputBuffer(zst, retVal, oBufLen);
-        err = inflate(&zst, Z_FINISH);
-        if (err != Z_OK && err != Z_BUF_ERROR && err != Z_STREAM_END) {
-            inflateEnd(&zst);
-            if (err == Z_MEM_ERROR) {
-                NET4CXX_THROW_EXCEPTION(MemoryError, "Out of memory while decompressing data");
-            } else {
-                handleError(zst, err, "while decompressing data");
-            }
-        }
-    } while (zst.avail_out == 0);
-    if (err != Z_STREAM_END) {
-        inflateEnd(&zst);
-        handleError(zst, err, "while decompressing data");
-    }
-    err = inflateEnd(&zst);
-    if (err != Z_OK) {
-        handleError(zst, err, "while finishing data decompression");
+    decompressor->decompress(data, len, retVal);
+    if (!decompressor->eof()) {
+        NET4CXX_THROW_EXCEPTION(ZlibError, "Error %d while decompressing data: incomplete or truncated stream",
+                                Z_BUF_ERROR);
     }
-    retVal.resize((size_t)(zst.next_out - (Bytef *)retVal.data()));
     return retVal;
 }
 
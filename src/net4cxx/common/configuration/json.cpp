@@ -4,6 +4,7 @@
 
 #include "net4cxx/common/configuration/json.h"
 #include "net4cxx/common/utilities/errors.h"
+#include "net4cxx/common/utilities/utf8.h"
 
 
 NS_BEGIN
@@ -1911,6 +1912,9 @@ bool BuiltReader::decodeString(Token &token) {
 }
 
 bool BuiltReader::decodeString(Token &token, std::string &decoded) {
+    if (_features.failIfInvalidUtf8 && !Utf8Util::validate(token.start + 1, (size_t)(token.end - token.start - 2))) {
+        return addError("Invalid UTF-8 in string", token);
+    }
     decoded.reserve(static_cast<size_t >(token.end - token.start + 2));
     const char *current = token.start + 1;
     const char *end = token.end - 1;
@@ -2187,6 +2191,7 @@ CharReader* CharReaderBuilder::newCharReader() const {
     features.failIfExtra = _settings["failIfExtra"].asBool();
     features.rejectDupKeys = _settings["rejectDupKeys"].asBool();
     features.allowSpecialFloats = _settings["allowSpecialFloats"].asBool();
+    features.failIfInvalidUtf8 = _settings["failIfInvalidUtf8"].asBool();
     return new BuiltCharReader(collectComments, features);
 }
 
@@ -2202,6 +2207,7 @@ static void getValidReaderKeys(StringSet *validKeys) {
     validKeys->insert("failIfExtra");
     validKeys->insert("rejectDupKeys");
     validKeys->insert("allowSpecialFloats");
+    validKeys->insert("failIfInvalidUtf8");
 }
 
 bool CharReaderBuilder::validate(JsonValue *invalid) const {
@@ -2232,6 +2238,7 @@ void CharReaderBuilder::setDefaults(JsonValue *settings) {
     (*settings)["failIfExtra"] = false;
     (*settings)["rejectDupKeys"] = false;
     (*settings)["allowSpecialFloats"] = false;
+    (*settings)["failIfInvalidUtf8"] = false;
 }
 
 void CharReaderBuilder::strictMode(JsonValue *settings) {
@@ -2244,6 +2251,7 @@ void CharReaderBuilder::strictMode(JsonValue *settings) {
     (*settings)["failIfExtra"] = true;
     (*settings)["rejectDupKeys"] = true;
     (*settings)["allowSpecialFloats"] = false;
+    (*settings)["failIfInvalidUtf8"] = true;
 }
 
 
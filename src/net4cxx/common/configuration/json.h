@@ -526,6 +526,7 @@ struct ReaderFeatures {
     bool failIfExtra;
     bool rejectDupKeys;
     bool allowSpecialFloats;
+    bool failIfInvalidUtf8;
     int stackLimit;
 };
 
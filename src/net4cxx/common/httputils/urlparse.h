@@ -149,7 +149,9 @@ public:
 
     static std::string unquotePlus(const std::string &s);
 
-    static std::string quote(const std::string &s, std::string safe="/");
+    static void unquoteTo(std::string &out, boost::string_view s, bool plus=false);
+
+    static std::string quote(const std::string &s, const std::string &safe="/");
 
     static std::string quotePlus(const std::string &s, const std::string &safe="");
 
@@ -164,19 +166,62 @@ public:
     static QueryArgListMap parseQS(const std::string &queryString, bool keepBlankValues=false,
                                     bool strictParsing=false);
 
+    static void parseQS(const std::string &queryString, QueryArgListMap &arguments, bool keepBlankValues=false,
+                        bool strictParsing=false);
+
     static QueryArgList parseQSL(const std::string &queryString, bool keepBlankValues=false, bool strictParsing=false);
 protected:
     static std::tuple<std::string, std::string> splitParams(const std::string &url);
 
     static std::tuple<std::string, std::string> splitNetloc(const std::string &url, size_t start=0);
 
+    static void makeSafeTable(const std::string &safe, bool *safeTable);
+
+    static std::string doQuote(const std::string &s, const bool *safeTable, bool plus);
+
+    static void quoteTo(std::string &out, boost::string_view s, const bool *safeTable, bool plus);
+
+    static void appendQueryArg(std::string &out, boost::string_view name, boost::string_view value);
+
     static const StringSet _usesRelative;
     static const StringSet _usesNetloc;
     static const StringSet _usesParams;
     static const char * _schemeChars;
-    static const std::map<std::string, char> _hexToChar;
-    static const char * _alwaysSafe;
-    static const std::map<char, std::string> _safeMap;
+    static const signed char _hexValues[256];
+    static const char * _hexDigits;
+    static const bool _alwaysSafe[256];
+};
+
+
+// Splits a query string on '&' and ';' and decodes each pair into reusable buffers, the query string must outlive
+// the iterator
+class NET4CXX_COMMON_API QueryStringIterator {
+public:
+    explicit QueryStringIterator(boost::string_view queryString, bool keepBlankValues=false,
+                                 bool strictParsing=false)
+            : _queryString(queryString)
+            , _keepBlankValues(keepBlankValues)
+            , _strictParsing(strictParsing) {
+
+    }
+
+    bool next();
+
+    const std::string& name() const {
+        return _name;
+    }
+
+    const std::string& value() const {
+        return _value;
+    }
+protected:
+    boost::string_view _queryString;
+    size_t _pos{0};
+    bool _done{false};
+    bool _keepBlankValues;
+    bool _strictParsing;
+    std::string _name;
+    std::string _value;
 };
 
 NS_END
@@ -0,0 +1,260 @@
+//
+// Created by yuwenyong.vincent on 2019-03-23.
+//
+
+#include "net4cxx/common/logging/asynclog.h"
+#include "net4cxx/common/logging/logging.h"
+
+
+NS_BEGIN
+
+
+AsyncLogRing::AsyncLogRing(size_t capacity) {
+    size_t size = 1;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    _slots.resize(size);
+    _mask = size - 1;
+}
+
+
+constexpr size_t AsyncLogging::DEFAULT_RING_CAPACITY;
+constexpr double AsyncLogging::IDLE_INTERVAL;
+std::atomic<bool> AsyncLogging::_running{false};
+std::atomic<AsyncLogging::OverflowPolicy> AsyncLogging::_policy{AsyncLogging::REPORT_DROPPED};
+std::atomic<uint64_t> AsyncLogging::_dropped{0};
+std::atomic<uint64_t> AsyncLogging::_written{0};
+std::atomic<bool> AsyncLogging::_sleeping{false};
+uint64_t AsyncLogging::_reported = 0;
+size_t AsyncLogging::_ringCapacity = AsyncLogging::DEFAULT_RING_CAPACITY;
+std::mutex AsyncLogging::_lock;
+std::condition_variable AsyncLogging::_wakeup;
+std::condition_variable AsyncLogging::_flushed;
+uint64_t AsyncLogging::_flushRequested = 0;
+uint64_t AsyncLogging::_flushCompleted = 0;
+bool AsyncLogging::_stopping = false;
+std::thread AsyncLogging::_thread;
+std::vector<AsyncLogRingPtr> AsyncLogging::_rings;
+thread_local bool AsyncLogging::_writerThread = false;
+
+void AsyncLogging::start(size_t ringCapacity, OverflowPolicy policy) {
+    std::lock_guard<std::mutex> lock(_lock);
+    if (_running) {
+        NET4CXX_THROW_EXCEPTION(AlreadyExist, "Asynchronous logging already started");
+    }
+    // Rings already handed out keep their size
+    _ringCapacity = ringCapacity ? ringCapacity : DEFAULT_RING_CAPACITY;
+    _policy = policy;
+    _stopping = false;
+    _thread = std::thread(&AsyncLogging::run);
+    _running = true;
+}
+
+void AsyncLogging::stop() {
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        if (!_running) {
+            return;
+        }
+        _running = false;
+        _stopping = true;
+        _wakeup.notify_one();
+    }
+    _thread.join();
+    logging::core::get()->flush();
+}
+
+void AsyncLogging::flush() {
+    if (!_running || _writerThread) {
+        logging::core::get()->flush();
+        return;
+    }
+    std::unique_lock<std::mutex> lock(_lock);
+    if (_stopping) {
+        lock.unlock();
+        logging::core::get()->flush();
+        return;
+    }
+    uint64_t request = ++_flushRequested;
+    _wakeup.notify_one();
+    _flushed.wait(lock, [request]() {
+        return _flushCompleted >= request;
+    });
+}
+
+bool AsyncLogging::write(Logger *logger, const StringLiteral &file, size_t line, const StringLiteral &func,
+                         Severity severity, const Byte *data, size_t length, size_t limit) {
+    bool accepted;
+    AsyncLogRecord *record = beginRecord(accepted);
+    if (!record) {
+        return accepted;
+    }
+    record->kind = AsyncLogRecord::DUMP;
+    record->text.assign((const char *)data, length);
+    record->limit = limit;
+    endRecord(record, logger, file, line, func, severity);
+    return true;
+}
+
+AsyncLogRecord* AsyncLogging::beginRecord(bool &accepted) {
+    accepted = false;
+    // Whatever the sinks log themselves is written in place
+    if (_writerThread) {
+        return nullptr;
+    }
+    AsyncLogRing *ring = getLocalRing();
+    AsyncLogRecord *record = ring->beginWrite();
+    while (!record) {
+        if (_policy != BLOCK_PRODUCER) {
+            ++_dropped;
+            accepted = true;
+            return nullptr;
+        }
+        if (!_running) {
+            return nullptr;
+        }
+        wakeup();
+        std::this_thread::yield();
+        record = ring->beginWrite();
+    }
+    accepted = true;
+    return record;
+}
+
+void AsyncLogging::endRecord(AsyncLogRecord *record, Logger *logger, const StringLiteral &file, size_t line,
+                             const StringLiteral &func, Severity severity) {
+    record->logger = logger;
+    record->severity = severity;
+    record->file = file;
+    record->line = line;
+    record->func = func;
+    record->time = std::chrono::system_clock::now();
+    record->threadId = logging::aux::this_thread::get_id();
+    getLocalRing()->endWrite();
+    if (_sleeping.load(std::memory_order_relaxed)) {
+        wakeup();
+    }
+    // A fatal record is likely the last one before the process goes down
+    if (severity >= NET4CXX_SEVERITY_FATAL) {
+        flush();
+    }
+}
+
+AsyncLogRing* AsyncLogging::getLocalRing() {
+    struct LocalRing {
+        ~LocalRing() {
+            // The writer thread drops the ring once it is drained
+            if (ring) {
+                ring->close();
+            }
+        }
+
+        AsyncLogRingPtr ring;
+    };
+    static thread_local LocalRing local;
+    if (!local.ring) {
+        std::lock_guard<std::mutex> lock(_lock);
+        local.ring = std::make_shared<AsyncLogRing>(_ringCapacity);
+        _rings.emplace_back(local.ring);
+    }
+    return local.ring.get();
+}
+
+void AsyncLogging::run() {
+    _writerThread = true;
+    std::vector<AsyncLogRingPtr> rings;
+    std::string message;
+    bool stopping = false;
+    uint64_t flushRequested = 0, flushCompleted = 0;
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+            rings = _rings;
+            flushRequested = _flushRequested;
+            stopping = _stopping;
+        }
+        size_t count = drain(rings, message);
+        if (_policy == REPORT_DROPPED) {
+            reportDropped();
+        }
+        if (flushRequested != flushCompleted) {
+            logging::core::get()->flush();
+            flushCompleted = flushRequested;
+            std::lock_guard<std::mutex> lock(_lock);
+            _flushCompleted = flushCompleted;
+            _flushed.notify_all();
+        }
+        if (count) {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(_lock);
+        _rings.erase(std::remove_if(_rings.begin(), _rings.end(), [](const AsyncLogRingPtr &ring) {
+            return ring->closed() && ring->empty();
+        }), _rings.end());
+        if (stopping) {
+            break;
+        }
+        if (_flushRequested != flushCompleted || _stopping) {
+            continue;
+        }
+        // A missed wakeup only delays the records by the idle interval
+        _sleeping = true;
+        _wakeup.wait_for(lock, std::chrono::microseconds((int64_t)(IDLE_INTERVAL * 1000000)));
+        _sleeping = false;
+    }
+    logging::core::get()->flush();
+    std::lock_guard<std::mutex> lock(_lock);
+    _flushCompleted = _flushRequested;
+    _flushed.notify_all();
+    _writerThread = false;
+}
+
+size_t AsyncLogging::drain(const std::vector<AsyncLogRingPtr> &rings, std::string &message) {
+    size_t count = 0;
+    for (auto &ring: rings) {
+        AsyncLogRecord *record;
+        // Bounded per ring, so one busy thread can not starve the others
+        for (size_t i = 0; i != 1024 && (record = ring->front()) != nullptr; ++i) {
+            writeRecord(*record, message);
+            ring->pop();
+            ++count;
+        }
+    }
+    _written.fetch_add(count, std::memory_order_relaxed);
+    return count;
+}
+
+void AsyncLogging::writeRecord(AsyncLogRecord &record, std::string &message) {
+    switch (record.kind) {
+        case AsyncLogRecord::TEXT: {
+            record.logger->pushRecord(record, record.text);
+            break;
+        }
+        case AsyncLogRecord::ARGUMENTS: {
+            record.format(&record.arguments, record.text.c_str(), message);
+            record.logger->pushRecord(record, message);
+            break;
+        }
+        case AsyncLogRecord::DUMP: {
+            record.logger->pushRecord(record, (const Byte *)record.text.data(), record.text.size(), record.limit);
+            break;
+        }
+    }
+}
+
+void AsyncLogging::reportDropped() {
+    uint64_t dropped = _dropped.load(std::memory_order_relaxed);
+    if (dropped != _reported) {
+        Logging::getLogger()->warn("%u log records dropped, the asynchronous log buffers were full",
+                                   dropped - _reported);
+        _reported = dropped;
+    }
+}
+
+void AsyncLogging::wakeup() {
+    std::lock_guard<std::mutex> lock(_lock);
+    _wakeup.notify_one();
+}
+
+NS_END
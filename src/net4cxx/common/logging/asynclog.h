@@ -0,0 +1,307 @@
+//
+// Created by yuwenyong.vincent on 2019-03-23.
+//
+
+#ifndef NET4CXX_COMMON_LOGGING_ASYNCLOG_H
+#define NET4CXX_COMMON_LOGGING_ASYNCLOG_H
+
+#include "net4cxx/common/common.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <boost/log/detail/thread_id.hpp>
+#include "net4cxx/common/logging/attributes.h"
+#include "net4cxx/common/utilities/strutil.h"
+
+
+NS_BEGIN
+
+class Logger;
+
+
+struct AsyncLogRecord {
+    enum Kind {
+        TEXT,
+        ARGUMENTS,
+        DUMP,
+    };
+
+    using FormatType = void (*)(void *, const char *, std::string &);
+
+    Logger *logger;
+    Severity severity;
+    StringLiteral file;
+    size_t line;
+    StringLiteral func;
+    std::chrono::system_clock::time_point time;
+    logging::aux::thread::id threadId;
+    Kind kind;
+    // The message, the format string or the bytes to dump. Slots are reused, so its capacity is too
+    std::string text;
+    size_t limit;
+    FormatType format;
+    // Arguments copied by value, formatted and destroyed by the writer thread
+    typename std::aligned_storage<128, alignof(std::max_align_t)>::type arguments;
+};
+
+
+// Arguments formatted on the writer thread have to own their value, anything else is formatted by the caller
+template <typename ValueT, typename=void>
+struct AsyncLogArgument {
+    static constexpr bool deferred = false;
+    using Type = ValueT;
+};
+
+template <typename ValueT>
+struct AsyncLogArgument<ValueT, std::enable_if_t<std::is_arithmetic<ValueT>::value || std::is_enum<ValueT>::value>> {
+    static constexpr bool deferred = true;
+    using Type = ValueT;
+};
+
+template <>
+struct AsyncLogArgument<std::string> {
+    static constexpr bool deferred = true;
+    using Type = std::string;
+};
+
+template <>
+struct AsyncLogArgument<const char *> {
+    static constexpr bool deferred = true;
+    using Type = std::string;
+};
+
+template <>
+struct AsyncLogArgument<char *> {
+    static constexpr bool deferred = true;
+    using Type = std::string;
+};
+
+template <>
+struct AsyncLogArgument<StringLiteral> {
+    static constexpr bool deferred = true;
+    using Type = StringLiteral;
+};
+
+
+template <typename... Args>
+class AsyncLogArguments {
+public:
+    template <typename... ArgsT>
+    explicit AsyncLogArguments(ArgsT&&... args)
+            : _values(std::forward<ArgsT>(args)...) {
+
+    }
+
+    static void format(void *storage, const char *fmt, std::string &message) {
+        auto self = static_cast<AsyncLogArguments *>(storage);
+        try {
+            message = self->format(fmt, std::index_sequence_for<Args...>());
+        } catch (std::exception &e) {
+            message = StrUtil::format("Bad log format \"%s\": %s", fmt, e.what());
+        }
+        self->~AsyncLogArguments();
+    }
+
+    static constexpr bool deferred() {
+        return sizeof(AsyncLogArguments) <= sizeof(AsyncLogRecord::arguments) &&
+               alignof(AsyncLogArguments) <= alignof(std::max_align_t) &&
+               allDeferred({AsyncLogArgument<Args>::deferred...});
+    }
+protected:
+    template <size_t... Indexes>
+    std::string format(const char *fmt, std::index_sequence<Indexes...>) const {
+        return StrUtil::format(fmt, std::get<Indexes>(_values)...);
+    }
+
+    static constexpr bool allDeferred(std::initializer_list<bool> deferred) {
+        for (bool value: deferred) {
+            if (!value) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::tuple<typename AsyncLogArgument<Args>::Type...> _values;
+};
+
+
+// Each thread appends to a single producer single consumer ring of its own, one background thread drains all the
+// rings and hands the records to the boost.log core, so the sinks, filters and formatters configured there still apply
+class NET4CXX_COMMON_API AsyncLogRing: public boost::noncopyable {
+public:
+    explicit AsyncLogRing(size_t capacity);
+
+    AsyncLogRecord* beginWrite() {
+        size_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail - _headCache == _slots.size()) {
+            _headCache = _head.load(std::memory_order_acquire);
+            if (tail - _headCache == _slots.size()) {
+                return nullptr;
+            }
+        }
+        return &_slots[tail & _mask];
+    }
+
+    void endWrite() {
+        _tail.store(_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    AsyncLogRecord* front() {
+        size_t head = _head.load(std::memory_order_relaxed);
+        if (head == _tailCache) {
+            _tailCache = _tail.load(std::memory_order_acquire);
+            if (head == _tailCache) {
+                return nullptr;
+            }
+        }
+        return &_slots[head & _mask];
+    }
+
+    void pop() {
+        _head.store(_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    bool empty() const {
+        return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_acquire);
+    }
+
+    void close() {
+        _closed = true;
+    }
+
+    bool closed() const {
+        return _closed;
+    }
+protected:
+    std::vector<AsyncLogRecord> _slots;
+    size_t _mask;
+    // Producer and consumer side on separate cache lines
+    alignas(64) std::atomic<size_t> _tail{0};
+    size_t _headCache{0};
+    alignas(64) std::atomic<size_t> _head{0};
+    size_t _tailCache{0};
+    std::atomic<bool> _closed{false};
+};
+
+using AsyncLogRingPtr = std::shared_ptr<AsyncLogRing>;
+
+
+class NET4CXX_COMMON_API AsyncLogging {
+public:
+    enum OverflowPolicy {
+        BLOCK_PRODUCER,
+        DROP_RECORDS,
+        // Drops too, the writer thread then logs how many records were lost
+        REPORT_DROPPED,
+    };
+
+    static void start(size_t ringCapacity=DEFAULT_RING_CAPACITY, OverflowPolicy policy=REPORT_DROPPED);
+
+    // Writes out every queued record before returning
+    static void stop();
+
+    static bool isRunning() {
+        return _running.load(std::memory_order_relaxed);
+    }
+
+    // Blocks until the records queued so far were written and the sinks flushed
+    static void flush();
+
+    static void setOverflowPolicy(OverflowPolicy policy) {
+        _policy = policy;
+    }
+
+    static OverflowPolicy getOverflowPolicy() {
+        return _policy;
+    }
+
+    static uint64_t getDroppedCount() {
+        return _dropped.load(std::memory_order_relaxed);
+    }
+
+    static uint64_t getWrittenCount() {
+        return _written.load(std::memory_order_relaxed);
+    }
+
+    // Returns false when the caller has to write the record itself
+    template <typename... Args>
+    static bool write(Logger *logger, const StringLiteral &file, size_t line, const StringLiteral &func,
+                      Severity severity, const char *format, Args&&... args) {
+        bool accepted;
+        AsyncLogRecord *record = beginRecord(accepted);
+        if (!record) {
+            return accepted;
+        }
+        setArguments(record, format,
+                     std::integral_constant<bool, AsyncLogArguments<std::decay_t<Args>...>::deferred()>(),
+                     std::forward<Args>(args)...);
+        endRecord(record, logger, file, line, func, severity);
+        return true;
+    }
+
+    static bool write(Logger *logger, const StringLiteral &file, size_t line, const StringLiteral &func,
+                      Severity severity, const Byte *data, size_t length, size_t limit);
+
+    static constexpr size_t DEFAULT_RING_CAPACITY = 8192;
+    static constexpr double IDLE_INTERVAL = 0.01;
+protected:
+    template <typename... Args>
+    static void setArguments(AsyncLogRecord *record, const char *format, std::true_type, Args&&... args) {
+        using ArgumentsType = AsyncLogArguments<std::decay_t<Args>...>;
+        new (&record->arguments) ArgumentsType(std::forward<Args>(args)...);
+        record->kind = AsyncLogRecord::ARGUMENTS;
+        record->format = &ArgumentsType::format;
+        record->text.assign(format);
+    }
+
+    template <typename... Args>
+    static void setArguments(AsyncLogRecord *record, const char *format, std::false_type, Args&&... args) {
+        record->kind = AsyncLogRecord::TEXT;
+        record->text = StrUtil::format(format, std::forward<Args>(args)...);
+    }
+
+    static void setArguments(AsyncLogRecord *record, const char *format, std::true_type) {
+        record->kind = AsyncLogRecord::TEXT;
+        record->text.assign(format);
+    }
+
+    static AsyncLogRecord* beginRecord(bool &accepted);
+
+    static void endRecord(AsyncLogRecord *record, Logger *logger, const StringLiteral &file, size_t line,
+                          const StringLiteral &func, Severity severity);
+
+    static AsyncLogRing* getLocalRing();
+
+    static void run();
+
+    static size_t drain(const std::vector<AsyncLogRingPtr> &rings, std::string &message);
+
+    static void writeRecord(AsyncLogRecord &record, std::string &message);
+
+    static void reportDropped();
+
+    static void wakeup();
+
+    static std::atomic<bool> _running;
+    static std::atomic<OverflowPolicy> _policy;
+    static std::atomic<uint64_t> _dropped;
+    static std::atomic<uint64_t> _written;
+    static std::atomic<bool> _sleeping;
+    static uint64_t _reported;
+    static size_t _ringCapacity;
+    static std::mutex _lock;
+    static std::condition_variable _wakeup;
+    static std::condition_variable _flushed;
+    static uint64_t _flushRequested;
+    static uint64_t _flushCompleted;
+    static bool _stopping;
+    static std::thread _thread;
+    static std::vector<AsyncLogRingPtr> _rings;
+    static thread_local bool _writerThread;
+};
+
+NS_END
+
+#endif //NET4CXX_COMMON_LOGGING_ASYNCLOG_H
@@ -3,6 +3,7 @@
 //
 
 #include "net4cxx/common/logging/logger.h"
+#include <boost/date_time/c_local_time_adjustor.hpp>
 #include <boost/log/utility/manipulators.hpp>
 #include "net4cxx/common/logging/logging.h"
 
@@ -11,6 +12,10 @@ NS_BEGIN
 
 void Logger::write(Severity severity, const Byte *data, size_t length, size_t limit) {
     if (severity >= _severity) {
+        if (AsyncLogging::isRunning() && AsyncLogging::write(this, StringLiteral(), 0, StringLiteral(), severity, data,
+                                                             length, limit)) {
+            return;
+        }
         logging::record rec = _logger.open_record(keywords::severity=severity);
         if (rec) {
             logging::record_ostream strm(rec);
@@ -27,6 +32,9 @@ void Logger::write(Severity severity, const Byte *data, size_t length, size_t li
 void Logger::write(const StringLiteral &file, size_t line, const StringLiteral &func, Severity severity,
                    const Byte *data, size_t length, size_t limit) {
     if (severity >= _severity) {
+        if (AsyncLogging::isRunning() && AsyncLogging::write(this, file, line, func, severity, data, length, limit)) {
+            return;
+        }
         logging::record rec = _logger.open_record((keywords::severity=severity, logger_keywords::file=file,
                                                    logger_keywords::line=line, logger_keywords::func=func));
         if (rec) {
@@ -41,4 +49,35 @@ void Logger::write(const StringLiteral &file, size_t line, const StringLiteral &
     }
 }
 
+void Logger::pushRecord(const AsyncLogRecord &record, const std::string &message) {
+    logging::record rec = openRecord(record);
+    if (rec) {
+        logging::record_ostream strm(rec);
+        strm << message;
+        _logger.push_record(std::move(rec));
+    }
+}
+
+void Logger::pushRecord(const AsyncLogRecord &record, const Byte *data, size_t length, size_t limit) {
+    logging::record rec = openRecord(record);
+    if (rec) {
+        logging::record_ostream strm(rec);
+        if (limit > 0) {
+            strm << logging::dump(data, length, limit);
+        } else {
+            strm << logging::dump(data, length);
+        }
+        _logger.push_record(std::move(rec));
+    }
+}
+
+logging::record Logger::openRecord(const AsyncLogRecord &record) {
+    auto since = std::chrono::duration_cast<std::chrono::microseconds>(record.time.time_since_epoch());
+    DateTime timestamp = boost::date_time::c_local_adjustor<DateTime>::utc_to_local(
+            DateTime(boost::gregorian::date(1970, 1, 1)) + boost::posix_time::microseconds(since.count()));
+    return _logger.open_record((keywords::severity=record.severity, logger_keywords::file=record.file,
+                                logger_keywords::line=record.line, logger_keywords::func=record.func,
+                                logger_keywords::timestamp=timestamp, logger_keywords::thread_id=record.threadId));
+}
+
 NS_END
\ No newline at end of file
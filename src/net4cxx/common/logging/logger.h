@@ -14,6 +14,7 @@
 #include <boost/log/keywords/channel.hpp>
 #include <boost/noncopyable.hpp>
 #include <boost/scope_exit.hpp>
+#include "net4cxx/common/logging/asynclog.h"
 #include "net4cxx/common/logging/attributes.h"
 #include "net4cxx/common/utilities/strutil.h"
 
@@ -28,6 +29,8 @@ namespace logger_keywords {
 BOOST_PARAMETER_KEYWORD(file_ns, file)
 BOOST_PARAMETER_KEYWORD(line_ns, line)
 BOOST_PARAMETER_KEYWORD(func_ns, func)
+BOOST_PARAMETER_KEYWORD(timestamp_ns, timestamp)
+BOOST_PARAMETER_KEYWORD(thread_id_ns, thread_id)
 }
 
 template <typename BaseT>
@@ -62,11 +65,15 @@ protected:
         StringLiteral fileValue = args[logger_keywords::file | StringLiteral()];
         size_t lineValue = args[logger_keywords::line | 0ul];
         StringLiteral funcValue = args[logger_keywords::func | StringLiteral()];
+        DateTime timestampValue = args[logger_keywords::timestamp | DateTime()];
+        logging::aux::thread::id threadIdValue = args[logger_keywords::thread_id | logging::aux::thread::id()];
 
         logging::attribute_set &attrs = BaseT::attributes();
         logging::attribute_set::iterator fileIter = attrs.end();
         logging::attribute_set::iterator lineIter = attrs.end();
         logging::attribute_set::iterator funcIter = attrs.end();
+        logging::attribute_set::iterator timestampIter = attrs.end();
+        logging::attribute_set::iterator threadIdIter = attrs.end();
 
         if (!fileValue.empty()) {
             auto res = BaseT::add_attribute_unlocked("File", attrs::constant<StringLiteral>(fileValue));
@@ -87,7 +94,23 @@ protected:
             }
         }
 
-        BOOST_SCOPE_EXIT_TPL(&fileIter, &lineIter, &funcIter, &attrs) {
+        // Records written on behalf of another thread keep the time and thread they were logged with, source
+        // attributes take precedence over the global ones of the same name
+        if (!timestampValue.is_not_a_date_time()) {
+            auto res = BaseT::add_attribute_unlocked("TimeStamp", attrs::constant<DateTime>(timestampValue));
+            if (res.second) {
+                timestampIter = res.first;
+            }
+        }
+        if (threadIdValue != logging::aux::thread::id()) {
+            auto res = BaseT::add_attribute_unlocked("ThreadID", attrs::constant<logging::aux::thread::id>(
+                    threadIdValue));
+            if (res.second) {
+                threadIdIter = res.first;
+            }
+        }
+
+        BOOST_SCOPE_EXIT_TPL(&fileIter, &lineIter, &funcIter, &timestampIter, &threadIdIter, &attrs) {
                 if (fileIter != attrs.end()) {
                     attrs.erase(fileIter);
                 }
@@ -97,6 +120,12 @@ protected:
                 if (funcIter != attrs.end()) {
                     attrs.erase(funcIter);
                 }
+                if (timestampIter != attrs.end()) {
+                    attrs.erase(timestampIter);
+                }
+                if (threadIdIter != attrs.end()) {
+                    attrs.erase(threadIdIter);
+                }
         } BOOST_SCOPE_EXIT_END
 
         return BaseT::open_record_unlocked(args);
@@ -121,6 +150,7 @@ class PositionLoggerMT: public src::basic_composite_logger<
 class NET4CXX_COMMON_API Logger: public boost::noncopyable {
 public:
     friend class boost::factory<Logger*>;
+    friend class AsyncLogging;
 
     const std::string& getName() const {
         return _name;
@@ -258,6 +288,10 @@ protected:
     template <typename... Args>
     void write(Severity severity, const char *format, Args&&... args) {
         if (severity >= _severity) {
+            if (AsyncLogging::isRunning() && AsyncLogging::write(this, StringLiteral(), 0, StringLiteral(), severity,
+                                                                 format, std::forward<Args>(args)...)) {
+                return;
+            }
             logging::record rec = _logger.open_record(keywords::severity=severity);
             if (rec) {
                 logging::record_ostream strm(rec);
@@ -271,6 +305,10 @@ protected:
     void write(const StringLiteral &file, size_t line, const StringLiteral &func, Severity severity, const char *format,
                Args&&... args) {
         if (severity >= _severity) {
+            if (AsyncLogging::isRunning() && AsyncLogging::write(this, file, line, func, severity, format,
+                                                                 std::forward<Args>(args)...)) {
+                return;
+            }
             logging::record rec = _logger.open_record((keywords::severity=severity, logger_keywords::file=file,
                                                        logger_keywords::line=line, logger_keywords::func=func));
             if (rec) {
@@ -286,6 +324,12 @@ protected:
     void write(const StringLiteral &file, size_t line, const StringLiteral &func, Severity severity,
                const Byte *data, size_t length, size_t limit=0);
 
+    void pushRecord(const AsyncLogRecord &record, const std::string &message);
+
+    void pushRecord(const AsyncLogRecord &record, const Byte *data, size_t length, size_t limit);
+
+    logging::record openRecord(const AsyncLogRecord &record);
+
     std::string _name;
     Severity _severity{NET4CXX_SEVERITY_TRACE};
     PositionLoggerMT<Severity> _logger;
@@ -29,6 +29,7 @@ public:
     static void initFromFile(const std::string &fileName);
 
     static void close() {
+        AsyncLogging::stop();
         logging::core::get()->flush();
         logging::core::get()->remove_all_sinks();
         _loggers.clear();
@@ -0,0 +1,64 @@
+//
+// Created by yuwenyong.vincent on 2019-03-30.
+//
+
+#include "net4cxx/common/utilities/arena.h"
+#include "net4cxx/common/debugging/assert.h"
+
+
+NS_BEGIN
+
+constexpr size_t Arena::DEFAULT_BLOCK_SIZE;
+constexpr size_t Arena::HEADER_SIZE;
+
+Arena::Arena(size_t blockSize)
+        : _blockSize(std::max(blockSize, HEADER_SIZE * 2)) {
+
+}
+
+Arena::~Arena() {
+    NET4CXX_ASSERT(_liveCount == 0);
+    while (_current) {
+        Block *next = _current->next;
+        ::operator delete(_current);
+        _current = next;
+    }
+}
+
+bool Arena::reset() {
+    if (_liveCount != 0) {
+        return false;
+    }
+    // Keep one regular block for the next round, oversized blocks are always given back
+    Block *kept = nullptr;
+    while (_current) {
+        Block *next = _current->next;
+        if (!kept && _current->size == _blockSize - HEADER_SIZE) {
+            kept = _current;
+            kept->next = nullptr;
+        } else {
+            ::operator delete(_current);
+        }
+        _current = next;
+    }
+    _current = kept;
+    _blockCount = kept ? 1 : 0;
+    _offset = 0;
+    return true;
+}
+
+void* Arena::allocateSlow(size_t size, size_t alignment) {
+    size_t capacity = _blockSize - HEADER_SIZE;
+    if (size + alignment > capacity) {
+        capacity = size + alignment;
+    }
+    auto block = static_cast<Block *>(::operator new(HEADER_SIZE + capacity));
+    block->next = _current;
+    block->size = capacity;
+    _current = block;
+    ++_blockCount;
+    _offset = 0;
+    return allocate(size, alignment);
+}
+
+NS_END
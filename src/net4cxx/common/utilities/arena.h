@@ -0,0 +1,132 @@
+//
+// Created by yuwenyong.vincent on 2019-03-30.
+//
+
+#ifndef NET4CXX_COMMON_UTILITIES_ARENA_H
+#define NET4CXX_COMMON_UTILITIES_ARENA_H
+
+#include "net4cxx/common/common.h"
+#include <atomic>
+
+
+NS_BEGIN
+
+
+// Monotonic allocator, memory is only given back by reset() once every allocation has been released
+class NET4CXX_COMMON_API Arena: public boost::noncopyable {
+public:
+    explicit Arena(size_t blockSize=DEFAULT_BLOCK_SIZE);
+
+    ~Arena();
+
+    void* allocate(size_t size, size_t alignment=alignof(std::max_align_t)) {
+        size_t offset = (_offset + alignment - 1) & ~(alignment - 1);
+        if (!_current || offset + size > _current->size) {
+            return allocateSlow(size, alignment);
+        }
+        _offset = offset + size;
+        ++_liveCount;
+        return _current->data() + offset;
+    }
+
+    void deallocate(void *) {
+        --_liveCount;
+    }
+
+    bool reset();
+
+    size_t getLiveCount() const {
+        return _liveCount;
+    }
+
+    size_t getBlockCount() const {
+        return _blockCount;
+    }
+
+    size_t getBlockSize() const {
+        return _blockSize;
+    }
+
+    static constexpr size_t DEFAULT_BLOCK_SIZE = 8192;
+protected:
+    struct Block {
+        Block *next;
+        size_t size;
+
+        char* data() {
+            return reinterpret_cast<char *>(this) + HEADER_SIZE;
+        }
+    };
+
+    static constexpr size_t HEADER_SIZE = (sizeof(Block) + alignof(std::max_align_t) - 1) &
+                                          ~(alignof(std::max_align_t) - 1);
+
+    void* allocateSlow(size_t size, size_t alignment);
+
+    size_t _blockSize;
+    Block *_current{nullptr};
+    size_t _offset{0};
+    size_t _blockCount{0};
+    std::atomic<size_t> _liveCount{0};
+};
+
+using ArenaPtr = std::shared_ptr<Arena>;
+
+
+// Keeps the arena alive for as long as anything allocated from it, so it can be used with std::allocate_shared
+template <typename T>
+class ArenaAllocator {
+public:
+    typedef T value_type;
+
+    template <typename U>
+    friend class ArenaAllocator;
+
+    explicit ArenaAllocator(ArenaPtr arena) noexcept
+            : _arena(std::move(arena)) {
+
+    }
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U> &other) noexcept
+            : _arena(other._arena) {
+
+    }
+
+    T* allocate(size_t n) {
+        return static_cast<T *>(_arena->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T *p, size_t) noexcept {
+        _arena->deallocate(p);
+    }
+
+    const ArenaPtr& getArena() const {
+        return _arena;
+    }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U> &rhs) const noexcept {
+        return _arena == rhs._arena;
+    }
+
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U> &rhs) const noexcept {
+        return _arena != rhs._arena;
+    }
+protected:
+    ArenaPtr _arena;
+};
+
+
+template <typename T, typename... Args>
+std::shared_ptr<T> allocateShared(const ArenaPtr &arena, Args&&... args) {
+    if (!arena) {
+        return std::make_shared<T>(std::forward<Args>(args)...);
+    }
+    return std::allocate_shared<T>(ArenaAllocator<T>(arena), std::forward<Args>(args)...);
+}
+
+NS_END
+
+#endif //NET4CXX_COMMON_UTILITIES_ARENA_H
@@ -3,9 +3,59 @@
 //
 
 #include "net4cxx/common/utilities/messagebuffer.h"
+#include "net4cxx/common/debugging/assert.h"
 
 
 NS_BEGIN
 
 
+constexpr size_t BufferChain::BLOCK_SIZE;
+
+void BufferChain::append(const Byte *data, size_t length) {
+    if (!length) {
+        return;
+    }
+    if (_buffers.empty() || _buffers.back().getRemainingSpace() < length) {
+        _buffers.emplace_back(std::max(length, BLOCK_SIZE));
+    }
+    _buffers.back().write(data, length);
+    _size += length;
+}
+
+void BufferChain::append(BufferChain &&chain) {
+    if (_buffers.empty()) {
+        swap(chain);
+        return;
+    }
+    for (auto &buffer: chain._buffers) {
+        _buffers.emplace_back(std::move(buffer));
+    }
+    _size += chain._size;
+    chain.clear();
+}
+
+void BufferChain::consume(size_t length) {
+    NET4CXX_ASSERT(length <= _size);
+    while (length) {
+        MessageBuffer &buffer = _buffers.front();
+        size_t activeSize = buffer.getActiveSize();
+        if (length < activeSize) {
+            buffer.readCompleted(length);
+            _size -= length;
+            return;
+        }
+        length -= activeSize;
+        popFront();
+    }
+}
+
+std::string BufferChain::toString() const {
+    std::string data;
+    data.reserve(_size);
+    for (auto &buffer: _buffers) {
+        data.append((const char *)buffer.getReadPointer(), buffer.getActiveSize());
+    }
+    return data;
+}
+
 NS_END
\ No newline at end of file
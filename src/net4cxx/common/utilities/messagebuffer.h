@@ -25,21 +25,40 @@ public:
         _storage.resize(initialSize);
     }
 
+    explicit MessageBuffer(std::string &&data)
+            : _wpos(data.size())
+            , _rpos(0)
+            , _storage(std::move(data)) {
+
+    }
+
+    // The buffer references read-only data which may be queued on many connections at once; it is copied out
+    // before any modification
+    explicit MessageBuffer(std::shared_ptr<const std::string> data)
+            : _wpos(data->size())
+            , _rpos(0)
+            , _storage()
+            , _shared(std::move(data)) {
+
+    }
+
     void reset() {
         _wpos = 0;
         _rpos = 0;
+        _shared.reset();
     }
 
     void resize(size_t bytes) {
+        detach();
         _storage.resize(bytes);
     }
 
     Byte* getBasePointer() {
-        return _storage.data();
+        return _shared ? (Byte *)_shared->data() : (Byte *)&_storage[0];
     }
 
     const Byte* getBasePointer() const {
-        return _storage.data();
+        return (const Byte *)(_shared ? _shared->data() : _storage.data());
     }
 
     Byte* getReadPointer() {
@@ -71,14 +90,19 @@ public:
     }
 
     size_t getRemainingSpace() const {
-        return _storage.size() - _wpos;
+        return getBufferSize() - _wpos;
     }
 
     size_t getBufferSize() const {
-        return _storage.size();
+        return _shared ? _shared->size() : _storage.size();
+    }
+
+    bool isShared() const {
+        return (bool)_shared;
     }
 
     void normalize() {
+        detach();
         if (_rpos) {
             if (_rpos != _wpos) {
                 memmove(getBasePointer(), getReadPointer(), getActiveSize());
@@ -89,12 +113,14 @@ public:
     }
 
     void ensureFreeSpace() {
+        detach();
         if (getRemainingSpace() == 0) {
             _storage.resize(_storage.size() * 3 / 2);
         }
     }
 
     void ensureFreeSpace(size_t space) {
+        detach();
         if (getRemainingSpace() < space) {
             _storage.resize(getBufferSize() + space - getRemainingSpace());
         }
@@ -107,9 +133,134 @@ public:
         }
     }
 protected:
+    void detach() {
+        if (_shared) {
+            _storage.assign(_shared->data() + _rpos, _wpos - _rpos);
+            _wpos -= _rpos;
+            _rpos = 0;
+            _shared.reset();
+        }
+    }
+
     size_t _wpos;
     size_t _rpos;
-    ByteArray _storage;
+    std::string _storage;
+    std::shared_ptr<const std::string> _shared;
+};
+
+
+class NET4CXX_COMMON_API BufferChain {
+public:
+    typedef std::deque<MessageBuffer> ContainerType;
+    typedef ContainerType::iterator iterator;
+    typedef ContainerType::const_iterator const_iterator;
+
+    BufferChain() = default;
+
+    BufferChain(const BufferChain &) = delete;
+
+    BufferChain& operator=(const BufferChain &) = delete;
+
+    BufferChain(BufferChain &&rhs) noexcept
+            : _buffers(std::move(rhs._buffers))
+            , _size(rhs._size) {
+        rhs._size = 0;
+    }
+
+    BufferChain& operator=(BufferChain &&rhs) noexcept {
+        _buffers = std::move(rhs._buffers);
+        _size = rhs._size;
+        rhs._size = 0;
+        return *this;
+    }
+
+    void append(MessageBuffer &&buffer) {
+        size_t length = buffer.getActiveSize();
+        if (length) {
+            _buffers.emplace_back(std::move(buffer));
+            _size += length;
+        }
+    }
+
+    void append(std::string &&data) {
+        append(MessageBuffer(std::move(data)));
+    }
+
+    void append(const Byte *data, size_t length);
+
+    void append(const std::string &data) {
+        append((const Byte *)data.data(), data.size());
+    }
+
+    void append(const char *data) {
+        append((const Byte *)data, strlen(data));
+    }
+
+    void append(BufferChain &&chain);
+
+    void prepend(std::string &&data) {
+        size_t length = data.size();
+        if (length) {
+            _buffers.emplace_front(std::move(data));
+            _size += length;
+        }
+    }
+
+    void consume(size_t length);
+
+    void clear() {
+        _buffers.clear();
+        _size = 0;
+    }
+
+    void swap(BufferChain &rhs) {
+        _buffers.swap(rhs._buffers);
+        std::swap(_size, rhs._size);
+    }
+
+    std::string toString() const;
+
+    size_t size() const {
+        return _size;
+    }
+
+    bool empty() const {
+        return _size == 0;
+    }
+
+    size_t getBufferCount() const {
+        return _buffers.size();
+    }
+
+    MessageBuffer& front() {
+        return _buffers.front();
+    }
+
+    void popFront() {
+        _size -= _buffers.front().getActiveSize();
+        _buffers.pop_front();
+    }
+
+    iterator begin() {
+        return _buffers.begin();
+    }
+
+    const_iterator begin() const {
+        return _buffers.begin();
+    }
+
+    iterator end() {
+        return _buffers.end();
+    }
+
+    const_iterator end() const {
+        return _buffers.end();
+    }
+
+    static constexpr size_t BLOCK_SIZE = 4096;
+protected:
+    ContainerType _buffers;
+    size_t _size{0};
 };
 
 NS_END
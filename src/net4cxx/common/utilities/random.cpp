@@ -22,6 +22,11 @@ double Random::normalvariate(double mu, double sigma) {
     return mu + z * sigma;
 }
 
+std::random_device& Random::device() {
+    static thread_local std::random_device rd;
+    return rd;
+}
+
 thread_local std::default_random_engine Random::_engine;
 
 NS_END
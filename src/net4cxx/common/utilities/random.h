@@ -81,23 +81,22 @@ public:
 
     static double normalvariate(double mu, double sigma);
 
+    // Drawn from the system's random source four bytes at a time, the device is opened once per thread
     static void randBytes(Byte *buffer, size_t length) {
-        std::random_device rd;
-        std::uniform_int_distribution<Byte> dist;
-        for (size_t i = 0; i != length; ++i) {
-            buffer[i] = dist(rd);
+        auto &rd = device();
+        for (size_t i = 0; i < length; i += sizeof(unsigned int)) {
+            unsigned int value = rd();
+            std::memcpy(buffer + i, &value, std::min(sizeof(value), length - i));
         }
     }
 
     template <size_t BufLen>
     static void randBytes(std::array<Byte, BufLen> &buffer) {
-        std::random_device rd;
-        std::uniform_int_distribution<Byte> dist;
-        for (size_t i = 0; i != BufLen; ++i) {
-            buffer[i] = dist(rd);
-        }
+        randBytes(buffer.data(), BufLen);
     }
 protected:
+    static std::random_device& device();
+
     static thread_local std::default_random_engine _engine;
 };
 
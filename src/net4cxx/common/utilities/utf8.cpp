@@ -0,0 +1,264 @@
+//
+// Created by yuwenyong.vincent on 2019-03-20.
+//
+
+#include "net4cxx/common/utilities/utf8.h"
+#include <cstring>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define NET4CXX_UTF8_X86
+#include <immintrin.h>
+#endif
+
+
+NS_BEGIN
+
+
+namespace {
+
+bool validatePortable(const Byte *data, size_t len) {
+    size_t i = 0;
+    while (i < len) {
+        i += Utf8Util::asciiPrefix(data + i, len - i);
+        if (i == len) {
+            break;
+        }
+        Byte b = data[i];
+        if (b < 0xC2) {
+            return false;
+        } else if (b < 0xE0) {
+            if (len - i < 2 || (data[i + 1] & 0xC0u) != 0x80u) {
+                return false;
+            }
+            i += 2;
+        } else if (b < 0xF0) {
+            Byte lo = (Byte)(b == 0xE0 ? 0xA0 : 0x80), hi = (Byte)(b == 0xED ? 0x9F : 0xBF);
+            if (len - i < 3 || data[i + 1] < lo || data[i + 1] > hi || (data[i + 2] & 0xC0u) != 0x80u) {
+                return false;
+            }
+            i += 3;
+        } else if (b < 0xF5) {
+            Byte lo = (Byte)(b == 0xF0 ? 0x90 : 0x80), hi = (Byte)(b == 0xF4 ? 0x8F : 0xBF);
+            if (len - i < 4 || data[i + 1] < lo || data[i + 1] > hi || (data[i + 2] & 0xC0u) != 0x80u ||
+                (data[i + 3] & 0xC0u) != 0x80u) {
+                return false;
+            }
+            i += 4;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+#ifdef NET4CXX_UTF8_X86
+
+// The lookup tables of Keiser and Lemire, "Validating UTF-8 In Less Than One Instruction Per Byte".
+// Every error kind gets a bit, a byte pair is invalid when the bit survives all three lookups
+const Byte TOO_SHORT = 1u << 0u;
+const Byte TOO_LONG = 1u << 1u;
+const Byte OVERLONG_3 = 1u << 2u;
+const Byte TOO_LARGE = 1u << 3u;
+const Byte SURROGATE = 1u << 4u;
+const Byte OVERLONG_2 = 1u << 5u;
+const Byte TOO_LARGE_1000 = 1u << 6u;
+const Byte OVERLONG_4 = 1u << 6u;
+const Byte TWO_CONTS = 1u << 7u;
+const Byte CARRY = TOO_SHORT | TOO_LONG | TWO_CONTS;
+
+alignas(16) const Byte BYTE_1_HIGH[16] = {
+        TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+        TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+        TOO_SHORT | OVERLONG_2,
+        TOO_SHORT,
+        TOO_SHORT | OVERLONG_3 | SURROGATE,
+        TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4,
+};
+
+alignas(16) const Byte BYTE_1_LOW[16] = {
+        CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+        CARRY | OVERLONG_2,
+        CARRY,
+        CARRY,
+        CARRY | TOO_LARGE,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+};
+
+alignas(16) const Byte BYTE_2_HIGH[16] = {
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+};
+
+// Nonzero where a lead byte near the end of a block still waits for continuation bytes
+alignas(32) const Byte INCOMPLETE_MAX[32] = {
+        255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+        255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 0xF0 - 1, 0xE0 - 1, 0xC0 - 1,
+};
+
+__attribute__((target("ssse3")))
+inline __m128i highNibbles128(__m128i v) {
+    return _mm_and_si128(_mm_srli_epi16(v, 4), _mm_set1_epi8(0x0F));
+}
+
+__attribute__((target("ssse3")))
+inline __m128i checkBlock128(__m128i input, __m128i prevInput) {
+    const __m128i byte1High = _mm_load_si128((const __m128i *)BYTE_1_HIGH);
+    const __m128i byte1Low = _mm_load_si128((const __m128i *)BYTE_1_LOW);
+    const __m128i byte2High = _mm_load_si128((const __m128i *)BYTE_2_HIGH);
+    __m128i prev1 = _mm_alignr_epi8(input, prevInput, 15);
+    __m128i special = _mm_and_si128(
+            _mm_and_si128(_mm_shuffle_epi8(byte1High, highNibbles128(prev1)),
+                          _mm_shuffle_epi8(byte1Low, _mm_and_si128(prev1, _mm_set1_epi8(0x0F)))),
+            _mm_shuffle_epi8(byte2High, highNibbles128(input)));
+    __m128i prev2 = _mm_alignr_epi8(input, prevInput, 14);
+    __m128i prev3 = _mm_alignr_epi8(input, prevInput, 13);
+    __m128i mustBeContinuation = _mm_or_si128(_mm_subs_epu8(prev2, _mm_set1_epi8((char)(0xE0 - 0x80))),
+                                              _mm_subs_epu8(prev3, _mm_set1_epi8((char)(0xF0 - 0x80))));
+    return _mm_xor_si128(_mm_and_si128(mustBeContinuation, _mm_set1_epi8((char)0x80)), special);
+}
+
+__attribute__((target("ssse3")))
+bool validateSSSE3(const Byte *data, size_t len) {
+    const __m128i incompleteMax = _mm_loadu_si128((const __m128i *)(INCOMPLETE_MAX + 16));
+    __m128i error = _mm_setzero_si128();
+    __m128i prevInput = _mm_setzero_si128();
+    __m128i prevIncomplete = _mm_setzero_si128();
+    alignas(16) Byte tail[16];
+    for (size_t i = 0; i < len; i += 16) {
+        __m128i input;
+        if (len - i >= 16) {
+            input = _mm_loadu_si128((const __m128i *)(data + i));
+        } else {
+            // ASCII padding turns a truncated sequence at the end into a TOO_SHORT error
+            std::memset(tail, 0, sizeof(tail));
+            std::memcpy(tail, data + i, len - i);
+            input = _mm_load_si128((const __m128i *)tail);
+        }
+        if (_mm_movemask_epi8(input) == 0) {
+            error = _mm_or_si128(error, prevIncomplete);
+        } else {
+            error = _mm_or_si128(error, checkBlock128(input, prevInput));
+            prevIncomplete = _mm_subs_epu8(input, incompleteMax);
+        }
+        prevInput = input;
+        if (((i + 16) & 1023u) == 0 && _mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) != 0xFFFF) {
+            return false;
+        }
+    }
+    error = _mm_or_si128(error, prevIncomplete);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) == 0xFFFF;
+}
+
+__attribute__((target("avx2")))
+inline __m256i highNibbles256(__m256i v) {
+    return _mm256_and_si256(_mm256_srli_epi16(v, 4), _mm256_set1_epi8(0x0F));
+}
+
+__attribute__((target("avx2")))
+inline __m256i checkBlock256(__m256i input, __m256i prevInput) {
+    const __m256i byte1High = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *)BYTE_1_HIGH));
+    const __m256i byte1Low = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *)BYTE_1_LOW));
+    const __m256i byte2High = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *)BYTE_2_HIGH));
+    // The upper half of the previous block followed by the lower half of this one
+    __m256i shifted = _mm256_permute2x128_si256(prevInput, input, 0x21);
+    __m256i prev1 = _mm256_alignr_epi8(input, shifted, 15);
+    __m256i special = _mm256_and_si256(
+            _mm256_and_si256(_mm256_shuffle_epi8(byte1High, highNibbles256(prev1)),
+                             _mm256_shuffle_epi8(byte1Low, _mm256_and_si256(prev1, _mm256_set1_epi8(0x0F)))),
+            _mm256_shuffle_epi8(byte2High, highNibbles256(input)));
+    __m256i prev2 = _mm256_alignr_epi8(input, shifted, 14);
+    __m256i prev3 = _mm256_alignr_epi8(input, shifted, 13);
+    __m256i mustBeContinuation = _mm256_or_si256(_mm256_subs_epu8(prev2, _mm256_set1_epi8((char)(0xE0 - 0x80))),
+                                                 _mm256_subs_epu8(prev3, _mm256_set1_epi8((char)(0xF0 - 0x80))));
+    return _mm256_xor_si256(_mm256_and_si256(mustBeContinuation, _mm256_set1_epi8((char)0x80)), special);
+}
+
+__attribute__((target("avx2")))
+bool validateAVX2(const Byte *data, size_t len) {
+    const __m256i incompleteMax = _mm256_load_si256((const __m256i *)INCOMPLETE_MAX);
+    __m256i error = _mm256_setzero_si256();
+    __m256i prevInput = _mm256_setzero_si256();
+    __m256i prevIncomplete = _mm256_setzero_si256();
+    alignas(32) Byte tail[32];
+    for (size_t i = 0; i < len; i += 32) {
+        __m256i input;
+        if (len - i >= 32) {
+            input = _mm256_loadu_si256((const __m256i *)(data + i));
+        } else {
+            std::memset(tail, 0, sizeof(tail));
+            std::memcpy(tail, data + i, len - i);
+            input = _mm256_load_si256((const __m256i *)tail);
+        }
+        if (_mm256_movemask_epi8(input) == 0) {
+            error = _mm256_or_si256(error, prevIncomplete);
+        } else {
+            error = _mm256_or_si256(error, checkBlock256(input, prevInput));
+            prevIncomplete = _mm256_subs_epu8(input, incompleteMax);
+        }
+        prevInput = input;
+        if (((i + 32) & 1023u) == 0 && !_mm256_testz_si256(error, error)) {
+            return false;
+        }
+    }
+    error = _mm256_or_si256(error, prevIncomplete);
+    return _mm256_testz_si256(error, error) != 0;
+}
+
+#endif
+
+}
+
+
+bool Utf8Util::validate(const Byte *data, size_t len, Kernel kernel) {
+    switch (std::min(kernel, bestKernel())) {
+#ifdef NET4CXX_UTF8_X86
+        case AVX2:
+            return validateAVX2(data, len);
+        case SSSE3:
+            return validateSSSE3(data, len);
+#endif
+        default:
+            return validatePortable(data, len);
+    }
+}
+
+size_t Utf8Util::asciiPrefix(const Byte *data, size_t len) {
+    size_t i = 0;
+    uint64_t word;
+    for (; len - i >= 8; i += 8) {
+        std::memcpy(&word, data + i, 8);
+        if (word & 0x8080808080808080ull) {
+            break;
+        }
+    }
+    while (i < len && data[i] < 0x80) {
+        ++i;
+    }
+    return i;
+}
+
+Utf8Util::Kernel Utf8Util::bestKernel() {
+#ifdef NET4CXX_UTF8_X86
+    static const Kernel kernel = __builtin_cpu_supports("avx2") ? AVX2 :
+                                 (__builtin_cpu_supports("ssse3") ? SSSE3 : PORTABLE);
+    return kernel;
+#else
+    return PORTABLE;
+#endif
+}
+
+NS_END
@@ -0,0 +1,45 @@
+//
+// Created by yuwenyong.vincent on 2019-03-20.
+//
+
+#ifndef NET4CXX_COMMON_UTILITIES_UTF8_H
+#define NET4CXX_COMMON_UTILITIES_UTF8_H
+
+#include "net4cxx/common/common.h"
+
+
+NS_BEGIN
+
+
+class NET4CXX_COMMON_API Utf8Util {
+public:
+    enum Kernel {
+        PORTABLE,
+        SSSE3,
+        AVX2,
+    };
+
+    // Whether the whole buffer is well formed UTF-8, ending on a code point boundary
+    static bool validate(const Byte *data, size_t len) {
+        return validate(data, len, bestKernel());
+    }
+
+    static bool validate(const char *data, size_t len) {
+        return validate((const Byte *)data, len, bestKernel());
+    }
+
+    static bool validate(const std::string &s) {
+        return validate((const Byte *)s.data(), s.size(), bestKernel());
+    }
+
+    static bool validate(const Byte *data, size_t len, Kernel kernel);
+
+    // Length of the leading run of ASCII bytes
+    static size_t asciiPrefix(const Byte *data, size_t len);
+
+    static Kernel bestKernel();
+};
+
+NS_END
+
+#endif //NET4CXX_COMMON_UTILITIES_UTF8_H
@@ -134,6 +134,38 @@ void Producer::resumeProducing() {
 }
 
 
+void Connection::write(BufferChain &&chain) {
+    for (auto &buffer: chain) {
+        write(buffer.getReadPointer(), buffer.getActiveSize());
+    }
+    chain.clear();
+}
+
+void Connection::write(const Byte *header, size_t headerLength, const Byte *data, size_t length) {
+    MessageBuffer buffer(headerLength + length);
+    buffer.write(header, headerLength);
+    buffer.write(data, length);
+    BufferChain chain;
+    chain.append(std::move(buffer));
+    write(std::move(chain));
+}
+
+bool Connection::supportsWriteFile() const {
+    return false;
+}
+
+void Connection::writeFile(FileRegion region) {
+    NET4CXX_THROW_EXCEPTION(NotImplementedError, "Transport does not support writeFile");
+}
+
+void Connection::pauseReading() {
+    NET4CXX_THROW_EXCEPTION(NotImplementedError, "Transport does not support pauseReading");
+}
+
+void Connection::resumeReading() {
+    NET4CXX_THROW_EXCEPTION(NotImplementedError, "Transport does not support resumeReading");
+}
+
 void Connection::dataReceived(Byte *data, size_t length) {
     auto protocol = _protocol.lock();
     NET4CXX_ASSERT(protocol);
@@ -147,6 +179,7 @@ void Connection::connectionLost(std::exception_ptr reason) {
     }
     auto protocol = _protocol.lock();
     NET4CXX_ASSERT(protocol);
+    _pausedProtocol.reset();
     protocol->connectionLost(reason);
 }
 
@@ -9,6 +9,7 @@
 #include <boost/asio.hpp>
 #include <boost/asio/ssl.hpp>
 #include <boost/asio/steady_timer.hpp>
+#include "net4cxx/common/debugging/assert.h"
 #include "net4cxx/common/utilities/errors.h"
 #include "net4cxx/common/utilities/messagebuffer.h"
 
@@ -375,6 +376,41 @@ public:
 using ProducerPtr = std::shared_ptr<Producer>;
 
 
+class NET4CXX_COMMON_API FileRegion {
+public:
+    FileRegion(int fd, size_t offset, size_t length, std::shared_ptr<void> owner=nullptr)
+            : _fd(fd)
+            , _offset(offset)
+            , _length(length)
+            , _owner(std::move(owner)) {
+
+    }
+
+    int getFd() const {
+        return _fd;
+    }
+
+    size_t getOffset() const {
+        return _offset;
+    }
+
+    size_t getLength() const {
+        return _length;
+    }
+
+    void consume(size_t bytes) {
+        NET4CXX_ASSERT(bytes <= _length);
+        _offset += bytes;
+        _length -= bytes;
+    }
+protected:
+    int _fd;
+    size_t _offset;
+    size_t _length;
+    std::shared_ptr<void> _owner;
+};
+
+
 class NET4CXX_COMMON_API Connection {
 public:
     Connection(const ProtocolPtr &protocol, Reactor *reactor)
@@ -387,6 +423,19 @@ public:
 
     virtual void write(const Byte *data, size_t length) = 0;
 
+    virtual void write(BufferChain &&chain);
+
+    // Writes the two pieces back to back, e.g. a frame header and its payload
+    virtual void write(const Byte *header, size_t headerLength, const Byte *data, size_t length);
+
+    virtual bool supportsWriteFile() const;
+
+    virtual void writeFile(FileRegion region);
+
+    virtual void pauseReading();
+
+    virtual void resumeReading();
+
     virtual void loseConnection() = 0;
 
     virtual void abortConnection() = 0;
@@ -431,6 +480,15 @@ public:
         return _writeBufferSize;
     }
 
+    // Bytes queued by write() that haven't reached the socket yet
+    size_t getPendingWriteSize() const {
+        size_t pendingSize = 0;
+        for (auto &buffer: _writeQueue) {
+            pendingSize += buffer.getActiveSize();
+        }
+        return pendingSize;
+    }
+
     Reactor* reactor() {
         return _reactor;
     }
@@ -440,11 +498,13 @@ protected:
     void connectionLost(std::exception_ptr reason);
 
     std::weak_ptr<Protocol> _protocol;
+    std::shared_ptr<Protocol> _pausedProtocol;
     Reactor *_reactor{nullptr};
     MessageBuffer _readBuffer;
     std::deque<MessageBuffer> _writeQueue;
     size_t _writeBufferSize{65536};
     bool _reading{false};
+    bool _readingPaused{false};
     bool _writing{false};
     bool _connected{false};
     bool _disconnected{false};
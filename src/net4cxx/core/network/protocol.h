@@ -143,6 +143,36 @@ public:
         write((const Byte *)data.c_str(), data.size());
     }
 
+    void write(BufferChain &&chain) {
+        NET4CXX_ASSERT(_transport);
+        _transport->write(std::move(chain));
+    }
+
+    void write(const Byte *header, size_t headerLength, const Byte *data, size_t length) {
+        NET4CXX_ASSERT(_transport);
+        _transport->write(header, headerLength, data, length);
+    }
+
+    bool supportsWriteFile() const {
+        NET4CXX_ASSERT(_transport);
+        return _transport->supportsWriteFile();
+    }
+
+    void writeFile(FileRegion region) {
+        NET4CXX_ASSERT(_transport);
+        _transport->writeFile(std::move(region));
+    }
+
+    void pauseReading() {
+        NET4CXX_ASSERT(_transport);
+        _transport->pauseReading();
+    }
+
+    void resumeReading() {
+        NET4CXX_ASSERT(_transport);
+        _transport->resumeReading();
+    }
+
     void loseConnection() {
         NET4CXX_ASSERT(_transport);
         _transport->loseConnection();
@@ -228,6 +258,11 @@ public:
         return _transport->getWriteBufferSize();
     }
 
+    size_t getPendingWriteSize() const {
+        NET4CXX_ASSERT(_transport);
+        return _transport->getPendingWriteSize();
+    }
+
     void setFactory(const std::shared_ptr<Factory> &factory) {
         _factory = factory;
     }
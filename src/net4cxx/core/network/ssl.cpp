@@ -42,6 +42,26 @@ void SSLConnection::write(const Byte *data, size_t length) {
     startWriting();
 }
 
+void SSLConnection::pauseReading() {
+    if (_readingPaused || _disconnected) {
+        return;
+    }
+    _readingPaused = true;
+    // No read is pending while paused, so hold the protocol to keep the connection alive
+    _pausedProtocol = _protocol.lock();
+}
+
+void SSLConnection::resumeReading() {
+    if (!_readingPaused) {
+        return;
+    }
+    _readingPaused = false;
+    auto protocol = std::move(_pausedProtocol);
+    if (!_disconnecting && !_disconnected && _connected) {
+        startReading();
+    }
+}
+
 void SSLConnection::loseConnection() {
     if (_disconnecting || _disconnected || !_connected) {
         return;
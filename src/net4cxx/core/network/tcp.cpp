@@ -8,6 +8,10 @@
 #include "net4cxx/core/network/protocol.h"
 #include "net4cxx/core/network/reactor.h"
 
+#if PLATFORM == PLATFORM_UNIX
+#include <sys/sendfile.h>
+#endif
+
 NS_BEGIN
 
 
@@ -27,19 +31,106 @@ void TCPConnection::write(const Byte *data, size_t length) {
     MessageBuffer packet(length);
     packet.write(data, length);
     _writeQueue.emplace_back(std::move(packet));
-    if (_producer && _streamingProducer) {
-        size_t totalSize = 0;
-        for (auto &buffer: _writeQueue) {
-            totalSize += buffer.getActiveSize();
-        }
-        if (totalSize > _writeBufferSize) {
-            _producerPaused = true;
-            _producer->pauseProducing();
+    checkWriteBufferSize();
+    startWriting();
+}
+
+void TCPConnection::write(BufferChain &&chain) {
+    if (_disconnecting || _disconnected || !_connected) {
+        return;
+    }
+    if (chain.empty()) {
+        return;
+    }
+    for (auto &buffer: chain) {
+        _writeQueue.emplace_back(std::move(buffer));
+    }
+    chain.clear();
+    checkWriteBufferSize();
+    startWriting();
+}
+
+void TCPConnection::write(const Byte *header, size_t headerLength, const Byte *data, size_t length) {
+    if (_disconnecting || _disconnected || !_connected) {
+        return;
+    }
+    size_t total = headerLength + length;
+    if (!total) {
+        return;
+    }
+    size_t bytesSent = 0;
+#ifndef BOOST_ASIO_HAS_IOCP
+    if (!_writing && _writeQueue.empty()) {
+        std::array<boost::asio::const_buffer, 2> buffers{{boost::asio::const_buffer(header, headerLength),
+                                                          boost::asio::const_buffer(data, length)}};
+        boost::system::error_code ec;
+        bytesSent = _socket.write_some(buffers, ec);
+        if (ec) {
+            // Queued as a whole, errors other than a full socket buffer are reported by the queued write
+            bytesSent = 0;
+        } else if (bytesSent == total) {
+            scheduleWriteDone();
+            return;
         }
     }
+#endif
+    MessageBuffer packet(total - bytesSent);
+    if (bytesSent < headerLength) {
+        packet.write(header + bytesSent, headerLength - bytesSent);
+        packet.write(data, length);
+    } else {
+        packet.write(data + (bytesSent - headerLength), total - bytesSent);
+    }
+    _writeQueue.emplace_back(std::move(packet));
+    checkWriteBufferSize();
+    startWriting();
+}
+
+bool TCPConnection::supportsWriteFile() const {
+#if PLATFORM == PLATFORM_UNIX
+    return true;
+#else
+    return false;
+#endif
+}
+
+void TCPConnection::writeFile(FileRegion region) {
+    if (!supportsWriteFile()) {
+        Connection::writeFile(std::move(region));
+    }
+    if (_disconnecting || _disconnected || !_connected) {
+        return;
+    }
+    if (!region.getLength()) {
+        return;
+    }
+    // An empty buffer in the write queue marks the position of the next file region; write() never queues one
+    _writeQueue.emplace_back(0);
+    _fileQueue.emplace_back(std::move(region));
+    checkWriteBufferSize();
     startWriting();
 }
 
+void TCPConnection::pauseReading() {
+    if (_readingPaused || _disconnected) {
+        return;
+    }
+    _readingPaused = true;
+    // No read is pending while paused, so hold the protocol to keep the connection alive
+    _pausedProtocol = _protocol.lock();
+}
+
+void TCPConnection::resumeReading() {
+    if (!_readingPaused) {
+        return;
+    }
+    _readingPaused = false;
+    auto protocol = std::move(_pausedProtocol);
+    if (!_disconnecting && !_disconnected && _connected) {
+        startReading();
+    }
+}
+
 void TCPConnection::loseConnection() {
     if (_disconnecting || _disconnected || !_connected) {
         return;
@@ -141,9 +232,15 @@ void TCPConnection::doWrite() {
     size_t bytesToSend, bytesSent;
     boost::system::error_code ec;
     for(;;) {
-        MessageBuffer &buffer = _writeQueue.front();
-        bytesToSend = buffer.getActiveSize();
-        bytesSent = _socket.write_some(boost::asio::buffer(buffer.getReadPointer(), bytesToSend), ec);
+        bool sendingFile = !_writeQueue.front().getActiveSize();
+        if (!sendingFile) {
+            WriteBuffers buffers;
+            bytesToSend = gatherWriteBuffers(buffers);
+            bytesSent = _socket.write_some(buffers, ec);
+        } else {
+            bytesToSend = _fileQueue.front().getLength();
+            bytesSent = sendFile(_fileQueue.front(), ec);
+        }
         if (ec) {
             if (ec == boost::asio::error::would_block || ec == boost::asio::error::try_again) {
                 break;
@@ -158,29 +255,26 @@ void TCPConnection::doWrite() {
             _disconnecting = true;
             doClose();
             return;
+        }
+        if (!sendingFile) {
+            consumeWriteQueue(bytesSent);
         } else if (bytesSent < bytesToSend) {
-            buffer.readCompleted(bytesSent);
+            _fileQueue.front().consume(bytesSent);
+        } else {
+            _fileQueue.pop_front();
+            _writeQueue.pop_front();
+        }
+        if (bytesSent < bytesToSend) {
             break;
         }
-        _writeQueue.pop_front();
         if (_writeQueue.empty()) {
-            if (_producer && (!_streamingProducer || _producerPaused) && !_pendingProducing) {
-                auto protocol = _protocol.lock();
-                NET4CXX_ASSERT(protocol);
-                _pendingProducing = true;
-                _reactor->addCallback([this, protocol, self=shared_from_this()]() {
-                    _pendingProducing = false;
-                    if (!_aborting && !_disconnected && _writeQueue.empty()) {
-                        writeDone();
-                    }
-                });
-            }
+            scheduleWriteDone();
             return;
         }
     }
 #endif
-    MessageBuffer &buffer = _writeQueue.front();
 #ifdef BOOST_ASIO_HAS_IOCP
+    MessageBuffer &buffer = _writeQueue.front();
     if (_writeQueue.size() > 1) {
         size_t space = 0;
         for (auto iter = std::next(_writeQueue.begin()); iter != _writeQueue.end(); ++iter) {
@@ -198,11 +292,19 @@ void TCPConnection::doWrite() {
     auto protocol = _protocol.lock();
     NET4CXX_ASSERT(protocol);
     _writing = true;
-    _socket.async_write_some(boost::asio::buffer(buffer.getReadPointer(), buffer.getActiveSize()),
-                             [protocol, self = shared_from_this()](const boost::system::error_code &ec,
-                                                                   size_t transferredBytes) {
-                                 self->cbWrite(ec, transferredBytes);
-                             });
+    if (!_writeQueue.front().getActiveSize()) {
+        _socket.async_wait(boost::asio::socket_base::wait_write,
+                           [protocol, self = shared_from_this()](const boost::system::error_code &ec) {
+                               self->cbWrite(ec, 0);
+                           });
+        return;
+    }
+    WriteBuffers buffers;
+    gatherWriteBuffers(buffers);
+    _socket.async_write_some(buffers, [protocol, self = shared_from_this()](const boost::system::error_code &ec,
+                                                                            size_t transferredBytes) {
+        self->cbWrite(ec, transferredBytes);
+    });
 }
 
 void TCPConnection::handleWrite(const boost::system::error_code &ec, size_t transferredBytes) {
@@ -219,18 +321,86 @@ void TCPConnection::handleWrite(const boost::system::error_code &ec, size_t tran
             closeSocket();
         }
     } else {
-        if (transferredBytes > 0) {
-            _writeQueue.front().readCompleted(transferredBytes);
-            if (!_writeQueue.front().getActiveSize()) {
-                _writeQueue.pop_front();
-            }
-        }
+        consumeWriteQueue(transferredBytes);
         if ((_disconnecting && _writeQueue.empty()) || _aborting) {
             closeSocket();
         }
     }
 }
 
+size_t TCPConnection::gatherWriteBuffers(WriteBuffers &buffers) {
+    size_t bytesToSend = 0;
+    for (auto &buffer: _writeQueue) {
+        if (!buffer.getActiveSize() || buffers.full()) {
+            break;
+        }
+        buffers.add(buffer.getReadPointer(), buffer.getActiveSize());
+        bytesToSend += buffer.getActiveSize();
+    }
+    return bytesToSend;
+}
+
+void TCPConnection::consumeWriteQueue(size_t bytes) {
+    while (bytes > 0) {
+        MessageBuffer &buffer = _writeQueue.front();
+        size_t activeSize = buffer.getActiveSize();
+        if (bytes < activeSize) {
+            buffer.readCompleted(bytes);
+            return;
+        }
+        bytes -= activeSize;
+        _writeQueue.pop_front();
+    }
+}
+
+size_t TCPConnection::sendFile(FileRegion &region, boost::system::error_code &ec) {
+#if PLATFORM == PLATFORM_UNIX
+    auto offset = (off_t)region.getOffset();
+    ssize_t bytesSent = ::sendfile(_socket.native_handle(), region.getFd(), &offset, region.getLength());
+    if (bytesSent < 0) {
+        ec.assign(errno, boost::asio::error::get_system_category());
+        return 0;
+    }
+    ec.clear();
+    return (size_t)bytesSent;
+#else
+    ec = boost::asio::error::operation_not_supported;
+    return 0;
+#endif
+}
+
+#ifndef BOOST_ASIO_HAS_IOCP
+void TCPConnection::scheduleWriteDone() {
+    if (_producer && (!_streamingProducer || _producerPaused) && !_pendingProducing) {
+        auto protocol = _protocol.lock();
+        NET4CXX_ASSERT(protocol);
+        _pendingProducing = true;
+        _reactor->addCallback([this, protocol, self=shared_from_this()]() {
+            _pendingProducing = false;
+            if (!_aborting && !_disconnected && _writeQueue.empty()) {
+                writeDone();
+            }
+        });
+    }
+}
+#endif
+
+void TCPConnection::checkWriteBufferSize() {
+    if (_producer && _streamingProducer) {
+        size_t totalSize = 0;
+        for (auto &buffer: _writeQueue) {
+            totalSize += buffer.getActiveSize();
+        }
+        for (auto &region: _fileQueue) {
+            totalSize += region.getLength();
+        }
+        if (totalSize > _writeBufferSize) {
+            _producerPaused = true;
+            _producer->pauseProducing();
+        }
+    }
+}
+
 
 void TCPServerConnection::cbAccept(const ProtocolPtr &protocol) {
     _protocol = protocol;
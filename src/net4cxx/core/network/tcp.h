@@ -30,6 +30,19 @@ public:
 
     void write(const Byte *data, size_t length) override;
 
+    void write(BufferChain &&chain) override;
+
+    // Sent straight from the caller's buffers while nothing is queued, only what the socket doesn't take is copied
+    void write(const Byte *header, size_t headerLength, const Byte *data, size_t length) override;
+
+    bool supportsWriteFile() const override;
+
+    void writeFile(FileRegion region) override;
+
+    void pauseReading() override;
+
+    void resumeReading() override;
+
     void loseConnection() override;
 
     void abortConnection() override;
@@ -93,8 +106,8 @@ protected:
     void cbRead(const boost::system::error_code &ec, size_t transferredBytes) {
         _reading = false;
         handleRead(ec, transferredBytes);
-        if (!_disconnecting && !_disconnected) {
-            doRead();
+        if (!_disconnecting && !_disconnected && !_readingPaused) {
+            startReading();
         }
     }
 
@@ -122,6 +135,39 @@ protected:
 
     void handleWrite(const boost::system::error_code &ec, size_t transferredBytes);
 
+    class WriteBuffers {
+    public:
+        typedef boost::asio::const_buffer value_type;
+        typedef const boost::asio::const_buffer* const_iterator;
+
+        bool full() const {
+            return _count == _buffers.size();
+        }
+
+        void add(const Byte *data, size_t length) {
+            _buffers[_count++] = boost::asio::const_buffer(data, length);
+        }
+
+        const_iterator begin() const {
+            return _buffers.data();
+        }
+
+        const_iterator end() const {
+            return _buffers.data() + _count;
+        }
+    protected:
+        std::array<boost::asio::const_buffer, 16> _buffers;
+        size_t _count{0};
+    };
+
+    size_t gatherWriteBuffers(WriteBuffers &buffers);
+
+    void consumeWriteQueue(size_t bytes);
+
+    size_t sendFile(FileRegion &region, boost::system::error_code &ec);
+
+    void checkWriteBufferSize();
+
     void writeDone() {
         if (_producer && (!_streamingProducer || _producerPaused)) {
             _producerPaused = true;
@@ -129,8 +175,14 @@ protected:
         }
     }
 
+#ifndef BOOST_ASIO_HAS_IOCP
+    // The write queue drained without an asynchronous write, so the producer is told from the next reactor turn
+    void scheduleWriteDone();
+#endif
+
     SocketType _socket;
     std::exception_ptr _error;
+    std::deque<FileRegion> _fileQueue;
 #ifndef BOOST_ASIO_HAS_IOCP
     bool _pendingProducing{false};
 #endif
@@ -41,6 +41,26 @@ void UNIXConnection::write(const Byte *data, size_t length) {
     startWriting();
 }
 
+void UNIXConnection::pauseReading() {
+    if (_readingPaused || _disconnected) {
+        return;
+    }
+    _readingPaused = true;
+    // No read is pending while paused, so hold the protocol to keep the connection alive
+    _pausedProtocol = _protocol.lock();
+}
+
+void UNIXConnection::resumeReading() {
+    if (!_readingPaused) {
+        return;
+    }
+    _readingPaused = false;
+    auto protocol = std::move(_pausedProtocol);
+    if (!_disconnecting && !_disconnected && _connected) {
+        startReading();
+    }
+}
+
 void UNIXConnection::loseConnection() {
     if (_disconnecting || _disconnected || !_connected) {
         return;
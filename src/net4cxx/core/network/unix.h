@@ -33,6 +33,10 @@ public:
 
     void write(const Byte *data, size_t length) override;
 
+    void pauseReading() override;
+
+    void resumeReading() override;
+
     void loseConnection() override;
 
     void abortConnection() override;
@@ -91,8 +95,8 @@ protected:
     void cbRead(const boost::system::error_code &ec, size_t transferredBytes) {
         _reading = false;
         handleRead(ec, transferredBytes);
-        if (!_disconnecting && !_disconnected) {
-            doRead();
+        if (!_disconnecting && !_disconnected && !_readingPaused) {
+            startReading();
         }
     }
 
@@ -56,9 +56,9 @@ void IOStream::onDisconnected(std::exception_ptr reason) {
 
 }
 
-void IOStream::readUntilRegex(const std::string &regex, size_t maxBytes) {
+void IOStream::readUntilRegex(const boost::regex &regex, size_t maxBytes) {
     NET4CXX_ASSERT_MSG(!reading(), "Already reading");
-    _readRegex = boost::regex(regex);
+    _readRegex = regex;
     if (maxBytes) {
         _readMaxBytes = maxBytes;
     }
@@ -74,9 +74,10 @@ void IOStream::readUntil(std::string delimiter, size_t maxBytes) {
     tryInlineRead();
 }
 
-void IOStream::readBytes(size_t numBytes) {
+void IOStream::readBytes(size_t numBytes, bool partial) {
     NET4CXX_ASSERT_MSG(!reading(), "Already reading");
     _readBytes = numBytes;
+    _readPartial = partial;
     tryInlineRead();
 }
 
@@ -94,6 +95,22 @@ void IOStream::write(const Byte *data, size_t length, bool writeCallback) {
     Protocol::write(data, length);
 }
 
+void IOStream::write(BufferChain &&data, bool writeCallback) {
+    if (closed()) {
+        NET4CXX_THROW_EXCEPTION(StreamClosedError, "Already closed");
+    }
+    _writeCallback = writeCallback;
+    Protocol::write(std::move(data));
+}
+
+void IOStream::writeFile(FileRegion region, bool writeCallback) {
+    if (closed()) {
+        NET4CXX_THROW_EXCEPTION(StreamClosedError, "Already closed");
+    }
+    _writeCallback = writeCallback;
+    Protocol::writeFile(std::move(region));
+}
+
 void IOStream::close(std::exception_ptr error) {
     if (!closed()) {
         _error = error;
@@ -120,8 +137,8 @@ void IOStream::readFromBuffer() {
         onDataRead(_readBuffer.getReadPointer(), numBytes);
         _readBuffer.readCompleted(numBytes);
     } else if (_readBytes) {
-        if (_readBuffer.getActiveSize() >= *_readBytes) {
-            size_t numBytes = *_readBytes;
+        if (_readBuffer.getActiveSize() >= *_readBytes || (_readPartial && _readBuffer.getActiveSize() != 0)) {
+            size_t numBytes = std::min(*_readBytes, _readBuffer.getActiveSize());
             _readBytes = boost::none;
             onDataRead(_readBuffer.getReadPointer(), numBytes);
             _readBuffer.readCompleted(numBytes);
@@ -158,7 +175,7 @@ bool IOStream::findReadPos() const {
     if (disconnected() && _readUntilClose) {
         return true;
     } else if (_readBytes) {
-        return _readBuffer.getActiveSize() >= *_readBytes;
+        return _readBuffer.getActiveSize() >= *_readBytes || (_readPartial && _readBuffer.getActiveSize() != 0);
     } else if (_readDelimiter) {
         return StrNStr((const char *)_readBuffer.getReadPointer(), _readBuffer.getActiveSize(),
                        _readDelimiter->c_str()) != nullptr;
@@ -49,11 +49,15 @@ public:
 
     virtual void onDisconnected(std::exception_ptr reason);
 
-    void readUntilRegex(const std::string &regex, size_t maxBytes=0);
+    void readUntilRegex(const std::string &regex, size_t maxBytes=0) {
+        readUntilRegex(boost::regex(regex), maxBytes);
+    }
+
+    void readUntilRegex(const boost::regex &regex, size_t maxBytes=0);
 
     void readUntil(std::string delimiter, size_t maxBytes=0);
 
-    void readBytes(size_t numBytes);
+    void readBytes(size_t numBytes, bool partial=false);
 
     void readUntilClose();
 
@@ -71,6 +75,10 @@ public:
         write((const Byte *)data.c_str(), data.size(), writeCallback);
     }
 
+    void write(BufferChain &&data, bool writeCallback=false);
+
+    void writeFile(FileRegion region, bool writeCallback=false);
+
     bool reading() const {
         return _readBytes || _readDelimiter || _readRegex || _readUntilClose;
     }
@@ -126,6 +134,7 @@ protected:
     boost::optional<boost::regex> _readRegex;
     boost::optional<size_t> _readMaxBytes;
     boost::optional<size_t> _readBytes;
+    bool _readPartial{false};
     bool _readUntilClose{false};
     bool _writeCallback{false};
 };
@@ -5,6 +5,7 @@
 #ifndef NET4CXX_NET4CXX_H
 #define NET4CXX_NET4CXX_H
 
+#include "net4cxx/common/compress/compressor.h"
 #include "net4cxx/common/compress/gzip.h"
 #include "net4cxx/common/configuration/configparser.h"
 #include "net4cxx/common/configuration/csvreader.h"
@@ -22,9 +23,11 @@
 #include "net4cxx/common/serialization/archive.h"
 #include "net4cxx/common/threading/concurrentqueue.h"
 #include "net4cxx/common/threading/taskpool.h"
+#include "net4cxx/common/utilities/arena.h"
 #include "net4cxx/common/utilities/messagebuffer.h"
 #include "net4cxx/common/utilities/objectmanager.h"
 #include "net4cxx/common/utilities/random.h"
+#include "net4cxx/common/utilities/utf8.h"
 #include "net4cxx/common/utilities/util.h"
 
 #include "net4cxx/core/network/defer.h"
@@ -38,7 +41,10 @@
 #include "net4cxx/core/protocols/iostream.h"
 #include "net4cxx/core/protocols/uintnreceiver.h"
 
+#include "net4cxx/plugins/web/eventsource.h"
 #include "net4cxx/plugins/web/httpclient.h"
+#include "net4cxx/plugins/web/metrics.h"
+#include "net4cxx/plugins/web/proxy.h"
 #include "net4cxx/plugins/web/web.h"
 #include "net4cxx/plugins/websocket/websocket.h"
 
@@ -0,0 +1,327 @@
+//
+// Created by yuwenyong.vincent on 2019-03-16.
+//
+
+#include "net4cxx/plugins/web/eventsource.h"
+#include <atomic>
+#include "net4cxx/core/network/reactor.h"
+
+
+NS_BEGIN
+
+
+std::string ServerSentEvent::encode() const {
+    std::string frame;
+    frame.reserve(_data.size() + _event.size() + _id.size() + 32);
+    if (_retry > 0) {
+        frame.append("retry: ");
+        frame.append(std::to_string(_retry));
+        frame.push_back('\n');
+    }
+    if (!_id.empty()) {
+        if (_id.find_first_of("\r\n") != std::string::npos) {
+            NET4CXX_THROW_EXCEPTION(ValueError, "Event id must not contain newlines");
+        }
+        frame.append("id: ");
+        frame.append(_id);
+        frame.push_back('\n');
+    }
+    if (!_event.empty()) {
+        if (_event.find_first_of("\r\n") != std::string::npos) {
+            NET4CXX_THROW_EXCEPTION(ValueError, "Event name must not contain newlines");
+        }
+        frame.append("event: ");
+        frame.append(_event);
+        frame.push_back('\n');
+    }
+    size_t i = 0, j = 0, length = _data.size();
+    do {
+        while (i < length && _data[i] != '\r' && _data[i] != '\n') {
+            ++i;
+        }
+        frame.append("data: ");
+        frame.append(_data, j, i - j);
+        frame.push_back('\n');
+        if (i < length) {
+            i += _data[i] == '\r' && i + 1 < length && _data[i + 1] == '\n' ? 2 : 1;
+        }
+        j = i;
+    } while (i < length);
+    frame.push_back('\n');
+    return frame;
+}
+
+
+constexpr size_t EventSourceHub::DEFAULT_HISTORY_SIZE;
+thread_local bool EventSourceHub::_destroyed = false;
+std::mutex EventSourceHub::_hubsLock;
+std::vector<EventSourceHub *> EventSourceHub::_hubs;
+
+EventSourceHub::EventSourceHub()
+        : _reactor(Reactor::current()) {
+    if (_reactor) {
+        std::lock_guard<std::mutex> lock(_hubsLock);
+        _hubs.emplace_back(this);
+    }
+}
+
+EventSourceHub::~EventSourceHub() {
+    _destroyed = true;
+    if (_reactor) {
+        std::lock_guard<std::mutex> lock(_hubsLock);
+        _hubs.erase(std::remove(_hubs.begin(), _hubs.end(), this), _hubs.end());
+    }
+}
+
+size_t EventSourceHub::publish(const std::string &channel, ServerSentEvent event) {
+    if (event.getId().empty()) {
+        event.setId(nextEventId());
+    }
+    HistoryEntry entry{event.getId(), event.getEvent(), std::make_shared<const std::string>(event.encode())};
+    return deliver(channel, entry);
+}
+
+size_t EventSourceHub::getSubscriberCount(const std::string &channel) const {
+    auto iter = _channels.find(channel);
+    return iter != _channels.end() ? iter->second.subscribers.size() : 0;
+}
+
+size_t EventSourceHub::getSubscriberCount() const {
+    size_t count = 0;
+    for (auto &kv: _channels) {
+        count += kv.second.subscribers.size();
+    }
+    return count;
+}
+
+EventSourceHub* EventSourceHub::local() {
+    if (_destroyed) {
+        return nullptr;
+    }
+    static thread_local EventSourceHub hub;
+    return &hub;
+}
+
+void EventSourceHub::publishAll(const std::string &channel, ServerSentEvent event) {
+    if (event.getId().empty()) {
+        event.setId(nextEventId());
+    }
+    auto entry = std::make_shared<HistoryEntry>();
+    entry->id = event.getId();
+    entry->event = event.getEvent();
+    entry->frame = std::make_shared<const std::string>(event.encode());
+    std::lock_guard<std::mutex> lock(_hubsLock);
+    for (auto hub: _hubs) {
+        hub->_reactor->addCallback([channel, entry]() {
+            auto hub = local();
+            if (hub) {
+                hub->deliver(channel, *entry);
+            }
+        });
+    }
+}
+
+size_t EventSourceHub::deliver(const std::string &channel, const HistoryEntry &entry) {
+    auto &target = _channels[channel];
+    if (_historySize != 0) {
+        target.history.emplace_back(entry);
+        while (target.history.size() > _historySize) {
+            target.history.pop_front();
+        }
+    }
+    size_t count = 0;
+    ++_delivering;
+    for (auto iter = target.subscribers.begin(); iter != target.subscribers.end();) {
+        // A dropped subscriber removes only itself, so advance before sending
+        auto subscriber = *iter++;
+        subscriber->sendFrame(entry.frame, entry.event);
+        ++count;
+    }
+    --_delivering;
+    if (target.subscribers.empty() && target.history.empty() && !_delivering) {
+        _channels.erase(channel);
+    }
+    return count;
+}
+
+EventSourceHub::SubscriberList::iterator EventSourceHub::subscribe(const std::string &channel,
+                                                                   EventSourceHandler *handler,
+                                                                   const std::string &lastEventId) {
+    auto &target = _channels[channel];
+    auto iter = target.subscribers.insert(target.subscribers.end(), handler);
+    if (!lastEventId.empty()) {
+        auto pos = std::find_if(target.history.begin(), target.history.end(), [&lastEventId](const HistoryEntry &entry) {
+            return entry.id == lastEventId;
+        });
+        if (pos != target.history.end()) {
+            for (++pos; pos != target.history.end() && !handler->closed(); ++pos) {
+                handler->sendFrame(pos->frame, pos->event);
+            }
+        }
+    }
+    return iter;
+}
+
+void EventSourceHub::unsubscribe(const std::string &channel, SubscriberList::iterator iter) {
+    auto target = _channels.find(channel);
+    NET4CXX_ASSERT(target != _channels.end());
+    target->second.subscribers.erase(iter);
+    if (target->second.subscribers.empty() && target->second.history.empty() && !_delivering) {
+        _channels.erase(target);
+    }
+}
+
+std::string EventSourceHub::nextEventId() {
+    static std::atomic<uint64_t> lastId{0};
+    return std::to_string(++lastId);
+}
+
+
+constexpr size_t EventSourceHandler::DEFAULT_MAX_PENDING_BYTES;
+
+EventSourceHandler::~EventSourceHandler() {
+    cleanup();
+}
+
+DeferredPtr EventSourceHandler::onGet(const StringVector &args) {
+    _autoFinish = false;
+    _lastEventId = _request->getHTTPHeaders()->get("Last-Event-ID");
+    setHeader("Content-Type", "text/event-stream");
+    setHeader("Cache-Control", "no-cache");
+    setHeader("X-Accel-Buffering", "no");
+    flush();
+    open(args);
+    return nullptr;
+}
+
+void EventSourceHandler::onConnectionClose() {
+    if (_closed) {
+        return;
+    }
+    _closed = true;
+    cleanup();
+    onClose();
+}
+
+void EventSourceHandler::open(const StringVector &args) {
+
+}
+
+void EventSourceHandler::onClose() {
+
+}
+
+void EventSourceHandler::subscribe(const std::string &channel) {
+    if (_closed || _subscriptions.find(channel) != _subscriptions.end()) {
+        return;
+    }
+    auto hub = EventSourceHub::local();
+    NET4CXX_ASSERT(hub);
+    auto iter = hub->subscribe(channel, this, _lastEventId);
+    if (_closed) {
+        hub->unsubscribe(channel, iter);
+        return;
+    }
+    _subscriptions.emplace(channel, iter);
+}
+
+void EventSourceHandler::unsubscribe(const std::string &channel) {
+    auto iter = _subscriptions.find(channel);
+    if (iter == _subscriptions.end()) {
+        return;
+    }
+    auto hub = EventSourceHub::local();
+    if (hub) {
+        hub->unsubscribe(channel, iter->second);
+    }
+    _subscriptions.erase(iter);
+}
+
+void EventSourceHandler::sendEvent(const ServerSentEvent &event) {
+    sendFrame(std::make_shared<const std::string>(event.encode()), event.getEvent());
+}
+
+void EventSourceHandler::close() {
+    if (_closed) {
+        return;
+    }
+    _closed = true;
+    cleanup();
+    if (!_finished && _request->getConnection()) {
+        finish();
+    }
+    onClose();
+}
+
+void EventSourceHandler::execute(TransformsType transforms, const StringVector &args) {
+    // Frames are shared by all subscribers, so per-connection output transforms can't be applied
+    RequestHandler::execute({}, args);
+}
+
+void EventSourceHandler::sendFrame(const EventSourceHub::FramePtr &frame, const std::string &event) {
+    if (_closed || _finished) {
+        return;
+    }
+    if (_maxPendingBytes == 0 || _pendingBytes + frame->size() <= _maxPendingBytes) {
+        writeFrame(frame);
+        return;
+    }
+    if (_slowConsumerPolicy == COALESCE_EVENTS) {
+        // Keep only the latest event of each type until the client catches up
+        auto iter = std::find_if(_coalesced.begin(), _coalesced.end(),
+                                 [&event](const std::pair<std::string, EventSourceHub::FramePtr> &pending) {
+            return pending.first == event;
+        });
+        if (iter != _coalesced.end()) {
+            _coalesced.erase(iter);
+        }
+        _coalesced.emplace_back(event, frame);
+        return;
+    }
+    NET4CXX_LOG_WARN(gAppLog, "Dropping slow event stream consumer %s", requestSummary());
+    _closed = true;
+    cleanup();
+    auto connection = _request->getConnection();
+    if (connection) {
+        connection->abortConnection();
+    }
+    onClose();
+}
+
+void EventSourceHandler::writeFrame(const EventSourceHub::FramePtr &frame) {
+    bool waiting = _pendingBytes != 0;
+    _pendingBytes += frame->size();
+    _writeBuffer.append(MessageBuffer(frame));
+    if (waiting) {
+        flush();
+    } else {
+        flush(false, [this, self=shared_from_this()]() {
+            onDrained();
+        });
+    }
+}
+
+void EventSourceHandler::onDrained() {
+    _pendingBytes = 0;
+    if (_closed || _finished || _coalesced.empty()) {
+        return;
+    }
+    decltype(_coalesced) coalesced;
+    coalesced.swap(_coalesced);
+    for (auto &pending: coalesced) {
+        writeFrame(pending.second);
+    }
+}
+
+void EventSourceHandler::cleanup() {
+    auto hub = EventSourceHub::local();
+    if (hub) {
+        for (auto &subscription: _subscriptions) {
+            hub->unsubscribe(subscription.first, subscription.second);
+        }
+    }
+    _subscriptions.clear();
+    _coalesced.clear();
+}
+
+NS_END
@@ -0,0 +1,211 @@
+//
+// Created by yuwenyong.vincent on 2019-03-16.
+//
+
+#ifndef NET4CXX_PLUGINS_WEB_EVENTSOURCE_H
+#define NET4CXX_PLUGINS_WEB_EVENTSOURCE_H
+
+#include "net4cxx/common/common.h"
+#include <list>
+#include <mutex>
+#include "net4cxx/plugins/web/web.h"
+
+
+NS_BEGIN
+
+
+class EventSourceHandler;
+
+
+class NET4CXX_COMMON_API ServerSentEvent {
+public:
+    ServerSentEvent() = default;
+
+    explicit ServerSentEvent(std::string data, std::string event={}, std::string id={})
+            : _data(std::move(data))
+            , _event(std::move(event))
+            , _id(std::move(id)) {
+
+    }
+
+    void setData(std::string data) {
+        _data = std::move(data);
+    }
+
+    const std::string& getData() const {
+        return _data;
+    }
+
+    void setEvent(std::string event) {
+        _event = std::move(event);
+    }
+
+    const std::string& getEvent() const {
+        return _event;
+    }
+
+    void setId(std::string id) {
+        _id = std::move(id);
+    }
+
+    const std::string& getId() const {
+        return _id;
+    }
+
+    void setRetry(int retry) {
+        _retry = retry;
+    }
+
+    int getRetry() const {
+        return _retry;
+    }
+
+    std::string encode() const;
+protected:
+    std::string _data;
+    std::string _event;
+    std::string _id;
+    int _retry{0};
+};
+
+
+// Every reactor thread has its own hub, so subscribers are only ever touched by the thread that serves them
+class NET4CXX_COMMON_API EventSourceHub: public boost::noncopyable {
+public:
+    typedef std::shared_ptr<const std::string> FramePtr;
+    typedef std::list<EventSourceHandler *> SubscriberList;
+
+    friend class EventSourceHandler;
+
+    struct HistoryEntry {
+        std::string id;
+        std::string event;
+        FramePtr frame;
+    };
+
+    struct Channel {
+        SubscriberList subscribers;
+        std::deque<HistoryEntry> history;
+    };
+
+    EventSourceHub();
+
+    ~EventSourceHub();
+
+    size_t publish(const std::string &channel, ServerSentEvent event);
+
+    size_t getSubscriberCount(const std::string &channel) const;
+
+    size_t getSubscriberCount() const;
+
+    void setHistorySize(size_t historySize) {
+        _historySize = historySize;
+    }
+
+    size_t getHistorySize() const {
+        return _historySize;
+    }
+
+    static EventSourceHub* local();
+
+    static void publishAll(const std::string &channel, ServerSentEvent event);
+
+    static constexpr size_t DEFAULT_HISTORY_SIZE = 64;
+protected:
+    size_t deliver(const std::string &channel, const HistoryEntry &entry);
+
+    SubscriberList::iterator subscribe(const std::string &channel, EventSourceHandler *handler,
+                                       const std::string &lastEventId);
+
+    void unsubscribe(const std::string &channel, SubscriberList::iterator iter);
+
+    static std::string nextEventId();
+
+    std::map<std::string, Channel> _channels;
+    size_t _historySize{DEFAULT_HISTORY_SIZE};
+    size_t _delivering{0};
+    Reactor *_reactor{nullptr};
+
+    static thread_local bool _destroyed;
+    static std::mutex _hubsLock;
+    static std::vector<EventSourceHub *> _hubs;
+};
+
+
+class NET4CXX_COMMON_API EventSourceHandler: public RequestHandler {
+public:
+    enum SlowConsumerPolicy {
+        DROP_SLOW_CONSUMER,
+        COALESCE_EVENTS,
+    };
+
+    friend class EventSourceHub;
+
+    using RequestHandler::RequestHandler;
+
+    ~EventSourceHandler() override;
+
+    DeferredPtr onGet(const StringVector &args) override;
+
+    void onConnectionClose() override;
+
+    virtual void open(const StringVector &args);
+
+    virtual void onClose();
+
+    void subscribe(const std::string &channel);
+
+    void unsubscribe(const std::string &channel);
+
+    void sendEvent(const ServerSentEvent &event);
+
+    void close();
+
+    bool closed() const {
+        return _closed;
+    }
+
+    const std::string& getLastEventId() const {
+        return _lastEventId;
+    }
+
+    void setMaxPendingBytes(size_t maxPendingBytes) {
+        _maxPendingBytes = maxPendingBytes;
+    }
+
+    size_t getMaxPendingBytes() const {
+        return _maxPendingBytes;
+    }
+
+    void setSlowConsumerPolicy(SlowConsumerPolicy policy) {
+        _slowConsumerPolicy = policy;
+    }
+
+    SlowConsumerPolicy getSlowConsumerPolicy() const {
+        return _slowConsumerPolicy;
+    }
+
+    static constexpr size_t DEFAULT_MAX_PENDING_BYTES = 256 * 1024;
+protected:
+    void execute(TransformsType transforms, const StringVector &args) override;
+
+    void sendFrame(const EventSourceHub::FramePtr &frame, const std::string &event);
+
+    void writeFrame(const EventSourceHub::FramePtr &frame);
+
+    void onDrained();
+
+    void cleanup();
+
+    std::map<std::string, EventSourceHub::SubscriberList::iterator> _subscriptions;
+    std::vector<std::pair<std::string, EventSourceHub::FramePtr>> _coalesced;
+    std::string _lastEventId;
+    size_t _pendingBytes{0};
+    size_t _maxPendingBytes{DEFAULT_MAX_PENDING_BYTES};
+    SlowConsumerPolicy _slowConsumerPolicy{DROP_SLOW_CONSUMER};
+    bool _closed{false};
+};
+
+NS_END
+
+#endif //NET4CXX_PLUGINS_WEB_EVENTSOURCE_H
@@ -398,7 +398,8 @@ void HTTPClientConnection::writeHeaders(const RequestStartLine &startLine, HTTPH
 
 void HTTPClientConnection::readResponse() {
     _state = READ_HEADER;
-    readUntilRegex("\r?\n\r?\n", _maxHeaderSize);
+    static const boost::regex headerEnd("\r?\n\r?\n");
+    readUntilRegex(headerEnd, _maxHeaderSize);
 }
 
 void HTTPClientConnection::readBody() {
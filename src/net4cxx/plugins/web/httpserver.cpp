@@ -37,6 +37,9 @@ void HTTPConnection::onConnected() {
     _headerTimeout = webApp->getIdleConnectionTimeout();
     _bodyTimeout = webApp->getBodyTimeout();
     _trustedDownstream = webApp->getTrustedDownstream();
+    if (webApp->getRequestArenaSize() != 0) {
+        _arena = std::make_shared<Arena>(webApp->getRequestArenaSize());
+    }
 
     startRequest();
 }
@@ -65,6 +68,10 @@ void HTTPConnection::onDataRead(Byte *data, size_t length) {
                     onChunkEnds((char *)data, length);
                     break;
                 }
+                case READ_LAST_CHUNK_ENDS: {
+                    onLastChunkEnds((char *)data, length);
+                    break;
+                }
                 default: {
                     NET4CXX_ASSERT_MSG(false, "Unreachable");
                     break;
@@ -124,7 +131,7 @@ void HTTPConnection::onDisconnected(std::exception_ptr reason) {
     clearCallbacks();
 }
 
-void HTTPConnection::writeHeaders(ResponseStartLine startLine, HTTPHeaders &headers, const Byte *chunk, size_t length,
+void HTTPConnection::writeHeaders(ResponseStartLine startLine, HTTPHeaders &headers, BufferChain &&chunk,
                                   WriteCallbackType callback) {
     StringVector lines;
     lines.emplace_back(StrUtil::format("HTTP/1.1 %d %s", startLine.getCode(), startLine.getReason()));
@@ -161,22 +168,37 @@ void HTTPConnection::writeHeaders(ResponseStartLine startLine, HTTPHeaders &head
         }
     }
     auto data = boost::join(lines, "\r\n") + "\r\n\r\n";
-    if (length != 0) {
-        data.append(formatChunk(chunk, length));
+    formatChunk(chunk, std::move(data));
+    if (callback) {
+        _writeCallback = std::move(callback);
     }
+    _pendingWrite = true;
+    write(std::move(chunk), true);
+}
+
+void HTTPConnection::writeChunk(BufferChain &&chunk, WriteCallbackType callback) {
+    formatChunk(chunk);
     if (callback) {
         _writeCallback = std::move(callback);
     }
     _pendingWrite = true;
-    write(data, true);
+    write(std::move(chunk), true);
 }
 
-void HTTPConnection::writeChunk(const Byte *chunk, size_t length, WriteCallbackType callback) {
+void HTTPConnection::writeFile(FileRegion region, WriteCallbackType callback) {
+    size_t length = region.getLength();
+    consumeContentRemaining(length);
     if (callback) {
         _writeCallback = std::move(callback);
     }
     _pendingWrite = true;
-    write(formatChunk(chunk, length), true);
+    if (_chunkingOutput && length != 0) {
+        write(StrUtil::format("%x\r\n", length));
+        IOStream::writeFile(std::move(region));
+        write("\r\n", true);
+    } else {
+        IOStream::writeFile(std::move(region), true);
+    }
 }
 
 void HTTPConnection::finish() {
@@ -203,6 +225,36 @@ void HTTPConnection::finish() {
     }
 }
 
+void HTTPConnection::pauseReading() {
+    if (_readingPaused || closed()) {
+        return;
+    }
+    _readingPaused = true;
+    Protocol::pauseReading();
+}
+
+void HTTPConnection::resumeReading() {
+    if (!_readingPaused || closed()) {
+        return;
+    }
+    _readingPaused = false;
+    Protocol::resumeReading();
+    if (_readPending) {
+        reactor()->addCallback([this, self=shared_from_this()]() {
+            if (_readingPaused || !_readPending || closed()) {
+                return;
+            }
+            _readPending = false;
+            try {
+                continueReading();
+            } catch (std::exception &e) {
+                NET4CXX_LOG_INFO(gGenLog, "Uncaught exception from %s: %s", _remoteIp, e.what());
+                close(std::current_exception());
+            }
+        });
+    }
+}
+
 void HTTPConnection::close(std::exception_ptr reason) {
     IOStream::close(reason);
     clearCallbacks();
@@ -222,13 +274,24 @@ void HTTPConnection::startRequest() {
     _pendingWrite = false;
     _readFinished =false;
     _writeFinished = false;
+    _readPending = false;
+    if (_readingPaused) {
+        _readingPaused = false;
+        Protocol::resumeReading();
+    }
     _expectedContentRemaining = boost::none;
     _decompressor.reset();
+    _dispatcher.reset();
+    _requestHeaders.reset();
+    if (_arena && !_arena->reset()) {
+        // Objects of the previous request are still referenced, leave that arena to them
+        _arena = std::make_shared<Arena>(_arena->getBlockSize());
+    }
     _dispatcher = getFactory<WebApp>()->startRequest(getSelf<HTTPConnection>());
     readHeaders();
 }
 
-std::string HTTPConnection::formatChunk(const Byte *data, size_t length) {
+void HTTPConnection::consumeContentRemaining(size_t length) {
     if (_expectedContentRemaining) {
         _expectedContentRemaining = *_expectedContentRemaining - (ssize_t)length;
         if (*_expectedContentRemaining < 0) {
@@ -240,20 +303,23 @@ std::string HTTPConnection::formatChunk(const Byte *data, size_t length) {
             }
         }
     }
-    if (_chunkingOutput && length != 0) {
-        std::string chunk;
-        chunk = StrUtil::format("%x\r\n", length);
-        chunk.append((const char *)data, length);
-        chunk.append("\r\n");
-        return chunk;
-    } else {
-        return std::string{(const char *)data, length};
+}
+
+void HTTPConnection::formatChunk(BufferChain &chunk, std::string prefix) {
+    consumeContentRemaining(chunk.size());
+    if (_chunkingOutput && !chunk.empty()) {
+        char length[32];
+        prefix.append(length, (size_t)snprintf(length, sizeof(length), "%zx\r\n", chunk.size()));
+        // The trailer goes into its own buffer, so a payload shared between connections is never copied
+        chunk.append(std::string("\r\n"));
     }
+    chunk.prepend(std::move(prefix));
 }
 
 void HTTPConnection::readHeaders() {
     _state = READ_HEADER;
-    readUntilRegex("\r?\n\r?\n", _maxHeaderSize);
+    static const boost::regex headerEnd("\r?\n\r?\n");
+    readUntilRegex(headerEnd, _maxHeaderSize);
     if (_headerTimeout != 0.0) {
         _headerTimeoutCall = reactor()->callLater(_headerTimeout, [this, self=shared_from_this()]() {
             try {
@@ -321,27 +387,60 @@ void HTTPConnection::readBody() {
     readFinished();
 }
 
+void HTTPConnection::continueReading() {
+    switch (_state) {
+        case READ_HEADER: {
+            readBody();
+            break;
+        }
+        case READ_FIXED_BODY: {
+            if (_bytesRead < _bytesToRead) {
+                readFixedBodyBlock();
+            } else {
+                readFinished();
+            }
+            break;
+        }
+        case READ_CHUNK_DATA: {
+            if (_bytesRead < _bytesToRead) {
+                readChunkDataBlock();
+            } else {
+                readChunkEnds();
+            }
+            break;
+        }
+        default: {
+            NET4CXX_ASSERT_MSG(false, "Unreachable");
+            break;
+        }
+    }
+}
+
 void HTTPConnection::onHeaders(char *data, size_t length) {
     if (_headerTimeoutCall.active()) {
         _headerTimeoutCall.cancel();
     }
-    std::string startLine;
-    std::tie(startLine, _requestHeaders) = HTTPUtil::parseHeaders(data, length);
+    _requestHeaders = allocateShared<HTTPHeaders>(_arena);
+    std::string startLine = HTTPUtil::parseHeaders(data, length, *_requestHeaders);
     _requestStartLine = HTTPUtil::parseRequestStartLine(startLine);
     _disconnectOnFinish = !canKeepAlive(_requestStartLine, *_requestHeaders);
     onHeadersReceived();
     if (_requestHeaders->get("Expect") == "100-continue" && !_writeFinished) {
         write("HTTP/1.1 100 (Continue)\r\n\r\n");
     }
-    readBody();
+    if (_readingPaused) {
+        _readPending = true;
+    } else {
+        continueReading();
+    }
 }
 
 void HTTPConnection::onFixedBody(char *data, size_t length) {
     onDataReceived(data, length);
-    if (_bytesRead < _bytesToRead) {
-        readFixedBodyBlock();
+    if (_readingPaused) {
+        _readPending = true;
     } else {
-        readFinished();
+        continueReading();
     }
 }
 
@@ -361,10 +460,10 @@ void HTTPConnection::onChunkLength(char *data, size_t length) {
 
 void HTTPConnection::onChunkData(char *data, size_t length) {
     onDataReceived(data, length);
-    if (_bytesRead < _bytesToRead) {
-        readChunkDataBlock();
+    if (_readingPaused) {
+        _readPending = true;
     } else {
-        readChunkEnds();
+        continueReading();
     }
 }
 
@@ -524,8 +623,8 @@ HTTPServerRequest::HTTPServerRequest(const std::shared_ptr<HTTPConnection> &conn
     }
     std::tie(_hostName, std::ignore) = HTTPUtil::splitHostAndPort(boost::to_lower_copy(_host));
     std::tie(_path, std::ignore, _query) = StrUtil::partition(_uri, "?");
-    _arguments = UrlParse::parseQS(_query, true);
-    _queryArguments = _arguments;
+    UrlParse::parseQS(_query, _queryArguments, true);
+    _arguments = _queryArguments;
 #ifdef NET4CXX_DEBUG
     NET4CXX_Watcher->inc(WatchKeys::HTTPServerRequestCount);
 #endif
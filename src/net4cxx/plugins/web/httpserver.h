@@ -8,6 +8,7 @@
 #include "net4cxx/common/common.h"
 #include "net4cxx/common/httputils/cookie.h"
 #include "net4cxx/common/httputils/urlparse.h"
+#include "net4cxx/common/utilities/arena.h"
 #include "net4cxx/core/protocols/iostream.h"
 #include "net4cxx/plugins/web/httputil.h"
 #include "net4cxx/plugins/web/util.h"
@@ -58,9 +59,16 @@ public:
 
     void onDisconnected(std::exception_ptr reason) override;
 
-    void writeHeaders(ResponseStartLine startLine, HTTPHeaders &headers, const Byte *chunk = nullptr, size_t length = 0,
+    void writeHeaders(ResponseStartLine startLine, HTTPHeaders &headers, BufferChain &&chunk,
                       WriteCallbackType callback = nullptr);
 
+    void writeHeaders(ResponseStartLine startLine, HTTPHeaders &headers, const Byte *chunk = nullptr, size_t length = 0,
+                      WriteCallbackType callback = nullptr) {
+        BufferChain data;
+        data.append(chunk, length);
+        writeHeaders(std::move(startLine), headers, std::move(data), std::move(callback));
+    }
+
     void writeHeaders(ResponseStartLine startLine, HTTPHeaders &headers, const ByteArray &chunk,
                       WriteCallbackType callback = nullptr) {
         writeHeaders(std::move(startLine), headers, chunk.data(), chunk.size(), std::move(callback));
@@ -76,7 +84,13 @@ public:
         writeHeaders(std::move(startLine), headers, (const Byte *)chunk.c_str(), chunk.size(), std::move(callback));
     }
 
-    void writeChunk(const Byte *chunk, size_t length, WriteCallbackType callback = nullptr);
+    void writeChunk(BufferChain &&chunk, WriteCallbackType callback = nullptr);
+
+    void writeChunk(const Byte *chunk, size_t length, WriteCallbackType callback = nullptr) {
+        BufferChain data;
+        data.append(chunk, length);
+        writeChunk(std::move(data), std::move(callback));
+    }
 
     void writeChunk(const ByteArray &chunk, WriteCallbackType callback = nullptr) {
         writeChunk(chunk.data(), chunk.size(), std::move(callback));
@@ -90,12 +104,40 @@ public:
         writeChunk((const Byte *)chunk.c_str(), chunk.size(), std::move(callback));
     }
 
+    void writeChunk(std::string &&chunk, WriteCallbackType callback = nullptr) {
+        BufferChain data;
+        data.append(std::move(chunk));
+        writeChunk(std::move(data), std::move(callback));
+    }
+
+    void writeFile(FileRegion region, WriteCallbackType callback = nullptr);
+
     void finish();
 
     void setCloseCallback(CloseCallbackType callback) {
         _closeCallback = std::move(callback);
     }
 
+    void pauseReading();
+
+    void resumeReading();
+
+    bool readingPaused() const {
+        return _readingPaused;
+    }
+
+    void setMaxBodySize(size_t maxBodySize) {
+        _maxBodySize = maxBodySize;
+    }
+
+    size_t getMaxBodySize() const {
+        return _maxBodySize;
+    }
+
+    const ArenaPtr& getArena() const {
+        return _arena;
+    }
+
     void close(std::exception_ptr reason) override;
 
     bool getNoKeepAlive() const {
@@ -121,12 +163,16 @@ protected:
 
     void startRequest();
 
-    std::string formatChunk(const Byte *data, size_t length);
+    void consumeContentRemaining(size_t length);
+
+    void formatChunk(BufferChain &chunk, std::string prefix={});
 
     void readHeaders();
 
     void readBody();
 
+    void continueReading();
+
     void readFixedBody(size_t contentLength) {
         if (contentLength != 0) {
             _bytesRead = 0;
@@ -139,7 +185,7 @@ protected:
 
     void readFixedBodyBlock() {
         _state = READ_FIXED_BODY;
-        readBytes(std::min(_chunkSize, _bytesToRead));
+        readBytes(std::min(_chunkSize, _bytesToRead - _bytesRead));
     }
 
     void readChunkLength() {
@@ -155,7 +201,7 @@ protected:
 
     void readChunkDataBlock() {
         _state = READ_CHUNK_DATA;
-        readBytes(std::min(_chunkSize, _bytesToRead));
+        readBytes(std::min(_chunkSize, _bytesToRead - _bytesRead));
     }
 
     void readChunkEnds() {
@@ -218,10 +264,13 @@ protected:
     RequestStartLine _requestStartLine;
     ResponseStartLine _responseStartLine;
     std::shared_ptr<RequestDispatcher> _dispatcher;
+    ArenaPtr _arena;
     bool _chunkingOutput{false};
     bool _pendingWrite{false};
     bool _readFinished{false};
     bool _writeFinished{false};
+    bool _readingPaused{false};
+    bool _readPending{false};
     WriteCallbackType _writeCallback{nullptr};
     CloseCallbackType _closeCallback{nullptr};
     std::unique_ptr<GzipDecompressor> _decompressor;
@@ -3,6 +3,7 @@
 //
 
 #include "net4cxx/plugins/web/httputil.h"
+#include <boost/filesystem.hpp>
 #include "net4cxx/common/httputils/cookie.h"
 #include "net4cxx/shared/global/loggers.h"
 
@@ -75,23 +76,35 @@ std::string HTTPHeaders::get(const std::string &name, const std::string &default
 }
 
 void HTTPHeaders::parseLines(const std::string &headers) {
-    StringVector lines = StrUtil::splitLines(headers);
-    for (auto &line: lines) {
-        if (!line.empty()) {
+    std::string line;
+    size_t i = 0, j = 0, length = headers.size();
+    while (i < length) {
+        while (i < length && headers[i] != '\r' && headers[i] != '\n') {
+            ++i;
+        }
+        if (i != j) {
+            line.assign(headers, j, i - j);
             parseLine(line);
         }
+        if (i < length) {
+            i += headers[i] == '\r' && i + 1 < length && headers[i + 1] == '\n' ? 2 : 1;
+        }
+        j = i;
     }
 }
 
 std::string HTTPHeaders::normalizeName(const std::string &name) {
-//    if (boost::regex_match(name, HTTPHeaders::_normalizedHeader)) {
-//        return name;
-//    }
-    StringVector nameParts = StrUtil::split(name, '-');
-    for (auto &namePart: nameParts) {
-        StrUtil::capitalize(namePart);
+    std::string normName(name);
+    bool upper = true;
+    for (char &c: normName) {
+        if (c == '-') {
+            upper = true;
+        } else {
+            c = (char)(upper ? std::toupper((unsigned char)c) : std::tolower((unsigned char)c));
+            upper = false;
+        }
     }
-    return boost::join(nameParts, "-");
+    return normName;
 }
 
 
@@ -152,33 +165,16 @@ void HTTPUtil::parseBodyArguments(const std::string &contentType, const std::str
         return;
     }
     if (boost::starts_with(contentType, "application/x-www-form-urlencoded")) {
-        QueryArgListMap uriArguments;
         try {
-            uriArguments = UrlParse::parseQS(body, true);
+            UrlParse::parseQS(body, arguments, true);
         } catch (std::exception &e) {
             NET4CXX_LOG_WARN(gGenLog, "Invalid x-www-form-urlencoded body: %s", e.what());
         }
-        for (auto &nv: uriArguments) {
-            if (!nv.second.empty()) {
-                for (auto &value: nv.second) {
-                    arguments[nv.first].push_back(std::move(value));
-                }
-            }
-        }
     } else if (boost::starts_with(contentType, "multipart/form-data")) {
-        StringVector fields = StrUtil::split(contentType, ';');
-        bool found = false;
-        std::string k, sep, v;
-        for (auto &field: fields) {
-            boost::trim(field);
-            std::tie(k, sep, v) = StrUtil::partition(field, "=");
-            if (k == "boundary" && !v.empty()) {
-                HTTPUtil::parseMultipartFormData(std::move(v), body, arguments, files);
-                found = true;
-                break;
-            }
-        }
-        if (!found) {
+        std::string boundary = MultipartParser::getBoundary(contentType);
+        if (!boundary.empty()) {
+            HTTPUtil::parseMultipartFormData(std::move(boundary), body, arguments, files);
+        } else {
             NET4CXX_LOG_WARN(gGenLog, "Invalid multipart/form-data");
         }
     }
@@ -250,7 +246,7 @@ RequestStartLine HTTPUtil::parseRequestStartLine(const std::string &line) {
     std::string method = std::move(requestLineComponents[0]);
     std::string path = std::move(requestLineComponents[1]);
     std::string version = std::move(requestLineComponents[2]);
-    const boost::regex versionPat(R"(HTTP/1\.[0-9])");
+    static const boost::regex versionPat(R"(HTTP/1\.[0-9])");
     if (!boost::regex_match(version, versionPat)) {
         NET4CXX_THROW_EXCEPTION(HTTPInputError, "Malformed HTTP version in HTTP Request-Line: %s", version);
     }
@@ -258,7 +254,7 @@ RequestStartLine HTTPUtil::parseRequestStartLine(const std::string &line) {
 }
 
 ResponseStartLine HTTPUtil::parseResponseStartLine(const std::string &line) {
-    const boost::regex firstLinePattern("(HTTP/1.[0-9]) ([0-9]+) ([^\r]*).*");
+    static const boost::regex firstLinePattern("(HTTP/1.[0-9]) ([0-9]+) ([^\r]*).*");
     boost::smatch match;
     if (!boost::regex_match(line, match, firstLinePattern)) {
         NET4CXX_THROW_EXCEPTION(HTTPInputError, "Error parsing response start line");
@@ -266,8 +262,20 @@ ResponseStartLine HTTPUtil::parseResponseStartLine(const std::string &line) {
     return ResponseStartLine(match[1], std::stoi(match[2]), match[3]);
 }
 
+const std::string& HTTPUtil::formatCurrentTimestamp() {
+    // Formatted once per second and per thread
+    static thread_local time_t cachedTime = 0;
+    static thread_local std::string cachedTimestamp;
+    time_t now = time(nullptr);
+    if (now != cachedTime || cachedTimestamp.empty()) {
+        cachedTimestamp = formatTimestamp(now);
+        cachedTime = now;
+    }
+    return cachedTimestamp;
+}
+
 std::tuple<std::string, boost::optional<unsigned short>> HTTPUtil::splitHostAndPort(const std::string &netloc) {
-    const boost::regex pat(R"(^(.+):(\d+)$)");
+    static const boost::regex pat(R"(^(.+):(\d+)$)");
     boost::smatch match;
     std::string host;
     boost::optional<unsigned short> port;
@@ -291,6 +299,12 @@ QueryArgList HTTPUtil::QStoQSL(const QueryArgListMap &args) {
 }
 
 std::tuple<std::string, std::shared_ptr<HTTPHeaders>> HTTPUtil::parseHeaders(const char *data, size_t length) {
+    auto headers = std::make_shared<HTTPHeaders>();
+    auto startLine = parseHeaders(data, length, *headers);
+    return std::make_tuple(std::move(startLine), std::move(headers));
+}
+
+std::string HTTPUtil::parseHeaders(const char *data, size_t length, HTTPHeaders &headers) {
     boost::string_view dv{data, length};
     dv.remove_prefix(std::min(dv.find_first_not_of("\r\n"), dv.size()));
     auto eol = dv.find('\n');
@@ -302,8 +316,8 @@ std::tuple<std::string, std::shared_ptr<HTTPHeaders>> HTTPUtil::parseHeaders(con
     } else {
         startLine.assign(dv.begin(), dv.end());
     }
-    auto headers = HTTPHeaders::parse(rest);
-    return std::make_tuple(std::move(startLine), std::move(headers));
+    headers.parseLines(rest);
+    return startLine;
 }
 
 StringMap HTTPUtil::parseCookie(const std::string &cookie) {
@@ -416,4 +430,202 @@ StringVector HTTPError::getCustomErrorInfo() const {
     return errorInfo;
 }
 
+SpooledFile::~SpooledFile() {
+    if (_owned) {
+        boost::system::error_code ec;
+        boost::filesystem::remove(_path, ec);
+    }
+}
+
+void SpooledFile::moveTo(const std::string &path) {
+    boost::system::error_code ec;
+    boost::filesystem::rename(_path, path, ec);
+    if (ec) {
+        boost::filesystem::copy_file(_path, path, boost::filesystem::copy_option::overwrite_if_exists);
+        boost::filesystem::remove(_path, ec);
+    }
+    _path = path;
+    _owned = false;
+}
+
+
+constexpr size_t MultipartParser::DEFAULT_SPOOL_THRESHOLD;
+constexpr size_t MultipartParser::MAX_HEADER_SIZE;
+
+MultipartParser::MultipartParser(std::string boundary, QueryArgListMap &arguments, HTTPFileListMap &files,
+                                 std::string spoolDirectory, size_t spoolThreshold)
+        : _buffer("\r\n")
+        , _arguments(arguments)
+        , _files(files)
+        , _spoolDirectory(std::move(spoolDirectory))
+        , _spoolThreshold(spoolThreshold) {
+    if (boost::starts_with(boundary, "\"") && boost::ends_with(boundary, "\"") && boundary.length() >= 2) {
+        boundary = boundary.substr(1, boundary.length() - 2);
+    }
+    if (boundary.empty()) {
+        NET4CXX_THROW_EXCEPTION(HTTPError, "Invalid multipart/form-data boundary") << errinfo_http_code(400);
+    }
+    // The leading CRLF in the buffer lets the first boundary match the same delimiter as the others
+    _delimiter = "\r\n--" + boundary;
+}
+
+void MultipartParser::feed(const char *data, size_t length) {
+    if (_state == PARSE_DONE) {
+        return;
+    }
+    _buffer.append(data, length);
+    size_t pos;
+    for (;;) {
+        switch (_state) {
+            case PARSE_PREAMBLE: {
+                pos = _buffer.find(_delimiter);
+                if (pos == std::string::npos) {
+                    if (_buffer.size() >= _delimiter.size()) {
+                        _buffer.erase(0, _buffer.size() - _delimiter.size() + 1);
+                    }
+                    return;
+                }
+                _buffer.erase(0, pos + _delimiter.size());
+                _state = PARSE_BOUNDARY;
+                break;
+            }
+            case PARSE_BOUNDARY: {
+                if (_buffer.size() < 2) {
+                    return;
+                }
+                if (_buffer.compare(0, 2, "--") == 0) {
+                    _buffer.clear();
+                    _state = PARSE_DONE;
+                    return;
+                }
+                if (_buffer.compare(0, 2, "\r\n") != 0) {
+                    NET4CXX_THROW_EXCEPTION(HTTPError, "Invalid multipart/form-data boundary")
+                            << errinfo_http_code(400);
+                }
+                _buffer.erase(0, 2);
+                _state = PARSE_HEADERS;
+                break;
+            }
+            case PARSE_HEADERS: {
+                pos = _buffer.find("\r\n\r\n");
+                if (pos == std::string::npos) {
+                    if (_buffer.size() > MAX_HEADER_SIZE) {
+                        NET4CXX_THROW_EXCEPTION(HTTPError, "multipart/form-data headers too large")
+                                << errinfo_http_code(400);
+                    }
+                    return;
+                }
+                startPart(_buffer.substr(0, pos));
+                _buffer.erase(0, pos + 4);
+                _state = PARSE_BODY;
+                break;
+            }
+            case PARSE_BODY: {
+                pos = _buffer.find(_delimiter);
+                if (pos == std::string::npos) {
+                    // Keep enough bytes to match a delimiter split across two chunks
+                    size_t keep = _delimiter.size() - 1;
+                    if (_buffer.size() > keep) {
+                        writePart(_buffer.data(), _buffer.size() - keep);
+                        _buffer.erase(0, _buffer.size() - keep);
+                    }
+                    return;
+                }
+                writePart(_buffer.data(), pos);
+                finishPart();
+                _buffer.erase(0, pos + _delimiter.size());
+                _state = PARSE_BOUNDARY;
+                break;
+            }
+            default: {
+                return;
+            }
+        }
+    }
+}
+
+void MultipartParser::finish() {
+    if (_state != PARSE_DONE) {
+        _spoolStream.close();
+        _spooledFile.reset();
+        NET4CXX_THROW_EXCEPTION(HTTPError, "Invalid multipart/form-data: no final boundary") << errinfo_http_code(400);
+    }
+}
+
+std::string MultipartParser::getBoundary(const std::string &contentType) {
+    StringVector fields = StrUtil::split(contentType, ';');
+    std::string k, sep, v;
+    for (auto &field: fields) {
+        boost::trim(field);
+        std::tie(k, sep, v) = StrUtil::partition(field, "=");
+        if (k == "boundary" && !v.empty()) {
+            return v;
+        }
+    }
+    return {};
+}
+
+void MultipartParser::startPart(const std::string &lines) {
+    HTTPHeaders headers;
+    headers.parseLines(lines);
+    std::string disposition;
+    StringMap dispParams;
+    std::tie(disposition, dispParams) = HTTPUtil::parseHeader(headers.get("Content-Disposition"));
+    if (disposition != "form-data") {
+        NET4CXX_THROW_EXCEPTION(HTTPError, "Invalid multipart/form-data") << errinfo_http_code(400);
+    }
+    auto nameIter = dispParams.find("name");
+    if (nameIter == dispParams.end()) {
+        NET4CXX_THROW_EXCEPTION(HTTPError, "multipart/form-data value missing name") << errinfo_http_code(400);
+    }
+    _name = std::move(nameIter->second);
+    auto fileNameIter = dispParams.find("filename");
+    _isFile = fileNameIter != dispParams.end();
+    if (_isFile) {
+        _fileName = std::move(fileNameIter->second);
+        _contentType = headers.get("Content-Type", "application/unknown");
+    }
+    _body.clear();
+}
+
+void MultipartParser::writePart(const char *data, size_t length) {
+    if (_isFile && !_spooledFile && !_spoolDirectory.empty() && _body.size() + length > _spoolThreshold) {
+        auto path = boost::filesystem::path(_spoolDirectory) /
+                    boost::filesystem::unique_path("net4cxx-%%%%-%%%%-%%%%-%%%%");
+        _spooledFile = std::make_shared<SpooledFile>(path.string());
+        _spoolStream.clear();
+        _spoolStream.open(path.string(), std::ios::binary | std::ios::trunc);
+        if (!_spoolStream) {
+            NET4CXX_THROW_EXCEPTION(IOError, "Open spool file %s failed", path.string());
+        }
+        data = (const char *)_body.append(data, length).data();
+        length = _body.size();
+    }
+    if (_spooledFile) {
+        _spoolStream.write(data, (std::streamsize)length);
+        if (!_spoolStream) {
+            NET4CXX_THROW_EXCEPTION(IOError, "Write spool file %s failed", _spooledFile->getPath());
+        }
+        _spooledFile->setSize(_spooledFile->getSize() + length);
+        _body.clear();
+    } else {
+        _body.append(data, length);
+    }
+}
+
+void MultipartParser::finishPart() {
+    if (!_isFile) {
+        _arguments[_name].emplace_back(std::move(_body));
+    } else if (_spooledFile) {
+        _spoolStream.close();
+        if (!_spoolStream) {
+            NET4CXX_THROW_EXCEPTION(IOError, "Close spool file %s failed", _spooledFile->getPath());
+        }
+        _files[_name].emplace_back(HTTPFile(std::move(_fileName), std::move(_contentType), std::move(_spooledFile)));
+    } else {
+        _files[_name].emplace_back(HTTPFile(std::move(_fileName), std::move(_contentType), std::move(_body)));
+    }
+    _body.clear();
+}
+
 NS_END
\ No newline at end of file
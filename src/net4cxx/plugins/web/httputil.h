@@ -6,6 +6,7 @@
 #define NET4CXX_PLUGINS_WEB_HTTPUTIL_H
 
 #include "net4cxx/common/common.h"
+#include <fstream>
 #include "net4cxx/common/debugging/assert.h"
 #include "net4cxx/common/httputils/httplib.h"
 #include "net4cxx/common/httputils/urlparse.h"
@@ -130,6 +131,35 @@ protected:
 NET4CXX_COMMON_API std::ostream& operator<<(std::ostream &os, const HTTPHeaders &headers);
 
 
+class NET4CXX_COMMON_API SpooledFile: public boost::noncopyable {
+public:
+    explicit SpooledFile(std::string path)
+            : _path(std::move(path)) {
+
+    }
+
+    ~SpooledFile();
+
+    const std::string& getPath() const {
+        return _path;
+    }
+
+    size_t getSize() const {
+        return _size;
+    }
+
+    void setSize(size_t size) {
+        _size = size;
+    }
+
+    void moveTo(const std::string &path);
+protected:
+    std::string _path;
+    size_t _size{0};
+    bool _owned{true};
+};
+
+
 class NET4CXX_COMMON_API HTTPFile {
 public:
     HTTPFile(std::string fileName,
@@ -141,6 +171,15 @@ public:
 
     }
 
+    HTTPFile(std::string fileName,
+             std::string contentType,
+             std::shared_ptr<SpooledFile> spooledFile)
+            : _fileName(std::move(fileName))
+            , _contentType(std::move(contentType))
+            , _spooledFile(std::move(spooledFile)) {
+
+    }
+
     const std::string& getFileName() const {
         return _fileName;
     }
@@ -152,10 +191,19 @@ public:
     const std::string& getBody() const {
         return _body;
     }
+
+    const std::shared_ptr<SpooledFile>& getSpooledFile() const {
+        return _spooledFile;
+    }
+
+    size_t getSize() const {
+        return _spooledFile ? _spooledFile->getSize() : _body.size();
+    }
 protected:
     std::string _fileName;
     std::string _contentType;
     std::string _body;
+    std::shared_ptr<SpooledFile> _spooledFile;
 };
 
 
@@ -224,6 +272,8 @@ public:
 
 class NET4CXX_COMMON_API HTTPUtil {
 public:
+    friend class MultipartParser;
+
     static std::string urlConcat(std::string url, const QueryArgMap &args);
 
     static std::string urlConcat(std::string url, const QueryArgList &args);
@@ -246,6 +296,8 @@ public:
         return formatTimestamp(boost::posix_time::ptime_from_tm(ts));
     }
 
+    static const std::string& formatCurrentTimestamp();
+
     static std::string getHTTPReason(int statusCode) {
         auto iter = HTTP_STATUS_CODES.find(statusCode);
         return iter != HTTP_STATUS_CODES.end() ? iter->second : "Unknown";
@@ -265,6 +317,8 @@ public:
 
     static std::tuple<std::string, std::shared_ptr<HTTPHeaders>> parseHeaders(const char *data, size_t length);
 
+    static std::string parseHeaders(const char *data, size_t length, HTTPHeaders &headers);
+
     static StringMap parseCookie(const std::string &cookie);
 protected:
     static StringVector parseParam(std::string s);
@@ -295,6 +349,60 @@ protected:
 };
 
 
+class NET4CXX_COMMON_API MultipartParser: public boost::noncopyable {
+public:
+    enum State {
+        PARSE_PREAMBLE,
+        PARSE_BOUNDARY,
+        PARSE_HEADERS,
+        PARSE_BODY,
+        PARSE_DONE,
+    };
+
+    MultipartParser(std::string boundary, QueryArgListMap &arguments, HTTPFileListMap &files,
+                    std::string spoolDirectory={}, size_t spoolThreshold=DEFAULT_SPOOL_THRESHOLD);
+
+    void feed(const char *data, size_t length);
+
+    void feed(const std::string &data) {
+        feed(data.data(), data.size());
+    }
+
+    void finish();
+
+    bool finished() const {
+        return _state == PARSE_DONE;
+    }
+
+    static std::string getBoundary(const std::string &contentType);
+
+    static constexpr size_t DEFAULT_SPOOL_THRESHOLD = 65536;
+
+    static constexpr size_t MAX_HEADER_SIZE = 16384;
+protected:
+    void startPart(const std::string &lines);
+
+    void writePart(const char *data, size_t length);
+
+    void finishPart();
+
+    State _state{PARSE_PREAMBLE};
+    std::string _delimiter;
+    std::string _buffer;
+    QueryArgListMap &_arguments;
+    HTTPFileListMap &_files;
+    std::string _spoolDirectory;
+    size_t _spoolThreshold;
+    std::string _name;
+    bool _isFile{false};
+    std::string _fileName;
+    std::string _contentType;
+    std::string _body;
+    std::shared_ptr<SpooledFile> _spooledFile;
+    std::ofstream _spoolStream;
+};
+
+
 NS_END
 
 #endif //NET4CXX_PLUGINS_WEB_HTTPUTIL_H
@@ -0,0 +1,180 @@
+//
+// Created by yuwenyong.vincent on 2019-03-18.
+//
+
+#include "net4cxx/plugins/web/limiter.h"
+#include "net4cxx/core/network/reactor.h"
+
+
+NS_BEGIN
+
+
+void ConcurrencyPermit::release() {
+    if (_limiter) {
+        auto limiter = std::move(_limiter);
+        _limiter.reset();
+        limiter->release(nullptr, false);
+    }
+}
+
+void ConcurrencyPermit::release(bool dropped) {
+    if (_limiter) {
+        auto limiter = std::move(_limiter);
+        _limiter.reset();
+        Duration latency = TimestampClock::now() - _start;
+        limiter->release(&latency, dropped);
+    }
+}
+
+
+constexpr double ConcurrencyLimiter::GRADIENT_SMOOTHING;
+constexpr size_t ConcurrencyLimiter::GRADIENT_PROBE_INTERVAL;
+
+ConcurrencyLimiter::Admission ConcurrencyLimiter::acquire(Reactor *reactor, CallbackType callback) {
+    auto waiter = std::make_shared<Waiter>();
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        if (_inFlight < (size_t)_limit) {
+            ++_inFlight;
+            ++_admitted;
+            return ADMITTED;
+        }
+        if (_waiters.size() >= _maxQueueSize) {
+            ++_rejected;
+            return REJECTED;
+        }
+        waiter->reactor = reactor;
+        waiter->callback = std::move(callback);
+        if (_queueTimeout > 0.0) {
+            waiter->deadline = TimestampClock::now() + std::chrono::duration_cast<Duration>(
+                    std::chrono::duration<double>(_queueTimeout));
+        } else {
+            waiter->deadline = Timestamp::max();
+        }
+        _waiters.emplace_back(waiter);
+    }
+    if (_queueTimeout > 0.0) {
+        waiter->timeout = reactor->callLater(_queueTimeout, [self=shared_from_this(), waiter]() {
+            self->expire(waiter);
+        });
+    }
+    return QUEUED;
+}
+
+void ConcurrencyLimiter::setAdaptive(AdaptivePolicy policy, size_t minLimit, size_t maxLimit) {
+    NET4CXX_ASSERT_THROW(minLimit >= 1 && minLimit <= maxLimit, "Invalid adaptive limit range [%u, %u]", minLimit,
+                         maxLimit);
+    std::lock_guard<std::mutex> lock(_lock);
+    _policy = policy;
+    _minLimit = minLimit;
+    _maxLimit = maxLimit;
+    _limit = std::min(std::max(_limit, (double)_minLimit), (double)_maxLimit);
+    _noLoadLatency = 0.0;
+    _samples = 0;
+}
+
+size_t ConcurrencyLimiter::getLimit() const {
+    std::lock_guard<std::mutex> lock(_lock);
+    return (size_t)_limit;
+}
+
+size_t ConcurrencyLimiter::getInFlight() const {
+    std::lock_guard<std::mutex> lock(_lock);
+    return _inFlight;
+}
+
+size_t ConcurrencyLimiter::getQueueSize() const {
+    std::lock_guard<std::mutex> lock(_lock);
+    return _waiters.size();
+}
+
+uint64_t ConcurrencyLimiter::getAdmittedCount() const {
+    std::lock_guard<std::mutex> lock(_lock);
+    return _admitted;
+}
+
+uint64_t ConcurrencyLimiter::getRejectedCount() const {
+    std::lock_guard<std::mutex> lock(_lock);
+    return _rejected;
+}
+
+uint64_t ConcurrencyLimiter::getTimeoutCount() const {
+    std::lock_guard<std::mutex> lock(_lock);
+    return _timedOut;
+}
+
+void ConcurrencyLimiter::release(const Duration *latency, bool dropped) {
+    std::vector<std::pair<WaiterPtr, bool>> outcomes;
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        if (latency && _policy != FIXED) {
+            updateLimit(std::chrono::duration_cast<std::chrono::duration<double>>(*latency).count(), dropped);
+        }
+        --_inFlight;
+        auto now = TimestampClock::now();
+        while (!_waiters.empty() && _inFlight < (size_t)_limit) {
+            auto waiter = std::move(_waiters.front());
+            _waiters.pop_front();
+            waiter->done = true;
+            if (waiter->deadline <= now) {
+                ++_timedOut;
+                outcomes.emplace_back(std::move(waiter), false);
+            } else {
+                ++_inFlight;
+                ++_admitted;
+                outcomes.emplace_back(std::move(waiter), true);
+            }
+        }
+    }
+    for (auto &outcome: outcomes) {
+        notify(outcome.first, outcome.second);
+    }
+}
+
+void ConcurrencyLimiter::expire(const WaiterPtr &waiter) {
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        if (waiter->done) {
+            return;
+        }
+        waiter->done = true;
+        _waiters.erase(std::find(_waiters.begin(), _waiters.end(), waiter));
+        ++_timedOut;
+    }
+    waiter->callback(false);
+}
+
+void ConcurrencyLimiter::updateLimit(double latency, bool dropped) {
+    if (dropped) {
+        _limit *= _backoffRatio;
+    } else if (_policy == AIMD) {
+        if (latency > _latencyThreshold) {
+            _limit *= _backoffRatio;
+        } else if ((double)_inFlight * 2.0 >= _limit) {
+            _limit += 1.0;
+        }
+    } else {
+        // Re-probe the no-load latency now and then, it may have moved since it was measured
+        if (_noLoadLatency == 0.0 || latency < _noLoadLatency || ++_samples % GRADIENT_PROBE_INTERVAL == 0) {
+            _noLoadLatency = latency;
+        }
+        double gradient = latency > 0.0 ? std::max(0.5, std::min(1.0, _noLoadLatency / latency)) : 1.0;
+        double newLimit = _limit * gradient + std::sqrt(_limit);
+        // Don't grow a limit the traffic isn't reaching
+        if (newLimit <= _limit || (double)_inFlight * 2.0 >= _limit) {
+            _limit = _limit * (1.0 - GRADIENT_SMOOTHING) + newLimit * GRADIENT_SMOOTHING;
+        }
+    }
+    _limit = std::min(std::max(_limit, (double)_minLimit), (double)_maxLimit);
+}
+
+void ConcurrencyLimiter::notify(const WaiterPtr &waiter, bool admitted) {
+    waiter->reactor->addCallback([waiter, admitted]() {
+        if (!waiter->timeout.cancelled()) {
+            waiter->timeout.cancel();
+        }
+        waiter->callback(admitted);
+    });
+}
+
+NS_END
@@ -0,0 +1,192 @@
+//
+// Created by yuwenyong.vincent on 2019-03-18.
+//
+
+#ifndef NET4CXX_PLUGINS_WEB_LIMITER_H
+#define NET4CXX_PLUGINS_WEB_LIMITER_H
+
+#include "net4cxx/common/common.h"
+#include <deque>
+#include <mutex>
+#include "net4cxx/core/network/base.h"
+
+
+NS_BEGIN
+
+
+class Reactor;
+class ConcurrencyLimiter;
+using ConcurrencyLimiterPtr = std::shared_ptr<ConcurrencyLimiter>;
+
+
+class NET4CXX_COMMON_API ConcurrencyPermit {
+public:
+    ConcurrencyPermit() = default;
+
+    explicit ConcurrencyPermit(ConcurrencyLimiterPtr limiter)
+            : _limiter(std::move(limiter))
+            , _start(TimestampClock::now()) {
+
+    }
+
+    ConcurrencyPermit(const ConcurrencyPermit &) = delete;
+
+    ConcurrencyPermit(ConcurrencyPermit &&rhs) noexcept
+            : _limiter(std::move(rhs._limiter))
+            , _start(rhs._start) {
+
+    }
+
+    ConcurrencyPermit& operator=(const ConcurrencyPermit &) = delete;
+
+    ConcurrencyPermit& operator=(ConcurrencyPermit &&rhs) noexcept {
+        if (this != &rhs) {
+            release();
+            _limiter = std::move(rhs._limiter);
+            _start = rhs._start;
+        }
+        return *this;
+    }
+
+    ~ConcurrencyPermit() {
+        release();
+    }
+
+    // Gives the permit back without feeding the adaptive limit, e.g. when the client went away
+    void release();
+
+    void release(bool dropped);
+protected:
+    ConcurrencyLimiterPtr _limiter;
+    Timestamp _start;
+};
+
+
+// Thread safe, one limiter may be shared by the handlers of every reactor
+class NET4CXX_COMMON_API ConcurrencyLimiter: public std::enable_shared_from_this<ConcurrencyLimiter> {
+public:
+    typedef std::function<void (bool)> CallbackType;
+
+    enum Admission {
+        ADMITTED,
+        QUEUED,
+        REJECTED,
+    };
+
+    enum AdaptivePolicy {
+        FIXED,
+        AIMD,
+        GRADIENT,
+    };
+
+    friend class ConcurrencyPermit;
+
+    explicit ConcurrencyLimiter(size_t limit, size_t maxQueueSize=0, double queueTimeout=1.0)
+            : _limit((double)std::max(limit, (size_t)1))
+            , _maxQueueSize(maxQueueSize)
+            , _queueTimeout(queueTimeout)
+            , _minLimit(1)
+            , _maxLimit(std::max(limit, (size_t)1)) {
+
+    }
+
+    // Either admits at once or queues the callback, which is later run on the given reactor with the outcome
+    Admission acquire(Reactor *reactor, CallbackType callback);
+
+    void setAdaptive(AdaptivePolicy policy, size_t minLimit, size_t maxLimit);
+
+    AdaptivePolicy getAdaptivePolicy() const {
+        return _policy;
+    }
+
+    void setLatencyThreshold(double latencyThreshold) {
+        _latencyThreshold = latencyThreshold;
+    }
+
+    double getLatencyThreshold() const {
+        return _latencyThreshold;
+    }
+
+    void setBackoffRatio(double backoffRatio) {
+        _backoffRatio = backoffRatio;
+    }
+
+    double getBackoffRatio() const {
+        return _backoffRatio;
+    }
+
+    void setRetryAfter(int retryAfter) {
+        _retryAfter = retryAfter;
+    }
+
+    int getRetryAfter() const {
+        return _retryAfter;
+    }
+
+    size_t getMaxQueueSize() const {
+        return _maxQueueSize;
+    }
+
+    double getQueueTimeout() const {
+        return _queueTimeout;
+    }
+
+    size_t getLimit() const;
+
+    size_t getInFlight() const;
+
+    size_t getQueueSize() const;
+
+    uint64_t getAdmittedCount() const;
+
+    uint64_t getRejectedCount() const;
+
+    uint64_t getTimeoutCount() const;
+
+    uint64_t getShedCount() const {
+        return getRejectedCount() + getTimeoutCount();
+    }
+
+    static constexpr double GRADIENT_SMOOTHING = 0.2;
+    static constexpr size_t GRADIENT_PROBE_INTERVAL = 1000;
+protected:
+    struct Waiter {
+        Reactor *reactor;
+        CallbackType callback;
+        Timestamp deadline;
+        DelayedCall timeout;
+        bool done{false};
+    };
+
+    using WaiterPtr = std::shared_ptr<Waiter>;
+
+    void release(const Duration *latency, bool dropped);
+
+    void expire(const WaiterPtr &waiter);
+
+    void updateLimit(double latency, bool dropped);
+
+    static void notify(const WaiterPtr &waiter, bool admitted);
+
+    mutable std::mutex _lock;
+    double _limit;
+    size_t _inFlight{0};
+    size_t _maxQueueSize;
+    double _queueTimeout;
+    std::deque<WaiterPtr> _waiters;
+    AdaptivePolicy _policy{FIXED};
+    size_t _minLimit;
+    size_t _maxLimit;
+    double _latencyThreshold{0.5};
+    double _backoffRatio{0.9};
+    double _noLoadLatency{0.0};
+    size_t _samples{0};
+    int _retryAfter{1};
+    uint64_t _admitted{0};
+    uint64_t _rejected{0};
+    uint64_t _timedOut{0};
+};
+
+NS_END
+
+#endif //NET4CXX_PLUGINS_WEB_LIMITER_H
@@ -0,0 +1,285 @@
+//
+// Created by yuwenyong.vincent on 2019-03-19.
+//
+
+#include "net4cxx/plugins/web/metrics.h"
+#include <unordered_map>
+#include "net4cxx/common/compress/compressor.h"
+
+
+NS_BEGIN
+
+
+constexpr int LatencyHistogram::SUB_BUCKET_HALF_COUNT_MAGNITUDE;
+constexpr uint64_t LatencyHistogram::SUB_BUCKET_HALF_COUNT;
+constexpr uint64_t LatencyHistogram::SUB_BUCKET_MASK;
+constexpr int LatencyHistogram::BUCKET_COUNT;
+constexpr size_t LatencyHistogram::COUNTS_LENGTH;
+constexpr uint64_t LatencyHistogram::HIGHEST_TRACKABLE_VALUE;
+
+void LatencyHistogram::merge(const LatencyHistogram &other) {
+    for (size_t i = 0; i != COUNTS_LENGTH; ++i) {
+        auto count = other._counts[i].load(std::memory_order_relaxed);
+        if (count) {
+            increment(_counts[i], count);
+        }
+    }
+    increment(_totalCount, other.getTotalCount());
+    increment(_totalSum, other.getTotalSum());
+    if (other.getMaxValue() > getMaxValue()) {
+        _maxValue.store(other.getMaxValue(), std::memory_order_relaxed);
+    }
+}
+
+uint64_t LatencyHistogram::getValueAtPercentile(double percentile) const {
+    uint64_t totalCount = getTotalCount();
+    if (totalCount == 0) {
+        return 0;
+    }
+    percentile = std::min(std::max(percentile, 0.0), 100.0);
+    auto countAtPercentile = std::max((uint64_t)std::ceil(percentile / 100.0 * (double)totalCount), (uint64_t)1);
+    uint64_t runningCount = 0;
+    for (size_t i = 0; i != COUNTS_LENGTH; ++i) {
+        runningCount += _counts[i].load(std::memory_order_relaxed);
+        if (runningCount >= countAtPercentile) {
+            return std::min(highestEquivalentValue(i), getMaxValue());
+        }
+    }
+    return getMaxValue();
+}
+
+uint64_t LatencyHistogram::highestEquivalentValue(size_t index) {
+    int bucketIndex = (int)(index >> SUB_BUCKET_HALF_COUNT_MAGNITUDE) - 1;
+    auto subBucketIndex = (uint64_t)(index & (SUB_BUCKET_HALF_COUNT - 1)) + SUB_BUCKET_HALF_COUNT;
+    if (bucketIndex < 0) {
+        subBucketIndex -= SUB_BUCKET_HALF_COUNT;
+        bucketIndex = 0;
+    }
+    return (subBucketIndex << bucketIndex) + ((uint64_t)1 << bucketIndex) - 1;
+}
+
+
+const std::vector<double> RequestMetrics::QUANTILES = {0.5, 0.9, 0.99, 0.999};
+
+static std::atomic<uint64_t> nextMetricsId{1};
+
+RequestMetrics::RequestMetrics()
+        : _id(nextMetricsId.fetch_add(1)) {
+
+}
+
+void RequestMetrics::record(const UrlSpec *spec, int statusCode, uint64_t bytesIn, uint64_t bytesOut,
+                            const Duration &queueTime, const Duration &handlerTime) {
+    auto metrics = getRouteMetrics(spec, statusCode);
+    metrics->requests.store(metrics->requests.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    metrics->bytesIn.store(metrics->bytesIn.load(std::memory_order_relaxed) + bytesIn, std::memory_order_relaxed);
+    metrics->bytesOut.store(metrics->bytesOut.load(std::memory_order_relaxed) + bytesOut, std::memory_order_relaxed);
+    metrics->queueTime.record(queueTime);
+    metrics->handlerTime.record(handlerTime);
+}
+
+void RequestMetrics::recordWrite(const UrlSpec *spec, int statusCode, const Duration &writeTime) {
+    getRouteMetrics(spec, statusCode)->writeTime.record(writeTime);
+}
+
+namespace {
+
+struct RouteAggregate {
+    uint64_t requests{0};
+    uint64_t bytesIn{0};
+    uint64_t bytesOut{0};
+    LatencyHistogram queueTime;
+    LatencyHistogram handlerTime;
+    LatencyHistogram writeTime;
+};
+
+std::string escapeLabel(const std::string &value) {
+    std::string escaped;
+    escaped.reserve(value.size());
+    for (char c: value) {
+        if (c == '\\' || c == '"') {
+            escaped.push_back('\\');
+            escaped.push_back(c);
+        } else if (c == '\n') {
+            escaped.append("\\n");
+        } else {
+            escaped.push_back(c);
+        }
+    }
+    return escaped;
+}
+
+std::string formatSeconds(uint64_t microseconds) {
+    return StrUtil::format("%.6f", (double)microseconds / 1000000.0);
+}
+
+}
+
+void RequestMetrics::format(std::string &output) const {
+    typedef std::pair<std::string, int> LabelsType;
+    std::map<LabelsType, std::unique_ptr<RouteAggregate>> aggregates;
+    {
+        std::lock_guard<std::mutex> shardsLock(_shardsLock);
+        for (auto &shard: _shards) {
+            std::lock_guard<std::mutex> lock(shard->lock);
+            for (auto &route: shard->routes) {
+                auto &metrics = *route.second;
+                auto &aggregate = aggregates[LabelsType(metrics.getRoute(), metrics.getStatusClass())];
+                if (!aggregate) {
+                    aggregate.reset(new RouteAggregate);
+                }
+                aggregate->requests += metrics.requests.load(std::memory_order_relaxed);
+                aggregate->bytesIn += metrics.bytesIn.load(std::memory_order_relaxed);
+                aggregate->bytesOut += metrics.bytesOut.load(std::memory_order_relaxed);
+                aggregate->queueTime.merge(metrics.queueTime);
+                aggregate->handlerTime.merge(metrics.handlerTime);
+                aggregate->writeTime.merge(metrics.writeTime);
+            }
+        }
+    }
+    std::vector<std::pair<std::string, const RouteAggregate *>> labeled;
+    for (auto &aggregate: aggregates) {
+        labeled.emplace_back(StrUtil::format("route=\"%s\",status=\"%dxx\"", escapeLabel(aggregate.first.first),
+                                             aggregate.first.second), aggregate.second.get());
+    }
+
+    auto formatCounter = [&output, &labeled](const char *name, const char *help,
+                                             uint64_t RouteAggregate::*member) {
+        output.append(StrUtil::format("# HELP %s %s\n# TYPE %s counter\n", name, help, name));
+        for (auto &item: labeled) {
+            output.append(StrUtil::format("%s{%s} %u\n", name, item.first, item.second->*member));
+        }
+    };
+    formatCounter("net4cxx_http_requests_total", "Requests finished by route and status class.",
+                  &RouteAggregate::requests);
+    formatCounter("net4cxx_http_request_body_bytes_total", "Request body bytes received.",
+                  &RouteAggregate::bytesIn);
+    formatCounter("net4cxx_http_response_body_bytes_total", "Response body bytes written.",
+                  &RouteAggregate::bytesOut);
+
+    auto formatSummary = [&output, &labeled](const char *name, const char *help,
+                                             LatencyHistogram RouteAggregate::*member) {
+        output.append(StrUtil::format("# HELP %s %s\n# TYPE %s summary\n", name, help, name));
+        for (auto &item: labeled) {
+            auto &histogram = item.second->*member;
+            for (double quantile: QUANTILES) {
+                output.append(StrUtil::format("%s{%s,quantile=\"%g\"} %s\n", name, item.first, quantile,
+                                              formatSeconds(histogram.getValueAtPercentile(quantile * 100.0))));
+            }
+            output.append(StrUtil::format("%s_sum{%s} %s\n", name, item.first,
+                                          formatSeconds(histogram.getTotalSum())));
+            output.append(StrUtil::format("%s_count{%s} %u\n", name, item.first, histogram.getTotalCount()));
+        }
+    };
+    formatSummary("net4cxx_http_queue_seconds", "Time from dispatch until the handler started.",
+                  &RouteAggregate::queueTime);
+    formatSummary("net4cxx_http_handler_seconds", "Time from the handler start until it finished.",
+                  &RouteAggregate::handlerTime);
+    formatSummary("net4cxx_http_write_seconds", "Time to drain the last response write to the socket.",
+                  &RouteAggregate::writeTime);
+}
+
+RouteMetrics* RequestMetrics::getRouteMetrics(const UrlSpec *spec, int statusCode) {
+    auto shard = localShard();
+    RouteKey key(spec, statusCode / 100);
+    // Only the owning thread inserts into a shard, so it may look up without the lock
+    auto iter = shard->routes.find(key);
+    if (iter != shard->routes.end()) {
+        return iter->second.get();
+    }
+    std::string route;
+    if (!spec) {
+        route = "unmatched";
+    } else if (!spec->getName().empty()) {
+        route = spec->getName();
+    } else {
+        route = spec->getPattern();
+    }
+    std::unique_ptr<RouteMetrics> metrics(new RouteMetrics(std::move(route), key.second));
+    auto result = metrics.get();
+    std::lock_guard<std::mutex> lock(shard->lock);
+    shard->routes.emplace(key, std::move(metrics));
+    return result;
+}
+
+RequestMetrics::Shard* RequestMetrics::localShard() {
+    // Keyed by id rather than address, so a shard of a destroyed instance is never picked up by a new one
+    static thread_local std::unordered_map<uint64_t, Shard *> localShards;
+    auto iter = localShards.find(_id);
+    if (iter != localShards.end()) {
+        return iter->second;
+    }
+    std::unique_ptr<Shard> shard(new Shard);
+    auto result = shard.get();
+    {
+        std::lock_guard<std::mutex> lock(_shardsLock);
+        _shards.emplace_back(std::move(shard));
+    }
+    localShards[_id] = result;
+    return result;
+}
+
+
+DeferredPtr MetricsHandler::onGet(const StringVector &args) {
+    std::string output;
+    auto &metrics = _application->getMetrics();
+    if (metrics) {
+        metrics->format(output);
+    }
+    LimitersType limiters;
+    for (auto &host: _application->getHandlers()) {
+        for (auto &spec: host.second) {
+            if (spec->getLimiter()) {
+                limiters.emplace_back(escapeLabel(spec->getName().empty() ? spec->getPattern() : spec->getName()),
+                                      spec->getLimiter().get());
+            }
+        }
+    }
+    if (_application->getConcurrencyLimiter()) {
+        limiters.emplace_back("global", _application->getConcurrencyLimiter().get());
+    }
+    if (!limiters.empty()) {
+        formatLimiters(output, "net4cxx_concurrency_limit", "gauge", limiters, &ConcurrencyLimiter::getLimit);
+        formatLimiters(output, "net4cxx_concurrency_in_flight", "gauge", limiters,
+                       &ConcurrencyLimiter::getInFlight);
+        formatLimiters(output, "net4cxx_concurrency_queued", "gauge", limiters, &ConcurrencyLimiter::getQueueSize);
+        formatLimiters(output, "net4cxx_concurrency_admitted_total", "counter", limiters,
+                       &ConcurrencyLimiter::getAdmittedCount);
+        formatLimiters(output, "net4cxx_concurrency_rejected_total", "counter", limiters,
+                       &ConcurrencyLimiter::getRejectedCount);
+        formatLimiters(output, "net4cxx_concurrency_timed_out_total", "counter", limiters,
+                       &ConcurrencyLimiter::getTimeoutCount);
+    }
+    formatCompressorPools(output);
+    setHeader("Content-Type", "text/plain; version=0.0.4; charset=utf-8");
+    write(output);
+    return nullptr;
+}
+
+void MetricsHandler::formatCompressorPools(std::string &output) {
+    auto pools = CompressorPool::getAllStats();
+    if (pools.empty()) {
+        return;
+    }
+    output.append("# TYPE net4cxx_zlib_context_bytes gauge\n");
+    for (auto &stats: pools) {
+        output.append(StrUtil::format("net4cxx_zlib_context_bytes{thread=\"%u\",state=\"in_use\"} %u\n", stats.thread,
+                                      stats.memory - stats.idleMemory));
+        output.append(StrUtil::format("net4cxx_zlib_context_bytes{thread=\"%u\",state=\"idle\"} %u\n", stats.thread,
+                                      stats.idleMemory));
+    }
+    output.append("# TYPE net4cxx_zlib_contexts gauge\n");
+    for (auto &stats: pools) {
+        output.append(StrUtil::format("net4cxx_zlib_contexts{thread=\"%u\",state=\"in_use\"} %u\n", stats.thread,
+                                      stats.contexts - stats.idleContexts));
+        output.append(StrUtil::format("net4cxx_zlib_contexts{thread=\"%u\",state=\"idle\"} %u\n", stats.thread,
+                                      stats.idleContexts));
+    }
+    output.append("# TYPE net4cxx_zlib_context_rejected_total counter\n");
+    for (auto &stats: pools) {
+        output.append(StrUtil::format("net4cxx_zlib_context_rejected_total{thread=\"%u\"} %u\n", stats.thread,
+                                      stats.rejected));
+    }
+}
+
+NS_END
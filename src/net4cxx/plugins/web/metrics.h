@@ -0,0 +1,169 @@
+//
+// Created by yuwenyong.vincent on 2019-03-19.
+//
+
+#ifndef NET4CXX_PLUGINS_WEB_METRICS_H
+#define NET4CXX_PLUGINS_WEB_METRICS_H
+
+#include "net4cxx/common/common.h"
+#include <atomic>
+#include <mutex>
+#include "net4cxx/plugins/web/web.h"
+
+
+NS_BEGIN
+
+
+// HDR style log-linear histogram of microseconds, 64 sub-buckets per power of two keep ~1.6% precision.
+// Written by a single thread without locks, readable from any thread
+class NET4CXX_COMMON_API LatencyHistogram: public boost::noncopyable {
+public:
+    LatencyHistogram() {
+        for (auto &count: _counts) {
+            count.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void record(uint64_t value) {
+        value = std::min(value, HIGHEST_TRACKABLE_VALUE);
+        increment(_counts[countsIndex(value)], 1);
+        increment(_totalCount, 1);
+        increment(_totalSum, value);
+        if (value > _maxValue.load(std::memory_order_relaxed)) {
+            _maxValue.store(value, std::memory_order_relaxed);
+        }
+    }
+
+    void record(const Duration &duration) {
+        auto value = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+        record(value > 0 ? (uint64_t)value : 0);
+    }
+
+    void merge(const LatencyHistogram &other);
+
+    uint64_t getTotalCount() const {
+        return _totalCount.load(std::memory_order_relaxed);
+    }
+
+    uint64_t getTotalSum() const {
+        return _totalSum.load(std::memory_order_relaxed);
+    }
+
+    uint64_t getMaxValue() const {
+        return _maxValue.load(std::memory_order_relaxed);
+    }
+
+    uint64_t getValueAtPercentile(double percentile) const;
+
+    static constexpr int SUB_BUCKET_HALF_COUNT_MAGNITUDE = 5;
+    static constexpr uint64_t SUB_BUCKET_HALF_COUNT = 1u << SUB_BUCKET_HALF_COUNT_MAGNITUDE;
+    static constexpr uint64_t SUB_BUCKET_MASK = (SUB_BUCKET_HALF_COUNT << 1) - 1;
+    static constexpr int BUCKET_COUNT = 31;
+    static constexpr size_t COUNTS_LENGTH = (BUCKET_COUNT + 1) * SUB_BUCKET_HALF_COUNT;
+    static constexpr uint64_t HIGHEST_TRACKABLE_VALUE = ((SUB_BUCKET_MASK + 1) << (BUCKET_COUNT - 1)) - 1;
+protected:
+    static void increment(std::atomic<uint64_t> &counter, uint64_t value) {
+        // Only the owning thread writes, so a plain load and store is enough
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    static size_t countsIndex(uint64_t value) {
+        int bucketIndex = 64 - __builtin_clzll(value | SUB_BUCKET_MASK) - SUB_BUCKET_HALF_COUNT_MAGNITUDE - 1;
+        auto subBucketIndex = (size_t)(value >> bucketIndex);
+        return ((size_t)(bucketIndex + 1) << SUB_BUCKET_HALF_COUNT_MAGNITUDE) + subBucketIndex -
+               SUB_BUCKET_HALF_COUNT;
+    }
+
+    static uint64_t highestEquivalentValue(size_t index);
+
+    std::atomic<uint64_t> _counts[COUNTS_LENGTH];
+    std::atomic<uint64_t> _totalCount{0};
+    std::atomic<uint64_t> _totalSum{0};
+    std::atomic<uint64_t> _maxValue{0};
+};
+
+
+class NET4CXX_COMMON_API RouteMetrics: public boost::noncopyable {
+public:
+    RouteMetrics(std::string route, int statusClass)
+            : _route(std::move(route))
+            , _statusClass(statusClass) {
+
+    }
+
+    const std::string& getRoute() const {
+        return _route;
+    }
+
+    int getStatusClass() const {
+        return _statusClass;
+    }
+
+    std::atomic<uint64_t> requests{0};
+    std::atomic<uint64_t> bytesIn{0};
+    std::atomic<uint64_t> bytesOut{0};
+    LatencyHistogram queueTime;
+    LatencyHistogram handlerTime;
+    LatencyHistogram writeTime;
+protected:
+    std::string _route;
+    int _statusClass;
+};
+
+
+// Every reactor thread records into its own shard, the lock is only taken to add a route or to read
+class NET4CXX_COMMON_API RequestMetrics: public boost::noncopyable {
+public:
+    typedef std::pair<const UrlSpec *, int> RouteKey;
+
+    struct Shard {
+        std::mutex lock;
+        std::map<RouteKey, std::unique_ptr<RouteMetrics>> routes;
+    };
+
+    RequestMetrics();
+
+    void record(const UrlSpec *spec, int statusCode, uint64_t bytesIn, uint64_t bytesOut, const Duration &queueTime,
+                const Duration &handlerTime);
+
+    void recordWrite(const UrlSpec *spec, int statusCode, const Duration &writeTime);
+
+    void format(std::string &output) const;
+
+    static const std::vector<double> QUANTILES;
+protected:
+    RouteMetrics* getRouteMetrics(const UrlSpec *spec, int statusCode);
+
+    Shard* localShard();
+
+    uint64_t _id;
+    mutable std::mutex _shardsLock;
+    std::vector<std::unique_ptr<Shard>> _shards;
+};
+
+
+// Serves the metrics of its application in the Prometheus text format
+class NET4CXX_COMMON_API MetricsHandler: public RequestHandler {
+public:
+    using RequestHandler::RequestHandler;
+
+    DeferredPtr onGet(const StringVector &args) override;
+protected:
+    typedef std::vector<std::pair<std::string, const ConcurrencyLimiter *>> LimitersType;
+
+    template <typename ValueT>
+    static void formatLimiters(std::string &output, const char *name, const char *type, const LimitersType &limiters,
+                               ValueT (ConcurrencyLimiter::*getter)() const) {
+        output.append(StrUtil::format("# TYPE %s %s\n", name, type));
+        for (auto &limiter: limiters) {
+            output.append(StrUtil::format("%s{route=\"%s\"} %u\n", name, limiter.first, (limiter.second->*getter)()));
+        }
+    }
+
+    // Zlib contexts held by each reactor thread
+    static void formatCompressorPools(std::string &output);
+};
+
+NS_END
+
+#endif //NET4CXX_PLUGINS_WEB_METRICS_H
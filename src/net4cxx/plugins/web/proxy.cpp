@@ -0,0 +1,836 @@
+//
+// Created by yuwenyong.vincent on 2019-03-17.
+//
+
+#include "net4cxx/plugins/web/proxy.h"
+#include "net4cxx/core/network/defer.h"
+#include "net4cxx/core/network/endpoints.h"
+
+
+NS_BEGIN
+
+
+constexpr size_t UpstreamPool::VIRTUAL_NODES;
+
+UpstreamPool::UpstreamPool(const StringVector &addresses, Policy policy)
+        : _policy(policy) {
+    if (addresses.empty()) {
+        NET4CXX_THROW_EXCEPTION(ValueError, "At least one upstream is required");
+    }
+    std::string host;
+    boost::optional<unsigned short> port;
+    for (auto &address: addresses) {
+        std::tie(host, port) = HTTPUtil::splitHostAndPort(address);
+        if (!port) {
+            port = 80;
+        }
+        _upstreams.emplace_back(std::make_unique<Upstream>(host, *port, _upstreams.size()));
+    }
+    _ring.reserve(_upstreams.size() * VIRTUAL_NODES);
+    for (auto &upstream: _upstreams) {
+        for (size_t i = 0; i != VIRTUAL_NODES; ++i) {
+            auto node = StrUtil::format("%s:%u#%u", upstream->getHost(), upstream->getPort(), i);
+            _ring.emplace_back(hash(node.data(), node.size()), upstream->getIndex());
+        }
+    }
+    std::sort(_ring.begin(), _ring.end());
+}
+
+Upstream* UpstreamPool::select(const std::string &hashKey) {
+    auto now = TimestampClock::now();
+    switch (_policy) {
+        case LEAST_OUTSTANDING: {
+            return selectLeastOutstanding(now);
+        }
+        case CONSISTENT_HASH: {
+            return selectConsistentHash(hashKey, now);
+        }
+        default: {
+            return selectRoundRobin(now);
+        }
+    }
+}
+
+void UpstreamPool::release(Upstream *upstream, bool success) {
+    --upstream->_outstanding;
+    if (success) {
+        upstream->_failures = 0;
+    } else if (++upstream->_failures >= _maxFails) {
+        upstream->_failures = 0;
+        auto ejectedUntil = TimestampClock::now() + std::chrono::duration_cast<TimestampClock::duration>(
+                std::chrono::duration<double>(_ejectTime));
+        upstream->_ejectedUntil = ejectedUntil.time_since_epoch().count();
+        NET4CXX_LOG_WARN(gAppLog, "Ejecting upstream %s:%u for %.1f seconds", upstream->getHost(),
+                         upstream->getPort(), _ejectTime);
+    }
+}
+
+UpstreamConnectionPtr UpstreamPool::popIdle(Upstream *upstream, Reactor *reactor) {
+    std::lock_guard<std::mutex> lock(_idleLock);
+    auto iter = _idle.find(IdleKey(reactor, upstream->getIndex()));
+    if (iter == _idle.end()) {
+        return nullptr;
+    }
+    auto &connections = iter->second;
+    while (!connections.empty()) {
+        auto connection = std::move(connections.back());
+        connections.pop_back();
+        if (!connection->closed()) {
+            connection->setIdle(false);
+            return connection;
+        }
+    }
+    return nullptr;
+}
+
+void UpstreamPool::pushIdle(UpstreamConnectionPtr connection) {
+    UpstreamConnectionPtr overflow;
+    {
+        std::lock_guard<std::mutex> lock(_idleLock);
+        auto &connections = _idle[IdleKey(connection->reactor(), connection->getUpstream()->getIndex())];
+        if (connections.size() < _maxIdlePerUpstream) {
+            connection->setIdle(true);
+            connections.emplace_back(std::move(connection));
+        } else {
+            overflow = std::move(connection);
+        }
+    }
+    // Closing calls back into removeIdle, so do it outside the lock
+    if (overflow) {
+        overflow->close(nullptr);
+    }
+}
+
+void UpstreamPool::removeIdle(UpstreamConnection *connection) {
+    UpstreamConnectionPtr removed;
+    std::lock_guard<std::mutex> lock(_idleLock);
+    for (auto &kv: _idle) {
+        auto &connections = kv.second;
+        auto iter = std::find_if(connections.begin(), connections.end(),
+                                 [connection](const UpstreamConnectionPtr &idle) {
+            return idle.get() == connection;
+        });
+        if (iter != connections.end()) {
+            removed = std::move(*iter);
+            connections.erase(iter);
+            break;
+        }
+    }
+}
+
+size_t UpstreamPool::getIdleCount() const {
+    size_t count = 0;
+    std::lock_guard<std::mutex> lock(_idleLock);
+    for (auto &kv: _idle) {
+        count += kv.second.size();
+    }
+    return count;
+}
+
+uint64_t UpstreamPool::hash(const char *data, size_t length) {
+    uint64_t value = 14695981039346656037ULL;
+    for (size_t i = 0; i != length; ++i) {
+        value ^= (uint8_t)data[i];
+        value *= 1099511628211ULL;
+    }
+    return value;
+}
+
+Upstream* UpstreamPool::selectRoundRobin(const Timestamp &now) {
+    size_t count = _upstreams.size();
+    size_t start = _next++;
+    for (size_t i = 0; i != count; ++i) {
+        auto upstream = _upstreams[(start + i) % count].get();
+        if (!upstream->isEjected(now)) {
+            return upstream;
+        }
+    }
+    // Every upstream is ejected, fail open rather than rejecting all traffic
+    return _upstreams[start % count].get();
+}
+
+Upstream* UpstreamPool::selectLeastOutstanding(const Timestamp &now) {
+    size_t count = _upstreams.size();
+    size_t start = _next++;
+    Upstream *selected = nullptr;
+    for (size_t i = 0; i != count; ++i) {
+        auto upstream = _upstreams[(start + i) % count].get();
+        if (upstream->isEjected(now)) {
+            continue;
+        }
+        if (!selected || upstream->getOutstanding() < selected->getOutstanding()) {
+            selected = upstream;
+        }
+    }
+    return selected ? selected : _upstreams[start % count].get();
+}
+
+Upstream* UpstreamPool::selectConsistentHash(const std::string &hashKey, const Timestamp &now) {
+    if (hashKey.empty()) {
+        return selectRoundRobin(now);
+    }
+    auto start = std::lower_bound(_ring.begin(), _ring.end(),
+                                  std::make_pair(hash(hashKey.data(), hashKey.size()), (size_t)0));
+    if (start == _ring.end()) {
+        start = _ring.begin();
+    }
+    auto iter = start;
+    do {
+        auto upstream = _upstreams[iter->second].get();
+        if (!upstream->isEjected(now)) {
+            return upstream;
+        }
+        if (++iter == _ring.end()) {
+            iter = _ring.begin();
+        }
+    } while (iter != start);
+    return _upstreams[start->second].get();
+}
+
+
+constexpr size_t UpstreamConnection::CHUNK_SIZE;
+constexpr size_t UpstreamConnection::MAX_HEADER_SIZE;
+
+void UpstreamConnection::onConnected() {
+    try {
+        if (!_handler) {
+            close(nullptr);
+            return;
+        }
+        setNoDelay(true);
+        _handler->onUpstreamConnected();
+    } catch (...) {
+        handleException(std::current_exception());
+    }
+}
+
+void UpstreamConnection::onDataRead(Byte *data, size_t length) {
+    try {
+        switch (_state) {
+            case READ_HEADER: {
+                onHeaders((char *) data, length);
+                break;
+            }
+            case READ_FIXED_BODY:
+            case READ_CHUNK_DATA:
+            case READ_UNTIL_CLOSE: {
+                onBodyData((char *) data, length);
+                break;
+            }
+            case READ_CHUNK_LENGTH: {
+                onChunkLength((char *) data, length);
+                break;
+            }
+            case READ_CHUNK_ENDS: {
+                if (boost::string_view((char *) data, length) != "\r\n") {
+                    NET4CXX_THROW_EXCEPTION(HTTPInputError, "improperly terminated chunked response");
+                }
+                _state = READ_CHUNK_LENGTH;
+                readUntil("\r\n", 64);
+                break;
+            }
+            case READ_TRAILERS: {
+                if (boost::string_view((char *) data, length) == "\r\n") {
+                    readFinished();
+                } else {
+                    readUntil("\r\n", MAX_HEADER_SIZE);
+                }
+                break;
+            }
+            default: {
+                NET4CXX_ASSERT_MSG(false, "Unreachable");
+                break;
+            }
+        }
+    } catch (...) {
+        handleException(std::current_exception());
+    }
+}
+
+void UpstreamConnection::onWriteComplete() {
+    if (_handler) {
+        _handler->onUpstreamWriteComplete();
+    }
+}
+
+void UpstreamConnection::onDisconnected(std::exception_ptr reason) {
+    auto self = getSelf<UpstreamConnection>();
+    if (_idle) {
+        _idle = false;
+        auto pool = _pool.lock();
+        if (pool) {
+            pool->removeIdle(this);
+        }
+        return;
+    }
+    // A body delimited by the close has already been delivered, the handler finishes it once drained
+    if (!_handler || _state == READ_UNTIL_CLOSE) {
+        return;
+    }
+    auto handler = std::move(_handler);
+    _handler.reset();
+    _reusable = false;
+    if (!reason) {
+        reason = std::make_exception_ptr(NET4CXX_MAKE_EXCEPTION(StreamClosedError, "Upstream connection closed"));
+    }
+    handler->onUpstreamError(reason);
+}
+
+void UpstreamConnection::writeHeaders(const std::string &method, const std::string &uri,
+                                      const HTTPHeaders &headers) {
+    _method = method;
+    _state = READ_NONE;
+    _reusable = false;
+    _chunkingOutput = boost::to_lower_copy(headers.get("Transfer-Encoding")) == "chunked";
+    std::string data;
+    data.reserve(1024);
+    data.append(method);
+    data.push_back(' ');
+    data.append(uri);
+    data.append(" HTTP/1.1\r\n");
+    headers.getAll([&data](const std::string &name, const std::string &value) {
+        if (value.find('\n') != std::string::npos) {
+            NET4CXX_THROW_EXCEPTION(ValueError, "Newline in header: %s", name);
+        }
+        data.append(name);
+        data.append(": ");
+        data.append(value);
+        data.append("\r\n");
+    });
+    data.append("\r\n");
+    write(data, true);
+}
+
+void UpstreamConnection::writeBody(std::string data) {
+    if (data.empty()) {
+        return;
+    }
+    BufferChain chunk;
+    if (_chunkingOutput) {
+        char header[32];
+        int length = snprintf(header, sizeof(header), "%zx\r\n", data.size());
+        chunk.append((const Byte *)header, (size_t)length);
+        chunk.append(std::move(data));
+        chunk.append(std::string("\r\n"));
+    } else {
+        chunk.append(std::move(data));
+    }
+    write(std::move(chunk), true);
+}
+
+void UpstreamConnection::finishBody() {
+    if (_chunkingOutput) {
+        write("0\r\n\r\n", true);
+    }
+}
+
+void UpstreamConnection::readResponse() {
+    _state = READ_HEADER;
+    static const boost::regex headerEnd("\r?\n\r?\n");
+    readUntilRegex(headerEnd, MAX_HEADER_SIZE);
+}
+
+void UpstreamConnection::continueResponse() {
+    if (!_handler) {
+        return;
+    }
+    try {
+        switch (_state) {
+            case READ_FIXED_BODY: {
+                resumeReading();
+                if (_bytesRead < _bytesToRead) {
+                    readBytes(std::min(CHUNK_SIZE, _bytesToRead - _bytesRead), true);
+                } else {
+                    readFinished();
+                }
+                break;
+            }
+            case READ_CHUNK_DATA: {
+                resumeReading();
+                if (_bytesRead < _bytesToRead) {
+                    readBytes(std::min(CHUNK_SIZE, _bytesToRead - _bytesRead), true);
+                } else {
+                    _state = READ_CHUNK_ENDS;
+                    readUntil("\r\n", 64);
+                }
+                break;
+            }
+            case READ_UNTIL_CLOSE: {
+                readFinished();
+                break;
+            }
+            default: {
+                NET4CXX_ASSERT_MSG(false, "Unreachable");
+                break;
+            }
+        }
+    } catch (...) {
+        handleException(std::current_exception());
+    }
+}
+
+void UpstreamConnection::abort() {
+    _handler.reset();
+    _reusable = false;
+    if (_transport && !closed()) {
+        abortConnection();
+    }
+}
+
+void UpstreamConnection::onHeaders(char *data, size_t length) {
+    HTTPHeaders headers;
+    auto startLine = HTTPUtil::parseResponseStartLine(HTTPUtil::parseHeaders(data, length, headers));
+    int code = startLine.getCode();
+    if (code >= 100 && code < 200) {
+        if (code == 101) {
+            NET4CXX_THROW_EXCEPTION(HTTPInputError, "Upgrade is not supported by the proxy");
+        }
+        readResponse();
+        return;
+    }
+    auto connectionHeader = boost::to_lower_copy(headers.get("Connection"));
+    if (startLine.getVersion() == "HTTP/1.1") {
+        _reusable = connectionHeader.find("close") == std::string::npos;
+    } else {
+        _reusable = connectionHeader.find("keep-alive") != std::string::npos;
+    }
+    _handler->onUpstreamHeaders(startLine, headers);
+    if (!_handler) {
+        return;
+    }
+    if (_method == "HEAD" || code == 204 || code == 304) {
+        readFinished();
+    } else {
+        readBody(headers);
+    }
+}
+
+void UpstreamConnection::onChunkLength(char *data, size_t length) {
+    std::string content(data, length);
+    auto pos = content.find(';');
+    if (pos != std::string::npos) {
+        content.resize(pos);
+    }
+    boost::trim(content);
+    size_t chunkLen;
+    try {
+        chunkLen = std::stoul(content, nullptr, 16);
+    } catch (...) {
+        NET4CXX_THROW_EXCEPTION(HTTPInputError, "Invalid chunk length: %s", content);
+    }
+    if (chunkLen == 0) {
+        _state = READ_TRAILERS;
+        readUntil("\r\n", MAX_HEADER_SIZE);
+    } else {
+        _state = READ_CHUNK_DATA;
+        _bytesToRead = chunkLen;
+        _bytesRead = 0;
+        readBytes(std::min(CHUNK_SIZE, chunkLen), true);
+    }
+}
+
+void UpstreamConnection::onBodyData(char *data, size_t length) {
+    _bytesRead += length;
+    if (_state != READ_UNTIL_CLOSE) {
+        // Hold the upstream until the handler has passed this block on
+        pauseReading();
+    }
+    _handler->onUpstreamData(std::string(data, length));
+}
+
+void UpstreamConnection::readBody(const HTTPHeaders &headers) {
+    if (boost::to_lower_copy(headers.get("Transfer-Encoding")) == "chunked") {
+        _state = READ_CHUNK_LENGTH;
+        readUntil("\r\n", 64);
+    } else if (headers.has("Content-Length")) {
+        try {
+            _bytesToRead = (size_t)std::stoul(headers.at("Content-Length"));
+        } catch (...) {
+            NET4CXX_THROW_EXCEPTION(HTTPInputError, "Only integer Content-Length is allowed: %s",
+                                    headers.at("Content-Length"));
+        }
+        _bytesRead = 0;
+        if (_bytesToRead == 0) {
+            readFinished();
+        } else {
+            _state = READ_FIXED_BODY;
+            readBytes(std::min(CHUNK_SIZE, _bytesToRead), true);
+        }
+    } else {
+        _reusable = false;
+        _state = READ_UNTIL_CLOSE;
+        readUntilClose();
+    }
+}
+
+void UpstreamConnection::readFinished() {
+    _state = READ_NONE;
+    auto handler = std::move(_handler);
+    _handler.reset();
+    handler->onUpstreamFinished();
+}
+
+void UpstreamConnection::handleException(std::exception_ptr error) {
+    auto handler = std::move(_handler);
+    _handler.reset();
+    _reusable = false;
+    if (_transport && !closed()) {
+        close(error);
+    }
+    if (handler) {
+        handler->onUpstreamError(error);
+    }
+}
+
+
+constexpr size_t ProxyHandler::MAX_PENDING_BYTES;
+
+void ProxyHandler::initialize(const boost::any &args) {
+    const auto &arg = boost::any_cast<const ProxyHandlerArgs&>(args);
+    _pool = arg.getPool();
+    if (!_pool) {
+        NET4CXX_THROW_EXCEPTION(ValueError, "ProxyHandler requires an upstream pool");
+    }
+    _hashHeader = arg.getHashHeader();
+    _connectTimeout = arg.getConnectTimeout();
+    _requestTimeout = arg.getRequestTimeout();
+}
+
+bool ProxyHandler::hasStreamRequestBody() const {
+    return true;
+}
+
+DeferredPtr ProxyHandler::prepare() {
+    _waiting = makeDeferred();
+    auto result = _waiting;
+    if (_requestTimeout > 0.0) {
+        _timeout = getConnection()->reactor()->callLater(_requestTimeout, [this, self=getSelf<ProxyHandler>()]() {
+            _timeout.reset();
+            _retried = true;
+            onUpstreamError(std::make_exception_ptr(
+                    NET4CXX_MAKE_EXCEPTION(HTTPError, "Upstream request timed out") << errinfo_http_code(504)));
+        });
+    }
+    connectUpstream();
+    return result;
+}
+
+void ProxyHandler::dataReceived(std::string data) {
+    if (!_connection || data.empty()) {
+        return;
+    }
+    _bodyBytes += data.size();
+    try {
+        _connection->writeBody(std::move(data));
+    } catch (...) {
+        onUpstreamError(std::current_exception());
+        return;
+    }
+    // Resumed once the upstream has taken the data
+    pauseReading();
+}
+
+DeferredPtr ProxyHandler::onHead(const StringVector &args) {
+    return forward();
+}
+
+DeferredPtr ProxyHandler::onGet(const StringVector &args) {
+    return forward();
+}
+
+DeferredPtr ProxyHandler::onPost(const StringVector &args) {
+    return forward();
+}
+
+DeferredPtr ProxyHandler::onDelete(const StringVector &args) {
+    return forward();
+}
+
+DeferredPtr ProxyHandler::onPatch(const StringVector &args) {
+    return forward();
+}
+
+DeferredPtr ProxyHandler::onPut(const StringVector &args) {
+    return forward();
+}
+
+DeferredPtr ProxyHandler::onOptions(const StringVector &args) {
+    return forward();
+}
+
+void ProxyHandler::onConnectionClose() {
+    removeTimeout();
+    if (_connection) {
+        auto connection = std::move(_connection);
+        _connection.reset();
+        connection->abort();
+    }
+    releaseUpstream(true);
+}
+
+std::string ProxyHandler::computeEtag() const {
+    return {};
+}
+
+bool ProxyHandler::isHopByHopHeader(const std::string &name) {
+    static const StringSet hopByHopHeaders = {
+            "Connection", "Keep-Alive", "Proxy-Authenticate", "Proxy-Authorization", "Proxy-Connection", "Te",
+            "Trailer", "Transfer-Encoding", "Upgrade"
+    };
+    return hopByHopHeaders.find(name) != hopByHopHeaders.end();
+}
+
+void ProxyHandler::execute(TransformsType transforms, const StringVector &args) {
+    // The upstream body is relayed as is, output transforms would break its framing headers
+    RequestHandler::execute({}, args);
+}
+
+std::string ProxyHandler::getHashKey() const {
+    if (_hashHeader.empty()) {
+        return _request->getPath();
+    }
+    return _request->getHTTPHeaders()->get(_hashHeader);
+}
+
+void ProxyHandler::prepareHeaders(HTTPHeaders &headers) const {
+    const std::string &remoteIp = _request->getRemoteIp();
+    auto forwardedFor = headers.get("X-Forwarded-For");
+    headers["X-Forwarded-For"] = forwardedFor.empty() ? remoteIp : forwardedFor + ", " + remoteIp;
+    if (!headers.has("X-Forwarded-Proto")) {
+        headers["X-Forwarded-Proto"] = _request->getProtocol();
+    }
+    if (!headers.has("X-Forwarded-Host") && !_request->getHost().empty()) {
+        headers["X-Forwarded-Host"] = _request->getHost();
+    }
+    if (!headers.has("Host")) {
+        headers["Host"] = StrUtil::format("%s:%u", _upstream->getHost(), _upstream->getPort());
+    }
+}
+
+DeferredPtr ProxyHandler::forward() {
+    _bodyFinished = true;
+    if (!_connection) {
+        return nullptr;
+    }
+    _waiting = makeDeferred();
+    auto result = _waiting;
+    try {
+        _connection->finishBody();
+        _connection->readResponse();
+    } catch (...) {
+        onUpstreamError(std::current_exception());
+    }
+    return result;
+}
+
+void ProxyHandler::connectUpstream(bool reuse) {
+    auto self = getSelf<ProxyHandler>();
+    auto reactor = getConnection()->reactor();
+    _upstream = _pool->select(getHashKey());
+    _pool->acquire(_upstream);
+    _reused = false;
+    if (reuse) {
+        _connection = _pool->popIdle(_upstream, reactor);
+        if (_connection) {
+            _reused = true;
+            _connection->attach(std::move(self));
+            sendRequest();
+            return;
+        }
+    }
+    auto connection = std::make_shared<UpstreamConnection>(_pool, _upstream);
+    _connection = connection;
+    connection->attach(self);
+    TCPClientEndpoint endpoint(reactor, _upstream->getHost(), std::to_string(_upstream->getPort()),
+                               _connectTimeout);
+    connectProtocol(endpoint, connection)->addErrback([this, self, connection](DeferredValue value) {
+        if (_connection == connection) {
+            onUpstreamError(value.asError());
+        }
+        return DeferredValue(nullptr);
+    });
+}
+
+void ProxyHandler::sendRequest() {
+    try {
+        auto requestHeaders = _request->getHTTPHeaders();
+        StringSet connectionTokens;
+        for (auto &token: StrUtil::split(requestHeaders->get("Connection"), ',')) {
+            boost::trim(token);
+            if (!token.empty()) {
+                connectionTokens.insert(boost::to_lower_copy(token));
+            }
+        }
+        HTTPHeaders headers;
+        requestHeaders->getAll([&headers, &connectionTokens](const std::string &name, const std::string &value) {
+            if (isHopByHopHeader(name) || name == "Expect" ||
+                connectionTokens.find(boost::to_lower_copy(name)) != connectionTokens.end()) {
+                return;
+            }
+            headers.add(name, value);
+        });
+        if (boost::to_lower_copy(requestHeaders->get("Transfer-Encoding")) == "chunked") {
+            headers["Transfer-Encoding"] = "chunked";
+        }
+        prepareHeaders(headers);
+        _connection->writeHeaders(_request->getMethod(), _request->getURI(), headers);
+        if (_bodyFinished) {
+            // Replaying on a fresh connection after the downstream body has completed
+            _connection->finishBody();
+            _connection->readResponse();
+        } else {
+            fireWaiting(nullptr);
+        }
+    } catch (...) {
+        onUpstreamError(std::current_exception());
+    }
+}
+
+void ProxyHandler::onUpstreamConnected() {
+    sendRequest();
+}
+
+void ProxyHandler::onUpstreamWriteComplete() {
+    if (!_bodyFinished) {
+        resumeReading();
+    }
+}
+
+void ProxyHandler::onUpstreamHeaders(const ResponseStartLine &startLine, const HTTPHeaders &headers) {
+    _upstreamCode = startLine.getCode();
+    setStatus(startLine.getCode(), startLine.getReason());
+    StringSet connectionTokens;
+    for (auto &token: StrUtil::split(headers.get("Connection"), ',')) {
+        boost::trim(token);
+        if (!token.empty()) {
+            connectionTokens.insert(boost::to_lower_copy(token));
+        }
+    }
+    _headers = HTTPHeaders();
+    headers.getAll([this, &connectionTokens](const std::string &name, const std::string &value) {
+        if (isHopByHopHeader(name) || connectionTokens.find(boost::to_lower_copy(name)) != connectionTokens.end()) {
+            return;
+        }
+        _headers.add(name, value);
+    });
+}
+
+void ProxyHandler::onUpstreamData(std::string data) {
+    auto connection = _connection;
+    _responseStarted = true;
+    bool waiting = _pendingBytes != 0;
+    _pendingBytes += data.size();
+    write(std::move(data));
+    if (waiting) {
+        flush();
+    } else {
+        flush(false, [this, self=getSelf<ProxyHandler>()]() {
+            onDownstreamDrained();
+        });
+    }
+    if (_pendingBytes < MAX_PENDING_BYTES) {
+        connection->continueResponse();
+    } else {
+        _waitingDrain = true;
+    }
+}
+
+void ProxyHandler::onUpstreamFinished() {
+    removeTimeout();
+    auto connection = std::move(_connection);
+    _connection.reset();
+    releaseUpstream(_upstreamCode != 502 && _upstreamCode != 503 && _upstreamCode != 504);
+    if (connection->isReusable()) {
+        _pool->pushIdle(std::move(connection));
+    } else if (!connection->closed()) {
+        connection->close(nullptr);
+    }
+    fireWaiting(nullptr);
+}
+
+void ProxyHandler::onDownstreamDrained() {
+    _pendingBytes = 0;
+    if (_waitingDrain) {
+        _waitingDrain = false;
+        if (_connection) {
+            _connection->continueResponse();
+        }
+    }
+}
+
+void ProxyHandler::onUpstreamError(std::exception_ptr error) {
+    if (_connection) {
+        auto connection = std::move(_connection);
+        _connection.reset();
+        connection->abort();
+    }
+    if (_finished || !_upstream) {
+        return;
+    }
+    const std::string &method = _request->getMethod();
+    if (_reused && !_retried && !_responseStarted && _bodyBytes == 0 && _waiting &&
+        (method == "GET" || method == "HEAD" || method == "OPTIONS")) {
+        // The upstream may have closed an idle connection just as it was reused, try once on a new one
+        _retried = true;
+        releaseUpstream(true);
+        try {
+            connectUpstream(false);
+        } catch (...) {
+            onUpstreamError(std::current_exception());
+        }
+        return;
+    }
+    std::string upstream = StrUtil::format("%s:%u", _upstream->getHost(), _upstream->getPort());
+    releaseUpstream(false);
+    removeTimeout();
+    try {
+        std::rethrow_exception(error);
+    } catch (HTTPError &e) {
+        NET4CXX_LOG_WARN(gAppLog, "Upstream %s failed for %s: %s", upstream, requestSummary(), e.what());
+    } catch (TimeoutError &e) {
+        NET4CXX_LOG_WARN(gAppLog, "Upstream %s timed out for %s", upstream, requestSummary());
+        error = std::make_exception_ptr(NET4CXX_MAKE_EXCEPTION(HTTPError, "") << errinfo_http_code(504));
+    } catch (std::exception &e) {
+        NET4CXX_LOG_WARN(gAppLog, "Upstream %s failed for %s: %s", upstream, requestSummary(), e.what());
+        error = std::make_exception_ptr(NET4CXX_MAKE_EXCEPTION(HTTPError, "") << errinfo_http_code(502));
+    }
+    if (_headersWritten) {
+        // Part of the response is already out, the only way to signal the failure is to drop the connection
+        auto connection = _request->getConnection();
+        if (connection) {
+            connection->abortConnection();
+        }
+        return;
+    }
+    fireWaiting(error);
+}
+
+void ProxyHandler::releaseUpstream(bool success) {
+    if (_upstream) {
+        _pool->release(_upstream, success);
+        _upstream = nullptr;
+    }
+}
+
+void ProxyHandler::removeTimeout() {
+    if (!_timeout.cancelled()) {
+        _timeout.cancel();
+        _timeout.reset();
+    }
+}
+
+void ProxyHandler::fireWaiting(std::exception_ptr error) {
+    if (_waiting) {
+        auto waiting = std::move(_waiting);
+        _waiting.reset();
+        if (error) {
+            waiting->errback(error);
+        } else {
+            waiting->callback(nullptr);
+        }
+    } else if (error && !_finished) {
+        handleRequestException(error);
+    }
+}
+
+NS_END
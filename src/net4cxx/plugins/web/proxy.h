@@ -0,0 +1,376 @@
+//
+// Created by yuwenyong.vincent on 2019-03-17.
+//
+
+#ifndef NET4CXX_PLUGINS_WEB_PROXY_H
+#define NET4CXX_PLUGINS_WEB_PROXY_H
+
+#include "net4cxx/common/common.h"
+#include <atomic>
+#include <mutex>
+#include "net4cxx/core/protocols/iostream.h"
+#include "net4cxx/plugins/web/web.h"
+
+
+NS_BEGIN
+
+
+class ProxyHandler;
+class UpstreamConnection;
+using UpstreamConnectionPtr = std::shared_ptr<UpstreamConnection>;
+
+
+class NET4CXX_COMMON_API Upstream: public boost::noncopyable {
+public:
+    Upstream(std::string host, unsigned short port, size_t index)
+            : _host(std::move(host))
+            , _port(port)
+            , _index(index) {
+
+    }
+
+    const std::string& getHost() const {
+        return _host;
+    }
+
+    unsigned short getPort() const {
+        return _port;
+    }
+
+    size_t getIndex() const {
+        return _index;
+    }
+
+    size_t getOutstanding() const {
+        return _outstanding;
+    }
+
+    int getFailures() const {
+        return _failures;
+    }
+
+    bool isEjected(const Timestamp &now) const {
+        return now.time_since_epoch().count() < _ejectedUntil;
+    }
+protected:
+    friend class UpstreamPool;
+
+    std::string _host;
+    unsigned short _port;
+    size_t _index;
+    std::atomic<size_t> _outstanding{0};
+    std::atomic<int> _failures{0};
+    std::atomic<Timestamp::rep> _ejectedUntil{0};
+};
+
+
+// Shared by all reactors; idle connections are kept per reactor since a connection can only be used by the thread
+// that owns it
+class NET4CXX_COMMON_API UpstreamPool: public boost::noncopyable {
+public:
+    enum Policy {
+        ROUND_ROBIN,
+        LEAST_OUTSTANDING,
+        CONSISTENT_HASH,
+    };
+
+    explicit UpstreamPool(const StringVector &addresses, Policy policy=ROUND_ROBIN);
+
+    Upstream* select(const std::string &hashKey);
+
+    void acquire(Upstream *upstream) {
+        ++upstream->_outstanding;
+    }
+
+    void release(Upstream *upstream, bool success);
+
+    UpstreamConnectionPtr popIdle(Upstream *upstream, Reactor *reactor);
+
+    void pushIdle(UpstreamConnectionPtr connection);
+
+    void removeIdle(UpstreamConnection *connection);
+
+    size_t getIdleCount() const;
+
+    Policy getPolicy() const {
+        return _policy;
+    }
+
+    const std::vector<std::unique_ptr<Upstream>>& getUpstreams() const {
+        return _upstreams;
+    }
+
+    void setMaxFails(int maxFails) {
+        _maxFails = maxFails;
+    }
+
+    int getMaxFails() const {
+        return _maxFails;
+    }
+
+    void setEjectTime(double ejectTime) {
+        _ejectTime = ejectTime;
+    }
+
+    double getEjectTime() const {
+        return _ejectTime;
+    }
+
+    void setMaxIdlePerUpstream(size_t maxIdlePerUpstream) {
+        _maxIdlePerUpstream = maxIdlePerUpstream;
+    }
+
+    size_t getMaxIdlePerUpstream() const {
+        return _maxIdlePerUpstream;
+    }
+
+    static uint64_t hash(const char *data, size_t length);
+
+    static constexpr size_t VIRTUAL_NODES = 160;
+protected:
+    typedef std::pair<Reactor *, size_t> IdleKey;
+
+    Upstream* selectRoundRobin(const Timestamp &now);
+
+    Upstream* selectLeastOutstanding(const Timestamp &now);
+
+    Upstream* selectConsistentHash(const std::string &hashKey, const Timestamp &now);
+
+    Policy _policy;
+    std::vector<std::unique_ptr<Upstream>> _upstreams;
+    std::vector<std::pair<uint64_t, size_t>> _ring;
+    std::atomic<size_t> _next{0};
+    int _maxFails{3};
+    double _ejectTime{10.0};
+    size_t _maxIdlePerUpstream{32};
+    mutable std::mutex _idleLock;
+    std::map<IdleKey, std::vector<UpstreamConnectionPtr>> _idle;
+};
+
+using UpstreamPoolPtr = std::shared_ptr<UpstreamPool>;
+
+
+class NET4CXX_COMMON_API UpstreamConnection: public IOStream {
+public:
+    enum State {
+        READ_NONE,
+        READ_HEADER,
+        READ_FIXED_BODY,
+        READ_CHUNK_LENGTH,
+        READ_CHUNK_DATA,
+        READ_CHUNK_ENDS,
+        READ_TRAILERS,
+        READ_UNTIL_CLOSE,
+    };
+
+    UpstreamConnection(const UpstreamPoolPtr &pool, Upstream *upstream)
+            : _pool(pool)
+            , _upstream(upstream) {
+
+    }
+
+    void onConnected() override;
+
+    void onDataRead(Byte *data, size_t length) override;
+
+    void onWriteComplete() override;
+
+    void onDisconnected(std::exception_ptr reason) override;
+
+    void attach(std::shared_ptr<ProxyHandler> handler) {
+        _handler = std::move(handler);
+    }
+
+    void detach() {
+        _handler.reset();
+    }
+
+    void writeHeaders(const std::string &method, const std::string &uri, const HTTPHeaders &headers);
+
+    void writeBody(std::string data);
+
+    void finishBody();
+
+    void readResponse();
+
+    void continueResponse();
+
+    void abort();
+
+    bool isReusable() const {
+        return _reusable;
+    }
+
+    void setIdle(bool idle) {
+        _idle = idle;
+    }
+
+    Upstream* getUpstream() const {
+        return _upstream;
+    }
+
+    static constexpr size_t CHUNK_SIZE = 64 * 1024;
+    static constexpr size_t MAX_HEADER_SIZE = 64 * 1024;
+protected:
+    void onHeaders(char *data, size_t length);
+
+    void onChunkLength(char *data, size_t length);
+
+    void onBodyData(char *data, size_t length);
+
+    void readBody(const HTTPHeaders &headers);
+
+    void readFinished();
+
+    void handleException(std::exception_ptr error);
+
+    std::weak_ptr<UpstreamPool> _pool;
+    Upstream *_upstream;
+    std::shared_ptr<ProxyHandler> _handler;
+    State _state{READ_NONE};
+    std::string _method;
+    bool _chunkingOutput{false};
+    bool _reusable{false};
+    bool _idle{false};
+    size_t _bytesToRead{0};
+    size_t _bytesRead{0};
+};
+
+
+class NET4CXX_COMMON_API ProxyHandlerArgs {
+public:
+    ProxyHandlerArgs() = default;
+
+    explicit ProxyHandlerArgs(UpstreamPoolPtr pool)
+            : _pool(std::move(pool)) {
+
+    }
+
+    void setPool(UpstreamPoolPtr pool) {
+        _pool = std::move(pool);
+    }
+
+    UpstreamPoolPtr getPool() const {
+        return _pool;
+    }
+
+    void setHashHeader(std::string hashHeader) {
+        _hashHeader = std::move(hashHeader);
+    }
+
+    const std::string& getHashHeader() const {
+        return _hashHeader;
+    }
+
+    void setConnectTimeout(double connectTimeout) {
+        _connectTimeout = connectTimeout;
+    }
+
+    double getConnectTimeout() const {
+        return _connectTimeout;
+    }
+
+    void setRequestTimeout(double requestTimeout) {
+        _requestTimeout = requestTimeout;
+    }
+
+    double getRequestTimeout() const {
+        return _requestTimeout;
+    }
+protected:
+    UpstreamPoolPtr _pool;
+    std::string _hashHeader;
+    double _connectTimeout{5.0};
+    double _requestTimeout{60.0};
+};
+
+
+class NET4CXX_COMMON_API ProxyHandler: public RequestHandler {
+public:
+    friend class UpstreamConnection;
+
+    using RequestHandler::RequestHandler;
+
+    void initialize(const boost::any &args) override;
+
+    bool hasStreamRequestBody() const override;
+
+    DeferredPtr prepare() override;
+
+    void dataReceived(std::string data) override;
+
+    DeferredPtr onHead(const StringVector &args) override;
+
+    DeferredPtr onGet(const StringVector &args) override;
+
+    DeferredPtr onPost(const StringVector &args) override;
+
+    DeferredPtr onDelete(const StringVector &args) override;
+
+    DeferredPtr onPatch(const StringVector &args) override;
+
+    DeferredPtr onPut(const StringVector &args) override;
+
+    DeferredPtr onOptions(const StringVector &args) override;
+
+    void onConnectionClose() override;
+
+    std::string computeEtag() const override;
+
+    static bool isHopByHopHeader(const std::string &name);
+
+    static constexpr size_t MAX_PENDING_BYTES = 256 * 1024;
+protected:
+    void execute(TransformsType transforms, const StringVector &args) override;
+
+    virtual std::string getHashKey() const;
+
+    virtual void prepareHeaders(HTTPHeaders &headers) const;
+
+    DeferredPtr forward();
+
+    void connectUpstream(bool reuse=true);
+
+    void sendRequest();
+
+    void onUpstreamConnected();
+
+    void onUpstreamWriteComplete();
+
+    void onUpstreamHeaders(const ResponseStartLine &startLine, const HTTPHeaders &headers);
+
+    void onUpstreamData(std::string data);
+
+    void onUpstreamFinished();
+
+    void onDownstreamDrained();
+
+    void onUpstreamError(std::exception_ptr error);
+
+    void releaseUpstream(bool success);
+
+    void removeTimeout();
+
+    void fireWaiting(std::exception_ptr error);
+
+    UpstreamPoolPtr _pool;
+    std::string _hashHeader;
+    double _connectTimeout{5.0};
+    double _requestTimeout{60.0};
+    Upstream *_upstream{nullptr};
+    UpstreamConnectionPtr _connection;
+    DeferredPtr _waiting;
+    DelayedCall _timeout;
+    size_t _bodyBytes{0};
+    size_t _pendingBytes{0};
+    int _upstreamCode{0};
+    bool _reused{false};
+    bool _retried{false};
+    bool _bodyFinished{false};
+    bool _responseStarted{false};
+    bool _waitingDrain{false};
+};
+
+NS_END
+
+#endif //NET4CXX_PLUGINS_WEB_PROXY_H
@@ -8,6 +8,19 @@
 
 NS_BEGIN
 
+bool PathSegment::matchParam(PathParamType paramType, boost::string_view segment) {
+    if (segment.empty()) {
+        return false;
+    }
+    if (paramType == PathParamType::INTEGER) {
+        return std::all_of(segment.begin(), segment.end(), [](char c) {
+            return c >= '0' && c <= '9';
+        });
+    }
+    return true;
+}
+
+
 UrlSpec::UrlSpec(std::string pattern, std::shared_ptr<BasicRequestHandlerFactory> handlerFactory, std::string name)
         : UrlSpec(std::move(pattern), std::move(handlerFactory), {}, std::move(name)) {
 
@@ -24,6 +37,10 @@ UrlSpec::UrlSpec(std::string pattern, std::shared_ptr<BasicRequestHandlerFactory
     }
     _regex = _pattern;
     std::tie(_path, _groupCount) = findGroups();
+    _compiled = compileSegments();
+    if (!_compiled) {
+        _segments.clear();
+    }
 }
 
 std::tuple<std::string, int> UrlSpec::findGroups() {
@@ -57,6 +74,79 @@ std::tuple<std::string, int> UrlSpec::findGroups() {
     return std::make_tuple(boost::join(pieces, ""), (int) _regex.mark_count());
 }
 
+bool UrlSpec::compileSegments() {
+    static const std::pair<const char *, PathParamType> paramPatterns[] = {
+            {"([^/]+)", PathParamType::STRING},
+            {R"((\d+))", PathParamType::INTEGER},
+            {"([0-9]+)", PathParamType::INTEGER},
+    };
+    size_t beg = 0, end = _pattern.size();
+    if (boost::starts_with(_pattern, "^")) {
+        ++beg;
+    }
+    if (boost::ends_with(_pattern, "$")) {
+        --end;
+    }
+    if (beg > end) {
+        return false;
+    }
+    std::string literal;
+    boost::optional<PathParamType> paramType;
+    size_t pos = beg;
+    while (true) {
+        if (pos == end || _pattern[pos] == '/') {
+            if (paramType) {
+                _segments.emplace_back(*paramType);
+            } else {
+                _segments.emplace_back(std::move(literal));
+            }
+            literal.clear();
+            paramType = boost::none;
+            if (pos == end) {
+                break;
+            }
+            ++pos;
+            continue;
+        }
+        if (paramType) {
+            return false;
+        }
+        char c = _pattern[pos];
+        if (c == '(') {
+            if (!literal.empty()) {
+                return false;
+            }
+            for (auto &paramPattern: paramPatterns) {
+                size_t length = strlen(paramPattern.first);
+                if (pos + length <= end && _pattern.compare(pos, length, paramPattern.first) == 0) {
+                    paramType = paramPattern.second;
+                    pos += length;
+                    break;
+                }
+            }
+            if (!paramType) {
+                return false;
+            }
+        } else if (c == '\\') {
+            if (pos + 1 == end) {
+                return false;
+            }
+            c = _pattern[pos + 1];
+            if (std::isalnum((unsigned char)c) || c == '/') {
+                return false;
+            }
+            literal.push_back(c);
+            pos += 2;
+        } else if (strchr(".^$*+?()[]{}|", c) != nullptr) {
+            return false;
+        } else {
+            literal.push_back(c);
+            ++pos;
+        }
+    }
+    return true;
+}
+
 std::string UrlSpec::reUnescape(const std::string &s) const {
     const boost::regex pat(R"(\\(.))");
     boost::smatch what;
@@ -78,4 +168,102 @@ std::ostream& operator<<(std::ostream &sout, const UrlSpec &url) {
     return sout;
 }
 
+
+constexpr size_t UrlRouter::NO_ROUTE;
+
+UrlRouter::UrlRouter(std::vector<UrlSpecPtr> specs)
+        : _specs(std::move(specs)) {
+    for (size_t route = 0; route != _specs.size(); ++route) {
+        if (_specs[route]->isCompiled()) {
+            insert(route, _specs[route]->getSegments());
+        } else {
+            _regexRoutes.emplace_back(route);
+        }
+    }
+}
+
+UrlSpecPtr UrlRouter::match(const std::string &path, StringVector &pathArgs) const {
+    SegmentsType segments, captures, bestCaptures;
+    size_t bestRoute = NO_ROUTE;
+    if (_root.minRoute != NO_ROUTE) {
+        boost::string_view remaining(path);
+        size_t pos;
+        while ((pos = remaining.find('/')) != boost::string_view::npos) {
+            segments.emplace_back(remaining.substr(0, pos));
+            remaining.remove_prefix(pos + 1);
+        }
+        segments.emplace_back(remaining);
+        matchNode(&_root, segments, 0, captures, bestRoute, bestCaptures);
+    }
+    boost::smatch match;
+    for (auto route: _regexRoutes) {
+        if (route >= bestRoute) {
+            break;
+        }
+        if (boost::regex_match(path, match, _specs[route]->getRegex())) {
+            for (size_t i = 1; i < match.size(); ++i) {
+                pathArgs.emplace_back(match[i].str());
+            }
+            return _specs[route];
+        }
+    }
+    if (bestRoute == NO_ROUTE) {
+        return nullptr;
+    }
+    for (auto &capture: bestCaptures) {
+        pathArgs.emplace_back(capture.data(), capture.size());
+    }
+    return _specs[bestRoute];
+}
+
+void UrlRouter::insert(size_t route, const std::vector<PathSegment> &segments) {
+    Node *node = &_root;
+    node->minRoute = std::min(node->minRoute, route);
+    for (auto &segment: segments) {
+        std::unique_ptr<Node> *child;
+        if (segment.isStatic()) {
+            child = &node->staticChildren[segment.getText()];
+        } else if (segment.getParamType() == PathParamType::INTEGER) {
+            child = &node->integerChild;
+        } else {
+            child = &node->stringChild;
+        }
+        if (!*child) {
+            *child = std::make_unique<Node>();
+        }
+        node = child->get();
+        node->minRoute = std::min(node->minRoute, route);
+    }
+    node->route = std::min(node->route, route);
+}
+
+void UrlRouter::matchNode(const Node *node, const SegmentsType &segments, size_t depth, SegmentsType &captures,
+                          size_t &bestRoute, SegmentsType &bestCaptures) const {
+    if (node->minRoute >= bestRoute) {
+        return;
+    }
+    if (depth == segments.size()) {
+        if (node->route < bestRoute) {
+            bestRoute = node->route;
+            bestCaptures = captures;
+        }
+        return;
+    }
+    const auto &segment = segments[depth];
+    auto iter = node->staticChildren.find(segment);
+    if (iter != node->staticChildren.end()) {
+        matchNode(iter->second.get(), segments, depth + 1, captures, bestRoute, bestCaptures);
+    }
+    if (node->integerChild && PathSegment::matchParam(PathParamType::INTEGER, segment)) {
+        captures.emplace_back(segment);
+        matchNode(node->integerChild.get(), segments, depth + 1, captures, bestRoute, bestCaptures);
+        captures.pop_back();
+    }
+    if (node->stringChild && PathSegment::matchParam(PathParamType::STRING, segment)) {
+        captures.emplace_back(segment);
+        matchNode(node->stringChild.get(), segments, depth + 1, captures, bestRoute, bestCaptures);
+        captures.pop_back();
+    }
+}
+
 NS_END
\ No newline at end of file
@@ -6,13 +6,54 @@
 #define NET4CXX_PLUGINS_WEB_ROUTING_H
 
 #include "net4cxx/common/common.h"
+#include <limits>
 #include "net4cxx/plugins/web/httpserver.h"
+#include "net4cxx/plugins/web/limiter.h"
 
 NS_BEGIN
 
 class BasicRequestHandlerFactory;
 
 
+enum class PathParamType {
+    NONE,
+    STRING,
+    INTEGER,
+};
+
+
+class NET4CXX_COMMON_API PathSegment {
+public:
+    explicit PathSegment(std::string text)
+            : _text(std::move(text))
+            , _paramType(PathParamType::NONE) {
+
+    }
+
+    explicit PathSegment(PathParamType paramType)
+            : _paramType(paramType) {
+
+    }
+
+    bool isStatic() const {
+        return _paramType == PathParamType::NONE;
+    }
+
+    const std::string& getText() const {
+        return _text;
+    }
+
+    PathParamType getParamType() const {
+        return _paramType;
+    }
+
+    static bool matchParam(PathParamType paramType, boost::string_view segment);
+protected:
+    std::string _text;
+    PathParamType _paramType;
+};
+
+
 class NET4CXX_COMMON_API UrlSpec: public boost::noncopyable {
 public:
     UrlSpec(std::string pattern, std::shared_ptr<BasicRequestHandlerFactory> handlerFactory, std::string name);
@@ -52,9 +93,27 @@ public:
     const boost::any& getArgs() const {
         return _args;
     }
+
+    bool isCompiled() const {
+        return _compiled;
+    }
+
+    const std::vector<PathSegment>& getSegments() const {
+        return _segments;
+    }
+
+    void setLimiter(ConcurrencyLimiterPtr limiter) {
+        _limiter = std::move(limiter);
+    }
+
+    const ConcurrencyLimiterPtr& getLimiter() const {
+        return _limiter;
+    }
 protected:
     std::tuple<std::string, int> findGroups();
 
+    bool compileSegments();
+
     std::string reUnescape(const std::string &s) const;
 
     std::string _pattern;
@@ -64,12 +123,54 @@ protected:
     std::string _name;
     std::string _path;
     int _groupCount;
+    bool _compiled{false};
+    std::vector<PathSegment> _segments;
+    ConcurrencyLimiterPtr _limiter;
 };
 
 using UrlSpecPtr = std::shared_ptr<UrlSpec>;
 
 NET4CXX_COMMON_API std::ostream& operator<<(std::ostream &sout, const UrlSpec &url);
 
+
+class NET4CXX_COMMON_API UrlRouter: public boost::noncopyable {
+public:
+    explicit UrlRouter(std::vector<UrlSpecPtr> specs);
+
+    UrlSpecPtr match(const std::string &path, StringVector &pathArgs) const;
+
+    size_t getTreeRouteCount() const {
+        return _specs.size() - _regexRoutes.size();
+    }
+
+    size_t getRegexRouteCount() const {
+        return _regexRoutes.size();
+    }
+
+    static constexpr size_t NO_ROUTE = std::numeric_limits<size_t>::max();
+protected:
+    struct Node {
+        std::map<std::string, std::unique_ptr<Node>, std::less<>> staticChildren;
+        std::unique_ptr<Node> stringChild;
+        std::unique_ptr<Node> integerChild;
+        size_t route{NO_ROUTE};
+        size_t minRoute{NO_ROUTE};
+    };
+
+    using SegmentsType = std::vector<boost::string_view>;
+
+    void insert(size_t route, const std::vector<PathSegment> &segments);
+
+    void matchNode(const Node *node, const SegmentsType &segments, size_t depth, SegmentsType &captures,
+                   size_t &bestRoute, SegmentsType &bestCaptures) const;
+
+    std::vector<UrlSpecPtr> _specs;
+    Node _root;
+    std::vector<size_t> _regexRoutes;
+};
+
+using UrlRouterPtr = std::shared_ptr<const UrlRouter>;
+
 using urls = std::vector<std::shared_ptr<UrlSpec>>;
 
 NS_END
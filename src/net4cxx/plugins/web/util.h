@@ -6,7 +6,7 @@
 #define NET4CXX_PLUGINS_WEB_UTIL_H
 
 #include "net4cxx/common/common.h"
-#include "net4cxx/common/compress/zlib.h"
+#include "net4cxx/common/compress/compressor.h"
 #include "net4cxx/common/debugging/watcher.h"
 #include "net4cxx/core/network/reactor.h"
 #include "net4cxx/shared/global/constants.h"
@@ -94,47 +94,55 @@ inline DeferredPtr sleepAsync(Reactor *reactor, double timeout) {
 class NET4CXX_COMMON_API GzipDecompressor {
 public:
     GzipDecompressor()
-            : _decompressObj(16 + Zlib::maxWBits) {
+            : _decompressor(CompressorPool::acquireDecompressor(16 + Zlib::maxWBits)) {
 
     }
 
     ByteArray decompress(const Byte *data, size_t len, size_t maxLength=0) {
-        return _decompressObj.decompress(data, len, maxLength);
+        ByteArray retVal;
+        _decompressor->decompress(data, len, retVal, maxLength);
+        return retVal;
     }
 
     ByteArray decompress(const ByteArray &data, size_t maxLength=0) {
-        return _decompressObj.decompress(data, maxLength);
+        return decompress(data.data(), data.size(), maxLength);
     }
 
     ByteArray decompress(const std::string &data, size_t maxLength=0) {
-        return _decompressObj.decompress(data, maxLength);
+        return decompress((const Byte *)data.data(), data.size(), maxLength);
     }
 
     std::string decompressToString(const Byte *data, size_t len, size_t maxLength=0) {
-        return _decompressObj.decompressToString(data, len, maxLength);
+        std::string retVal;
+        _decompressor->decompress(data, len, retVal, maxLength);
+        return retVal;
     }
 
     std::string decompressToString(const ByteArray &data, size_t maxLength=0) {
-        return _decompressObj.decompressToString(data, maxLength);
+        return decompressToString(data.data(), data.size(), maxLength);
     }
 
     std::string decompressToString(const std::string &data, size_t maxLength=0) {
-        return _decompressObj.decompressToString(data, maxLength);
+        return decompressToString((const Byte *)data.data(), data.size(), maxLength);
     }
 
     ByteArray flush() {
-        return _decompressObj.flush();
+        ByteArray retVal;
+        _decompressor->flush(retVal);
+        return retVal;
     }
 
     std::string flushToString() {
-        return _decompressObj.flushToString();
+        std::string retVal;
+        _decompressor->flush(retVal);
+        return retVal;
     }
 
     const ByteArray& getUnconsumedTail() const {
-        return _decompressObj.getUnconsumedTail();
+        return _decompressor->getUnconsumedTail();
     }
 protected:
-    DecompressObj _decompressObj;
+    CompressorPool::DecompressorPtr _decompressor;
 };
 
 NS_END
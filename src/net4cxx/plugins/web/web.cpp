@@ -3,8 +3,17 @@
 //
 
 #include "net4cxx/plugins/web/web.h"
+#include <fstream>
+#include <boost/filesystem.hpp>
 #include "net4cxx/common/crypto/hashlib.h"
+#include "net4cxx/common/utilities/random.h"
 #include "net4cxx/core/network/defer.h"
+#include "net4cxx/plugins/web/metrics.h"
+
+#if PLATFORM == PLATFORM_UNIX
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 
 NS_BEGIN
@@ -28,6 +37,8 @@ RequestHandler::~RequestHandler() {
 
 void RequestHandler::start(const boost::any &args) {
     _request->getConnection()->setCloseCallback([this, self=shared_from_this()](){
+        // The client is gone, give the permits back without judging the latency
+        _permits.clear();
         onConnectionClose();
     });
     initialize(args);
@@ -84,6 +95,20 @@ void RequestHandler::onConnectionClose() {
 
 }
 
+void RequestHandler::pauseReading() {
+    auto connection = _request->getConnection();
+    if (connection) {
+        connection->pauseReading();
+    }
+}
+
+void RequestHandler::resumeReading() {
+    auto connection = _request->getConnection();
+    if (connection) {
+        connection->resumeReading();
+    }
+}
+
 bool RequestHandler::hasStreamRequestBody() const {
     return false;
 }
@@ -96,7 +121,7 @@ void RequestHandler::clear() {
     _headers = HTTPHeaders({
                                    {"Server", NET4CXX_VER },
                                    {"Content-Type", "text/html; charset=UTF-8"},
-                                   {"Date", HTTPUtil::formatTimestamp(time(nullptr))},
+                                   {"Date", HTTPUtil::formatCurrentTimestamp()},
                            });
     setDefaultHeaders();
 //    _writeBuffer.clear();
@@ -175,8 +200,8 @@ void RequestHandler::redirect(const std::string &url, bool permanent, boost::opt
 
 void RequestHandler::flush(bool includeFooters, FlushCallbackType callback) {
     auto connection = getConnection();
-    std::string chunk = boost::join(_writeBuffer, "");
-    _writeBuffer.clear();
+    BufferChain chunk;
+    chunk.swap(_writeBuffer);
     if (!_headersWritten) {
         _headersWritten = true;
         for (auto &transform: _transforms) {
@@ -185,19 +210,21 @@ void RequestHandler::flush(bool includeFooters, FlushCallbackType callback) {
         if (_request->getMethod() == "HEAD") {
             chunk.clear();
         }
+        _bytesOut += chunk.size();
         if (_newCookie) {
             _newCookie->getAll([this](const std::string &key, const Morsel &cookie) {
                 addHeader("Set-Cookie", cookie.outputString());
             });
         }
         auto startLine = ResponseStartLine("", _statusCode, _reason);
-        connection->writeHeaders(std::move(startLine), _headers, chunk, std::move(callback));
+        connection->writeHeaders(std::move(startLine), _headers, std::move(chunk), std::move(callback));
     } else {
         for (auto &transform: _transforms) {
             transform->transformChunk(chunk, includeFooters);
         }
         if (_request->getMethod() != "HEAD") {
-            connection->writeChunk(chunk, std::move(callback));
+            _bytesOut += chunk.size();
+            connection->writeChunk(std::move(chunk), std::move(callback));
         }
     }
 }
@@ -217,21 +244,36 @@ void RequestHandler::finish() {
             NET4CXX_ASSERT_THROW(_writeBuffer.empty(), "Cannot send body with %d", _statusCode);
             clearHeadersFor304();
         } else if (!_headers.has("Content-Length")) {
-            size_t contentLength = std::accumulate(_writeBuffer.begin(), _writeBuffer.end(), (size_t)0,
-                                                   [](size_t lhs, const std::string &rhs) {
-                                                       return lhs + rhs.size();
-                                                   });
-            setHeader("Content-Length", contentLength);
+            setHeader("Content-Length", _writeBuffer.size());
         }
     }
     auto connection = _request->getConnection();
     if (connection) {
         connection->setCloseCallback(nullptr);
     }
-    flush(true);
+    auto &metrics = _application->getMetrics();
+    auto finishTime = TimestampClock::now();
+    if (metrics) {
+        // The last write has drained once the callback runs
+        flush(true, [metrics, spec=_spec, statusCode=_statusCode, finishTime]() {
+            metrics->recordWrite(spec, statusCode, TimestampClock::now() - finishTime);
+        });
+    } else {
+        flush(true);
+    }
     _request->finish();
     log();
     _finished = true;
+    if (metrics) {
+        auto dispatchTime = _dispatchTime == Timestamp() ? _executeTime : _dispatchTime;
+        auto executeTime = _executeTime == Timestamp() ? finishTime : _executeTime;
+        metrics->record(_spec, _statusCode, std::max(_bytesIn, _request->getBody().size()), _bytesOut,
+                        executeTime - dispatchTime, finishTime - executeTime);
+    }
+    for (auto &permit: _permits) {
+        permit.release(_statusCode >= 500);
+    }
+    _permits.clear();
     onFinish();
 }
 
@@ -289,8 +331,8 @@ void RequestHandler::writeError(int statusCode, const std::exception_ptr &error)
 
 std::string RequestHandler::computeEtag() const {
     SHA1Object hasher;
-    for (auto &part: _writeBuffer) {
-        hasher.update(part);
+    for (auto &buffer: _writeBuffer) {
+        hasher.update(buffer.getReadPointer(), buffer.getActiveSize());
     }
     std::string etag = "\"" + hasher.hex() + "\"";
     return etag;
@@ -372,6 +414,7 @@ StringVector RequestHandler::getArguments(const std::string &name, const QueryAr
 }
 
 void RequestHandler::execute(TransformsType transforms, const StringVector &args) {
+    _executeTime = TimestampClock::now();
     _transforms = std::move(transforms);
     std::exception_ptr error;
     try {
@@ -382,7 +425,15 @@ void RequestHandler::execute(TransformsType transforms, const StringVector &args
         _pathArgs = args;
         auto result = prepare();
         if (result) {
-            result->addCallbacks([this, self=shared_from_this()](DeferredValue value) {
+            // Stop reading the streamed body until prepare has completed
+            bool streaming = hasStreamRequestBody();
+            if (streaming) {
+                pauseReading();
+            }
+            result->addCallbacks([this, self=shared_from_this(), streaming](DeferredValue value) {
+                if (streaming) {
+                    resumeReading();
+                }
                 whenComplete();
                 return value;
             }, [this, self=shared_from_this()](DeferredValue value) {
@@ -409,6 +460,10 @@ void RequestHandler::execute(TransformsType transforms, const StringVector &args
 }
 
 void RequestHandler::whenComplete() {
+    if (hasStreamRequestBody() && !_requestBodyReceived) {
+        _waitingRequestBody = true;
+        return;
+    }
     std::exception_ptr error;
     try {
         executeMethod();
@@ -424,6 +479,34 @@ void RequestHandler::whenComplete() {
     }
 }
 
+void RequestHandler::receiveRequestData(std::string data) {
+    if (_finished) {
+        return;
+    }
+    _bytesIn += data.size();
+    std::exception_ptr error;
+    try {
+        dataReceived(std::move(data));
+    } catch (...) {
+        error = std::current_exception();
+    }
+    if (error) {
+        try {
+            handleRequestException(error);
+        } catch (std::exception &e) {
+            NET4CXX_LOG_ERROR(gAppLog, "Exception in exception handler: %s", e.what());
+        }
+    }
+}
+
+void RequestHandler::requestBodyReceived() {
+    _requestBodyReceived = true;
+    if (_waitingRequestBody) {
+        _waitingRequestBody = false;
+        whenComplete();
+    }
+}
+
 void RequestHandler::executeMethod() {
     if (!_finished) {
         DeferredPtr result;
@@ -513,6 +596,24 @@ DeferredPtr ErrorHandler::prepare() {
 }
 
 
+void LoadShedHandler::initialize(const boost::any &args) {
+    const auto &arg = boost::any_cast<const LoadShedHandlerArgs&>(args);
+    _retryAfter = arg.getRetryAfter();
+}
+
+bool LoadShedHandler::hasStreamRequestBody() const {
+    // Whatever body is still coming is simply dropped
+    return true;
+}
+
+DeferredPtr LoadShedHandler::prepare() {
+    setStatus(503);
+    setHeader("Retry-After", _retryAfter);
+    writeError(503, nullptr);
+    return nullptr;
+}
+
+
 void RedirectHandler::initialize(const boost::any &args) {
     const auto &arg = boost::any_cast<const RedirectHandlerArgs&>(args);
     _url = arg.getUrl();
@@ -553,6 +654,398 @@ DeferredPtr FallbackHandler::prepare() {
 }
 
 
+StaticFileInfoPtr StaticFileCache::get(const std::string &path) {
+    auto now = TimestampClock::now();
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        auto iter = _entries.find(path);
+        if (iter != _entries.end() && now - iter->second.validated < _revalidateInterval) {
+            _lru.splice(_lru.begin(), _lru, iter->second.position);
+            return iter->second.info;
+        }
+    }
+    boost::system::error_code ec;
+    auto status = boost::filesystem::status(path, ec);
+    if (ec || !boost::filesystem::is_regular_file(status)) {
+        std::lock_guard<std::mutex> lock(_lock);
+        auto iter = _entries.find(path);
+        if (iter != _entries.end()) {
+            erase(iter);
+        }
+        return nullptr;
+    }
+    auto size = (size_t)boost::filesystem::file_size(path, ec);
+    if (ec) {
+        return nullptr;
+    }
+    auto modified = boost::filesystem::last_write_time(path, ec);
+    if (ec) {
+        return nullptr;
+    }
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        auto iter = _entries.find(path);
+        if (iter != _entries.end()) {
+            auto &entry = iter->second;
+            if (entry.info->getSize() == size && entry.info->getModified() == modified) {
+                entry.validated = now;
+                _lru.splice(_lru.begin(), _lru, entry.position);
+                return entry.info;
+            }
+            erase(iter);
+        }
+    }
+    auto info = load(path, size, modified);
+    if (info && info->getContent()) {
+        std::lock_guard<std::mutex> lock(_lock);
+        insert(path, info, now);
+    }
+    return info;
+}
+
+StaticFileInfoPtr StaticFileCache::load(const std::string &path, size_t size, time_t modified) const {
+    if (size > _maxFileSize || _maxEntries == 0) {
+        return std::make_shared<StaticFileInfo>(path, size, modified, nullptr);
+    }
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file) {
+        return nullptr;
+    }
+    auto content = std::make_shared<std::string>(size, '\0');
+    file.read(&(*content)[0], (std::streamsize)size);
+    content->resize((size_t)file.gcount());
+    return std::make_shared<StaticFileInfo>(path, content->size(), modified, std::move(content));
+}
+
+void StaticFileCache::insert(const std::string &path, StaticFileInfoPtr info, Timestamp now) {
+    auto iter = _entries.find(path);
+    if (iter != _entries.end()) {
+        erase(iter);
+    }
+    _lru.push_front(path);
+    _totalSize += info->getSize();
+    _entries.emplace(path, Entry{std::move(info), now, _lru.begin()});
+    while (!_lru.empty() && (_entries.size() > _maxEntries || _totalSize > _maxTotalSize)) {
+        erase(_entries.find(_lru.back()));
+    }
+}
+
+void StaticFileCache::erase(EntryMap::iterator iter) {
+    _totalSize -= iter->second.info->getSize();
+    _lru.erase(iter->second.position);
+    _entries.erase(iter);
+}
+
+
+constexpr size_t StaticFileHandler::MAX_RANGES;
+
+constexpr size_t StaticFileHandler::READ_CHUNK_SIZE;
+
+void StaticFileHandler::initialize(const boost::any &args) {
+    const auto &arg = boost::any_cast<const StaticFileHandlerArgs&>(args);
+    _root = arg.getPath();
+    while (_root.size() > 1 && boost::ends_with(_root, "/")) {
+        _root.pop_back();
+    }
+    _defaultFilename = arg.getDefaultFilename();
+    _precompressed = arg.getPrecompressed();
+    _maxAge = arg.getMaxAge();
+    _cache = arg.getCache();
+    if (!_cache) {
+        _cache = std::make_shared<StaticFileCache>(0);
+    }
+}
+
+DeferredPtr StaticFileHandler::onHead(const StringVector &args) {
+    get(args.empty() ? std::string{} : args[0], false);
+    return nullptr;
+}
+
+DeferredPtr StaticFileHandler::onGet(const StringVector &args) {
+    get(args.empty() ? std::string{} : args[0], true);
+    return nullptr;
+}
+
+std::string StaticFileHandler::computeEtag() const {
+    return _file ? _file->getEtag() : RequestHandler::computeEtag();
+}
+
+std::string StaticFileHandler::getContentType(const std::string &path) {
+    static const std::map<std::string, std::string> contentTypes = {
+            {".css", "text/css"},
+            {".csv", "text/csv"},
+            {".gif", "image/gif"},
+            {".gz", "application/gzip"},
+            {".htm", "text/html"},
+            {".html", "text/html"},
+            {".ico", "image/x-icon"},
+            {".jpeg", "image/jpeg"},
+            {".jpg", "image/jpeg"},
+            {".js", "application/javascript"},
+            {".json", "application/json"},
+            {".map", "application/json"},
+            {".mp3", "audio/mpeg"},
+            {".mp4", "video/mp4"},
+            {".pdf", "application/pdf"},
+            {".png", "image/png"},
+            {".svg", "image/svg+xml"},
+            {".ttf", "font/ttf"},
+            {".txt", "text/plain"},
+            {".wasm", "application/wasm"},
+            {".webm", "video/webm"},
+            {".webp", "image/webp"},
+            {".woff", "font/woff"},
+            {".woff2", "font/woff2"},
+            {".xml", "application/xml"},
+            {".zip", "application/zip"},
+    };
+    auto slash = path.rfind('/');
+    auto dot = path.rfind('.');
+    if (dot != std::string::npos && (slash == std::string::npos || dot > slash)) {
+        auto iter = contentTypes.find(boost::to_lower_copy(path.substr(dot)));
+        if (iter != contentTypes.end()) {
+            return iter->second;
+        }
+    }
+    return "application/octet-stream";
+}
+
+boost::optional<StaticFileHandler::RangeListType> StaticFileHandler::parseRange(const std::string &range,
+                                                                                size_t size) {
+    auto equals = range.find('=');
+    if (equals == std::string::npos || boost::trim_copy(range.substr(0, equals)) != "bytes") {
+        return boost::none;
+    }
+    StringVector specs;
+    boost::split(specs, range.substr(equals + 1), boost::is_any_of(","));
+    if (specs.size() > MAX_RANGES) {
+        return boost::none;
+    }
+    RangeListType ranges;
+    for (auto &spec: specs) {
+        boost::trim(spec);
+        auto dash = spec.find('-');
+        if (dash == std::string::npos) {
+            return boost::none;
+        }
+        auto first = spec.substr(0, dash), last = spec.substr(dash + 1);
+        if ((first.empty() && last.empty()) ||
+            !std::all_of(first.begin(), first.end(), ::isdigit) ||
+            !std::all_of(last.begin(), last.end(), ::isdigit) ||
+            first.size() > 18 || last.size() > 18) {
+            return boost::none;
+        }
+        if (first.empty()) {
+            auto suffix = std::stoull(last);
+            if (suffix != 0) {
+                ranges.emplace_back(suffix < size ? size - suffix : 0, size - 1);
+            }
+            continue;
+        }
+        auto start = std::stoull(first);
+        auto end = last.empty() ? std::numeric_limits<unsigned long long>::max() : std::stoull(last);
+        if (end < start) {
+            return boost::none;
+        }
+        if (start < size) {
+            ranges.emplace_back(start, std::min<size_t>(end, size - 1));
+        }
+    }
+    return ranges;
+}
+
+void StaticFileHandler::get(const std::string &path, bool includeBody) {
+    auto absolutePath = validateAbsolutePath(path);
+    if (absolutePath.empty()) {
+        return;
+    }
+    bool gzipped = false;
+    if (_precompressed) {
+        addHeader("Vary", "Accept-Encoding");
+        if (_request->getHTTPHeaders()->get("Accept-Encoding").find("gzip") != std::string::npos) {
+            _file = _cache->get(absolutePath + ".gz");
+            gzipped = (bool)_file;
+        }
+    }
+    if (!_file) {
+        _file = _cache->get(absolutePath);
+        if (!_file) {
+            NET4CXX_THROW_EXCEPTION(HTTPError, "") << errinfo_http_code(404);
+        }
+    }
+    // The body is sent as stored on disk, either as is or as a byte range of it
+    _transforms.clear();
+    auto modified = boost::posix_time::from_time_t(_file->getModified());
+    setHeader("Etag", _file->getEtag());
+    setHeader("Last-Modified", modified);
+    setHeader("Accept-Ranges", "bytes");
+    setHeader("Content-Type", getContentType(absolutePath));
+    if (gzipped) {
+        setHeader("Content-Encoding", "gzip");
+    }
+    if (_maxAge > 0) {
+        setHeader("Expires", boost::posix_time::second_clock::universal_time() + boost::posix_time::seconds(_maxAge));
+        setHeader("Cache-Control", "max-age=" + std::to_string(_maxAge));
+    }
+    if (shouldReturn304()) {
+        setStatus(304);
+        return;
+    }
+    size_t size = _file->getSize();
+    RangeListType ranges;
+    auto headers = _request->getHTTPHeaders();
+    auto range = headers->get("Range");
+    auto ifRange = headers->get("If-Range");
+    if (!range.empty() && size != 0 &&
+        (ifRange.empty() || ifRange == _file->getEtag() || ifRange == HTTPUtil::formatTimestamp(modified))) {
+        auto parsed = parseRange(range, size);
+        if (parsed) {
+            if (parsed->empty()) {
+                setStatus(416);
+                clearHeader("Content-Encoding");
+                setHeader("Content-Type", "text/plain");
+                setHeader("Content-Range", StrUtil::format("bytes */%lu", size));
+                return;
+            }
+            ranges = std::move(*parsed);
+        }
+    }
+    if (ranges.empty()) {
+        setHeader("Content-Length", size);
+        if (includeBody) {
+            writeContent(0, size);
+        }
+    } else if (ranges.size() == 1) {
+        auto start = ranges[0].first, end = ranges[0].second;
+        setStatus(206);
+        setHeader("Content-Range", StrUtil::format("bytes %lu-%lu/%lu", start, end, size));
+        setHeader("Content-Length", end - start + 1);
+        if (includeBody) {
+            writeContent(start, end - start + 1);
+        }
+    } else {
+        std::array<Byte, 12> random;
+        Random::randBytes(random);
+        auto boundary = BinAscii::hexlify(random.data(), random.size());
+        auto contentType = _headers.get("Content-Type");
+        StringVector parts;
+        size_t contentLength = 0;
+        for (auto &r: ranges) {
+            parts.emplace_back(StrUtil::format("\r\n--%s\r\nContent-Type: %s\r\nContent-Range: bytes %lu-%lu/%lu\r\n\r\n",
+                                               boundary, contentType, r.first, r.second, size));
+            contentLength += parts.back().size() + (r.second - r.first + 1);
+        }
+        auto trailer = StrUtil::format("\r\n--%s--\r\n", boundary);
+        contentLength += trailer.size();
+        setStatus(206);
+        setHeader("Content-Type", "multipart/byteranges; boundary=" + boundary);
+        setHeader("Content-Length", contentLength);
+        if (includeBody) {
+            for (size_t i = 0; i != ranges.size(); ++i) {
+                write(std::move(parts[i]));
+                writeContent(ranges[i].first, ranges[i].second - ranges[i].first + 1);
+            }
+            write(std::move(trailer));
+        }
+    }
+}
+
+std::string StaticFileHandler::validateAbsolutePath(const std::string &path) {
+    StringVector segments;
+    boost::split(segments, UrlParse::unquote(path), boost::is_any_of("/"));
+    std::string absolutePath = _root;
+    for (auto &segment: segments) {
+        if (segment.empty() || segment == ".") {
+            continue;
+        }
+        if (segment == ".." || segment.find('\\') != std::string::npos || segment.find('\0') != std::string::npos) {
+            NET4CXX_THROW_EXCEPTION(HTTPError, "%s is not in root static directory", path)
+                << errinfo_http_code(403);
+        }
+        absolutePath += '/';
+        absolutePath += segment;
+    }
+    boost::system::error_code ec;
+    auto status = boost::filesystem::status(absolutePath, ec);
+    if (ec || !boost::filesystem::exists(status)) {
+        NET4CXX_THROW_EXCEPTION(HTTPError, "") << errinfo_http_code(404);
+    }
+    if (boost::filesystem::is_directory(status)) {
+        if (_defaultFilename.empty()) {
+            NET4CXX_THROW_EXCEPTION(HTTPError, "%s is a directory", path) << errinfo_http_code(403);
+        }
+        if (!boost::ends_with(_request->getPath(), "/")) {
+            redirect(_request->getPath() + "/", true);
+            return {};
+        }
+        absolutePath += '/';
+        absolutePath += _defaultFilename;
+    }
+    return absolutePath;
+}
+
+bool StaticFileHandler::shouldReturn304() const {
+    auto headers = _request->getHTTPHeaders();
+    if (headers->has("If-None-Match")) {
+        return checkEtagHeader();
+    }
+    auto ifModifiedSince = headers->get("If-Modified-Since");
+    if (!ifModifiedSince.empty()) {
+        auto since = DateTimeUtil::parseUTCDate(ifModifiedSince);
+        if (!since.is_special() && since >= boost::posix_time::from_time_t(_file->getModified())) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void StaticFileHandler::openFile() {
+#if PLATFORM == PLATFORM_UNIX
+    if (!_fd) {
+        int fd = ::open(_file->getPath().c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            NET4CXX_THROW_EXCEPTION(HTTPError, "") << errinfo_http_code(404);
+        }
+        _fd.reset(new int(fd), [](int *fd) {
+            ::close(*fd);
+            delete fd;
+        });
+    }
+#endif
+}
+
+void StaticFileHandler::writeContent(size_t start, size_t length) {
+    auto content = _file->getContent();
+    if (content) {
+        write(content->substr(start, length));
+        return;
+    }
+    auto connection = getConnection();
+    if (connection->supportsWriteFile()) {
+        openFile();
+        flush();
+        connection->writeFile(FileRegion(*_fd, start, length, _fd));
+        return;
+    }
+    std::ifstream file(_file->getPath(), std::ios::in | std::ios::binary);
+    if (!file) {
+        NET4CXX_THROW_EXCEPTION(HTTPError, "") << errinfo_http_code(404);
+    }
+    file.seekg((std::streamoff)start);
+    std::string chunk;
+    while (length != 0) {
+        chunk.resize(std::min(length, READ_CHUNK_SIZE));
+        file.read(&chunk[0], (std::streamsize)chunk.size());
+        if ((size_t)file.gcount() != chunk.size()) {
+            NET4CXX_THROW_EXCEPTION(IOError, "Unexpected end of file %s", _file->getPath());
+        }
+        length -= chunk.size();
+        write(std::move(chunk));
+        flush();
+    }
+}
+
+
 const StringSet GZipContentEncoding::CONTENT_TYPES = {
         "application/javascript",
         "application/x-javascript",
@@ -573,7 +1066,7 @@ GZipContentEncoding::GZipContentEncoding(const std::shared_ptr<HTTPServerRequest
     _gzipping = acceptEncoding.find("gzip") != std::string::npos;
 }
 
-void GZipContentEncoding::transformFirstChunk(int &statusCode, HTTPHeaders &headers, std::string &chunk,
+void GZipContentEncoding::transformFirstChunk(int &statusCode, HTTPHeaders &headers, BufferChain &chunk,
                                               bool finishing) {
     if (headers.has("Vary")) {
         headers["Vary"] = headers.at("Vary") + ", Accept-Encoding";
@@ -592,8 +1085,7 @@ void GZipContentEncoding::transformFirstChunk(int &statusCode, HTTPHeaders &head
     }
     if (_gzipping) {
         headers["Content-Encoding"] = "gzip";
-        _gzipValue = std::make_shared<std::stringstream>();
-        _gzipFile.initWithOutputStream(_gzipValue, GZIP_LEVEL);
+        _compressor = CompressorPool::acquireCompressor(GZIP_LEVEL, 16 + Zlib::maxWBits);
         transformChunk(chunk, finishing);
         if (headers.has("Content-Length")) {
             if (finishing) {
@@ -605,17 +1097,19 @@ void GZipContentEncoding::transformFirstChunk(int &statusCode, HTTPHeaders &head
     }
 }
 
-void GZipContentEncoding::transformChunk(std::string &chunk, bool finishing) {
+void GZipContentEncoding::transformChunk(BufferChain &chunk, bool finishing) {
     if (_gzipping) {
-        _gzipFile.write(chunk);
+        std::string compressed;
+        compressed.reserve(_compressor->bound(chunk.size()));
+        for (auto &buffer: chunk) {
+            _compressor->compress(buffer.getReadPointer(), buffer.getActiveSize(), compressed);
+        }
+        _compressor->flush(compressed, finishing ? Zlib::zFinish : Zlib::zSyncFlush);
+        chunk.clear();
+        chunk.append(std::move(compressed));
         if (finishing) {
-            _gzipFile.close();
-        } else {
-            _gzipFile.flush();
+            _compressor.reset();
         }
-        auto length = _gzipValue->tellp() - _gzipValue->tellg();
-        chunk.resize((size_t)length);
-        _gzipValue->read((char *)chunk.data(), length);
     }
 }
 
@@ -625,6 +1119,47 @@ bool GZipContentEncoding::compressibleType(const std::string &ctype) {
 
 
 void RequestDispatcher::execute() {
+    if (_dispatchTime == Timestamp()) {
+        _dispatchTime = TimestampClock::now();
+    }
+    while (_permits.size() < _limiters.size()) {
+        auto connection = _connection.lock();
+        if (!connection) {
+            return;
+        }
+        auto limiter = _limiters[_permits.size()];
+        auto admission = limiter->acquire(connection->reactor(), [this, self=shared_from_this(), limiter](
+                bool admitted) {
+            auto connection = _connection.lock();
+            if (!connection) {
+                _permits.clear();
+                return;
+            }
+            connection->resumeReading();
+            if (admitted) {
+                _permits.emplace_back(limiter);
+                execute();
+            } else {
+                shed(limiter);
+            }
+        });
+        if (admission == ConcurrencyLimiter::REJECTED) {
+            shed(limiter);
+            return;
+        }
+        if (admission == ConcurrencyLimiter::QUEUED) {
+            // Nothing more is read from the connection while the request waits for its turn
+            connection->pauseReading();
+            return;
+        }
+        _permits.emplace_back(limiter);
+    }
+    for (auto &permit: _permits) {
+        _handler->_permits.emplace_back(std::move(permit));
+    }
+    _permits.clear();
+    _handler->_spec = _spec;
+    _handler->_dispatchTime = _dispatchTime;
     RequestHandler::TransformsType transforms;
     for (auto &transform: _application->getTransforms()) {
         transforms.emplace_back(transform->create(_request));
@@ -633,25 +1168,27 @@ void RequestDispatcher::execute() {
 }
 
 void RequestDispatcher::findHandler() {
-    auto handlers = _application->getHostHandlers(_request);
-    if (handlers.empty()) {
+    auto router = _application->getHostRouter(_request);
+    if (!router) {
         RedirectHandlerArgs handlerArgs(_request->getProtocol() + "://" + _application->getDefaultHost() + "/");
         _handler = RequestHandlerFactory<RedirectHandler>().create(_application, _request, handlerArgs);
         return;
     }
-    const std::string &requestPath = _request->getPath();
-    boost::smatch match;
-    for (auto &spec: handlers) {
-        if (boost::regex_match(requestPath, match, spec->getRegex())) {
-            _handler = spec->getHandlerFactory()->create(_application, _request, spec->getArgs());
-            for (int i = 1; i < (int)match.size(); ++i) {
-                _pathArgs.emplace_back(match[i].str());
-            }
-            for (auto &s: _pathArgs) {
-                s = UrlParse::unquote(s);
-            }
-            return;
+    auto spec = router->match(_request->getPath(), _pathArgs);
+    _spec = spec.get();
+    _limiters.clear();
+    if (spec && spec->getLimiter()) {
+        _limiters.emplace_back(spec->getLimiter());
+    }
+    if (_application->getConcurrencyLimiter()) {
+        _limiters.emplace_back(_application->getConcurrencyLimiter());
+    }
+    if (spec) {
+        _handler = spec->getHandlerFactory()->create(_application, _request, spec->getArgs());
+        for (auto &s: _pathArgs) {
+            s = UrlParse::unquote(s);
         }
+        return;
     }
     if (_application->getDefaultHandlerFactory()) {
         _handler = _application->getDefaultHandlerFactory()->create(_application, _request,
@@ -662,6 +1199,18 @@ void RequestDispatcher::findHandler() {
     }
 }
 
+void RequestDispatcher::shed(const ConcurrencyLimiterPtr &limiter) {
+    _permits.clear();
+    if (!_request->getConnection()) {
+        return;
+    }
+    _handler = RequestHandlerFactory<LoadShedHandler>().create(_application, _request,
+                                                               LoadShedHandlerArgs(limiter->getRetryAfter()));
+    _handler->_spec = _spec;
+    _handler->_dispatchTime = _dispatchTime;
+    _handler->execute({}, _pathArgs);
+}
+
 
 WebApp::WebApp(HandlersType handlers, bool compressResponse, std::string defaultHost, TransformsType transforms)
         : _defaultHost(std::move(defaultHost)) {
@@ -681,7 +1230,14 @@ ProtocolPtr WebApp::buildProtocol(const Address &address) {
     return std::make_shared<HTTPConnection>(_maxBufferSize);
 }
 
+constexpr size_t WebApp::MAX_CACHED_HOSTS;
+
 void WebApp::addHandlers(std::string hostPattern, HandlersType hostHandlers) {
+    {
+        std::lock_guard<std::mutex> lock(_routersLock);
+        _hostRouters.clear();
+        _routers.clear();
+    }
     if (!boost::ends_with(hostPattern, "$")) {
         hostPattern.push_back('$');
     }
@@ -702,6 +1258,14 @@ void WebApp::addHandlers(std::string hostPattern, HandlersType hostHandlers) {
     }
 }
 
+void WebApp::setMetricsEnabled(bool metricsEnabled) {
+    if (!metricsEnabled) {
+        _metrics.reset();
+    } else if (!_metrics) {
+        _metrics = std::make_shared<RequestMetrics>();
+    }
+}
+
 void WebApp::logRequest(const std::shared_ptr<const RequestHandler> &handler) const {
     if (_logFunction) {
         _logFunction(handler);
@@ -720,23 +1284,53 @@ void WebApp::logRequest(const std::shared_ptr<const RequestHandler> &handler) co
     }
 }
 
-std::vector<UrlSpecPtr> WebApp::getHostHandlers(const std::shared_ptr<const HTTPServerRequest> &request) const {
+UrlRouterPtr WebApp::getHostRouter(const std::shared_ptr<const HTTPServerRequest> &request) const {
     std::string host;
     std::tie(host, std::ignore) = HTTPUtil::splitHostAndPort(boost::to_lower_copy(request->getHost()));
-    std::vector<UrlSpecPtr> matches;
+    auto router = findHostRouter(host);
+    if (!router && !request->getHTTPHeaders()->has("X-Real-Ip")) {
+        router = findHostRouter(_defaultHost);
+    }
+    return router;
+}
+
+UrlRouterPtr WebApp::findHostRouter(const std::string &host) const {
+    std::lock_guard<std::mutex> lock(_routersLock);
+    auto iter = _hostRouters.find(host);
+    if (iter != _hostRouters.end()) {
+        return iter->second;
+    }
+    std::vector<size_t> groups;
+    size_t index = 0;
     for (auto &handler: _handlers) {
         if (boost::regex_match(host, handler.first)) {
-            matches.insert(matches.end(), handler.second.begin(), handler.second.end());
+            groups.emplace_back(index);
         }
+        ++index;
     }
-    if (matches.empty() && !request->getHTTPHeaders()->has("X-Real-Ip")) {
-        for (auto &handler: _handlers) {
-            if (boost::regex_match(_defaultHost, handler.first)) {
-                matches.insert(matches.end(), handler.second.begin(), handler.second.end());
+    UrlRouterPtr router;
+    if (!groups.empty()) {
+        auto &cached = _routers[groups];
+        if (!cached) {
+            HandlersType matches;
+            auto group = groups.begin();
+            index = 0;
+            for (auto &handler: _handlers) {
+                if (group != groups.end() && *group == index) {
+                    matches.insert(matches.end(), handler.second.begin(), handler.second.end());
+                    ++group;
+                }
+                ++index;
             }
+            cached = std::make_shared<UrlRouter>(std::move(matches));
         }
+        router = cached;
+    }
+    if (_hostRouters.size() >= MAX_CACHED_HOSTS) {
+        _hostRouters.clear();
     }
-    return matches;
+    _hostRouters.emplace(host, router);
+    return router;
 }
 
 NS_END
\ No newline at end of file
@@ -6,9 +6,11 @@
 #define NET4CXX_PLUGINS_WEB_WEB_H
 
 #include "net4cxx/common/common.h"
+#include <mutex>
 #include <boost/lexical_cast.hpp>
-#include "net4cxx/common/compress/gzip.h"
+#include "net4cxx/common/compress/compressor.h"
 #include "net4cxx/common/configuration/json.h"
+#include "net4cxx/plugins/web/limiter.h"
 #include "net4cxx/plugins/web/routing.h"
 
 
@@ -21,6 +23,9 @@ using WebAppPtr = std::shared_ptr<WebApp>;
 class OutputTransform;
 using OutputTransformPtr = std::shared_ptr<OutputTransform>;
 
+class RequestMetrics;
+using RequestMetricsPtr = std::shared_ptr<RequestMetrics>;
+
 
 class NET4CXX_COMMON_API MissingArgumentError: public HTTPError {
 public:
@@ -183,21 +188,20 @@ public:
 
     void write(std::string &&chunk) {
         NET4CXX_ASSERT(!_finished);
-        _writeBuffer.emplace_back(std::move(chunk));
+        _writeBuffer.append(std::move(chunk));
     }
 
     void write(const std::string &chunk) {
-        NET4CXX_ASSERT(!_finished);
-        _writeBuffer.emplace_back(chunk);
         write((const Byte *)chunk.data(), chunk.size());
     }
 
     void write(const Byte *chunk, size_t length) {
-        write(std::string{(const char *)chunk, length});
+        NET4CXX_ASSERT(!_finished);
+        _writeBuffer.append(chunk, length);
     }
 
     void write(const char *chunk) {
-        write(std::string{chunk});
+        write((const Byte *)chunk, strlen(chunk));
     }
 
     void write(const ByteArray &chunk) {
@@ -286,6 +290,10 @@ public:
         return connection;
     }
 
+    void pauseReading();
+
+    void resumeReading();
+
     template <typename SelfT>
     std::shared_ptr<SelfT> getSelf() {
         return std::static_pointer_cast<SelfT>(shared_from_this());
@@ -333,6 +341,10 @@ protected:
 
     void whenComplete();
 
+    void receiveRequestData(std::string data);
+
+    void requestBodyReceived();
+
     void executeMethod();
 
     void executeFinish() {
@@ -365,10 +377,18 @@ protected:
     bool _headersWritten{false};
     bool _finished{false};
     bool _autoFinish{true};
+    bool _requestBodyReceived{false};
+    bool _waitingRequestBody{false};
     TransformsType _transforms;
     StringVector _pathArgs;
+    std::vector<ConcurrencyPermit> _permits;
+    const UrlSpec *_spec{nullptr};
+    Timestamp _dispatchTime;
+    Timestamp _executeTime;
+    size_t _bytesIn{0};
+    size_t _bytesOut{0};
     HTTPHeaders _headers;
-    StringVector _writeBuffer;
+    BufferChain _writeBuffer;
     int _statusCode;
     CookiesType _newCookie;
     std::string _reason;
@@ -408,6 +428,39 @@ public:
 };
 
 
+class NET4CXX_COMMON_API LoadShedHandlerArgs {
+public:
+    LoadShedHandlerArgs() = default;
+
+    explicit LoadShedHandlerArgs(int retryAfter): _retryAfter(retryAfter) {}
+
+    void setRetryAfter(int retryAfter) {
+        _retryAfter = retryAfter;
+    }
+
+    int getRetryAfter() const {
+        return _retryAfter;
+    }
+protected:
+    int _retryAfter{1};
+};
+
+
+// Answers requests turned away by a concurrency limiter
+class NET4CXX_COMMON_API LoadShedHandler: public RequestHandler {
+public:
+    using RequestHandler::RequestHandler;
+
+    void initialize(const boost::any &args) override;
+
+    bool hasStreamRequestBody() const override;
+
+    DeferredPtr prepare() override;
+protected:
+    int _retryAfter{1};
+};
+
+
 class NET4CXX_COMMON_API RedirectHandlerArgs {
 public:
     RedirectHandlerArgs() = default;
@@ -488,6 +541,200 @@ protected:
 };
 
 
+class NET4CXX_COMMON_API StaticFileInfo {
+public:
+    StaticFileInfo(std::string path, size_t size, time_t modified, std::shared_ptr<const std::string> content)
+            : _path(std::move(path))
+            , _size(size)
+            , _modified(modified)
+            , _content(std::move(content)) {
+        _etag = StrUtil::format("\"%lx-%lx\"", (unsigned long)_modified, (unsigned long)_size);
+    }
+
+    const std::string& getPath() const {
+        return _path;
+    }
+
+    size_t getSize() const {
+        return _size;
+    }
+
+    time_t getModified() const {
+        return _modified;
+    }
+
+    const std::string& getEtag() const {
+        return _etag;
+    }
+
+    std::shared_ptr<const std::string> getContent() const {
+        return _content;
+    }
+protected:
+    std::string _path;
+    size_t _size;
+    time_t _modified;
+    std::string _etag;
+    std::shared_ptr<const std::string> _content;
+};
+
+using StaticFileInfoPtr = std::shared_ptr<const StaticFileInfo>;
+
+
+class NET4CXX_COMMON_API StaticFileCache: public boost::noncopyable {
+public:
+    explicit StaticFileCache(size_t maxEntries=1024, size_t maxFileSize=64 * 1024, size_t maxTotalSize=64 * 1024 * 1024,
+                             double revalidateInterval=1.0)
+            : _maxEntries(maxEntries)
+            , _maxFileSize(maxFileSize)
+            , _maxTotalSize(maxTotalSize)
+            , _revalidateInterval(std::chrono::duration_cast<Duration>(
+                    std::chrono::duration<double>(revalidateInterval))) {
+
+    }
+
+    StaticFileInfoPtr get(const std::string &path);
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(_lock);
+        _lru.clear();
+        _entries.clear();
+        _totalSize = 0;
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(_lock);
+        return _entries.size();
+    }
+protected:
+    struct Entry {
+        StaticFileInfoPtr info;
+        Timestamp validated;
+        std::list<std::string>::iterator position;
+    };
+
+    using EntryMap = std::unordered_map<std::string, Entry>;
+
+    StaticFileInfoPtr load(const std::string &path, size_t size, time_t modified) const;
+
+    void insert(const std::string &path, StaticFileInfoPtr info, Timestamp now);
+
+    void erase(EntryMap::iterator iter);
+
+    size_t _maxEntries;
+    size_t _maxFileSize;
+    size_t _maxTotalSize;
+    Duration _revalidateInterval;
+    size_t _totalSize{0};
+    mutable std::mutex _lock;
+    std::list<std::string> _lru;
+    EntryMap _entries;
+};
+
+using StaticFileCachePtr = std::shared_ptr<StaticFileCache>;
+
+
+class NET4CXX_COMMON_API StaticFileHandlerArgs {
+public:
+    StaticFileHandlerArgs(): _cache(std::make_shared<StaticFileCache>()) {}
+
+    explicit StaticFileHandlerArgs(std::string path, std::string defaultFilename={})
+            : _path(std::move(path))
+            , _defaultFilename(std::move(defaultFilename))
+            , _cache(std::make_shared<StaticFileCache>()) {
+
+    }
+
+    void setPath(std::string path) {
+        _path = std::move(path);
+    }
+
+    const std::string& getPath() const {
+        return _path;
+    }
+
+    void setDefaultFilename(std::string defaultFilename) {
+        _defaultFilename = std::move(defaultFilename);
+    }
+
+    const std::string& getDefaultFilename() const {
+        return _defaultFilename;
+    }
+
+    void setPrecompressed(bool precompressed) {
+        _precompressed = precompressed;
+    }
+
+    bool getPrecompressed() const {
+        return _precompressed;
+    }
+
+    void setMaxAge(int maxAge) {
+        _maxAge = maxAge;
+    }
+
+    int getMaxAge() const {
+        return _maxAge;
+    }
+
+    void setCache(StaticFileCachePtr cache) {
+        _cache = std::move(cache);
+    }
+
+    StaticFileCachePtr getCache() const {
+        return _cache;
+    }
+protected:
+    std::string _path;
+    std::string _defaultFilename;
+    bool _precompressed{false};
+    int _maxAge{0};
+    StaticFileCachePtr _cache;
+};
+
+
+class NET4CXX_COMMON_API StaticFileHandler: public RequestHandler {
+public:
+    typedef std::pair<size_t, size_t> RangeType;
+    typedef std::vector<RangeType> RangeListType;
+
+    using RequestHandler::RequestHandler;
+
+    void initialize(const boost::any &args) override;
+
+    DeferredPtr onHead(const StringVector &args) override;
+
+    DeferredPtr onGet(const StringVector &args) override;
+
+    std::string computeEtag() const override;
+
+    static std::string getContentType(const std::string &path);
+
+    static boost::optional<RangeListType> parseRange(const std::string &range, size_t size);
+
+    static constexpr size_t MAX_RANGES = 16;
+    static constexpr size_t READ_CHUNK_SIZE = 64 * 1024;
+protected:
+    void get(const std::string &path, bool includeBody);
+
+    std::string validateAbsolutePath(const std::string &path);
+
+    bool shouldReturn304() const;
+
+    void openFile();
+
+    void writeContent(size_t start, size_t length);
+
+    std::string _root;
+    std::string _defaultFilename;
+    bool _precompressed{false};
+    int _maxAge{0};
+    StaticFileCachePtr _cache;
+    StaticFileInfoPtr _file;
+    std::shared_ptr<int> _fd;
+};
+
+
 class NET4CXX_COMMON_API BasicRequestHandlerFactory {
 public:
     virtual ~BasicRequestHandlerFactory() = default;
@@ -512,7 +759,9 @@ public:
     std::shared_ptr<RequestHandler> create(std::shared_ptr<WebApp> application,
                                            std::shared_ptr<HTTPServerRequest> request,
                                            const boost::any &args) const override {
-        auto requestHandler = std::make_shared<RequestHandlerT>(std::move(application), std::move(request));
+        auto connection = request->getConnection();
+        auto requestHandler = allocateShared<RequestHandlerT>(connection ? connection->getArena() : nullptr,
+                                                              std::move(application), std::move(request));
         requestHandler->start(args);
         return requestHandler;
     }
@@ -531,9 +780,9 @@ class NET4CXX_COMMON_API OutputTransform {
 public:
     virtual ~OutputTransform() = default;
 
-    virtual void transformFirstChunk(int &statusCode, HTTPHeaders &headers, std::string &chunk, bool finishing) =0;
+    virtual void transformFirstChunk(int &statusCode, HTTPHeaders &headers, BufferChain &chunk, bool finishing) =0;
 
-    virtual void transformChunk(std::string &chunk, bool finishing) =0;
+    virtual void transformChunk(BufferChain &chunk, bool finishing) =0;
 };
 
 
@@ -541,9 +790,9 @@ class NET4CXX_COMMON_API GZipContentEncoding: public OutputTransform {
 public:
     explicit GZipContentEncoding(const std::shared_ptr<HTTPServerRequest> &request);
 
-    void transformFirstChunk(int &statusCode, HTTPHeaders &headers, std::string &chunk, bool finishing) override;
+    void transformFirstChunk(int &statusCode, HTTPHeaders &headers, BufferChain &chunk, bool finishing) override;
 
-    void transformChunk(std::string &chunk, bool finishing) override;
+    void transformChunk(BufferChain &chunk, bool finishing) override;
 
     static bool compressibleType(const std::string &ctype);
 
@@ -554,8 +803,7 @@ public:
     static constexpr int MIN_LENGTH = 1024;
 protected:
     bool _gzipping;
-    std::shared_ptr<std::stringstream> _gzipValue;
-    GzipFile _gzipFile;
+    CompressorPool::CompressorPtr _compressor;
 };
 
 
@@ -572,12 +820,13 @@ template<typename OutputTransformT>
 class OutputTransformFactory: public BasicOutputTransformFactory {
 public:
     std::shared_ptr<OutputTransform> create(const std::shared_ptr<HTTPServerRequest> &request) override {
-        return std::make_shared<OutputTransformT>(request);
+        auto connection = request->getConnection();
+        return allocateShared<OutputTransformT>(connection ? connection->getArena() : nullptr, request);
     }
 };
 
 
-class NET4CXX_COMMON_API RequestDispatcher {
+class NET4CXX_COMMON_API RequestDispatcher: public std::enable_shared_from_this<RequestDispatcher> {
 public:
     RequestDispatcher(std::shared_ptr<WebApp> application, const std::shared_ptr<HTTPConnection> &connection)
             : _application(std::move(application))
@@ -586,23 +835,29 @@ public:
     }
 
     void headersReceived(const RequestStartLine &startLine, const std::shared_ptr<HTTPHeaders> &headers) {
-        setRequest(std::make_shared<HTTPServerRequest>(_connection.lock(), &startLine, headers));
+        auto connection = _connection.lock();
+        setRequest(allocateShared<HTTPServerRequest>(connection->getArena(), connection, &startLine, headers));
+        if (_handler->hasStreamRequestBody()) {
+            execute();
+        }
     }
 
     void dataReceived(std::string data) {
         if (_handler->hasStreamRequestBody()) {
-            _handler->dataReceived(std::move(data));
+            _handler->receiveRequestData(std::move(data));
         } else {
             _chunks.emplace_back(std::move(data));
         }
     }
 
     void finish() {
-        if (!_handler->hasStreamRequestBody()) {
+        if (_handler->hasStreamRequestBody()) {
+            _handler->requestBodyReceived();
+        } else {
             _request->setBody(boost::join(_chunks, ""));
             _request->parseBody();
+            execute();
         }
-        execute();
     }
 
     void onConnectionClose() {
@@ -623,12 +878,18 @@ protected:
 
     void findHandler();
 
+    void shed(const ConcurrencyLimiterPtr &limiter);
+
     std::shared_ptr<WebApp> _application;
     std::weak_ptr<HTTPConnection> _connection;
     std::shared_ptr<HTTPServerRequest> _request;
     StringVector _chunks;
     std::shared_ptr<RequestHandler> _handler;
     StringVector _pathArgs;
+    std::vector<ConcurrencyLimiterPtr> _limiters;
+    std::vector<ConcurrencyPermit> _permits;
+    const UrlSpec *_spec{nullptr};
+    Timestamp _dispatchTime;
 };
 
 
@@ -640,6 +901,8 @@ public:
     typedef std::map<std::string, UrlSpecPtr> NamedHandlersType;
     typedef std::vector<std::shared_ptr<BasicOutputTransformFactory>> TransformsType;
     typedef std::function<void (const std::shared_ptr<const RequestHandler>&)> LogFunctionType;
+    typedef std::unordered_map<std::string, UrlRouterPtr> HostRoutersType;
+    typedef std::map<std::vector<size_t>, UrlRouterPtr> RoutersType;
 
     friend class RequestDispatcher;
 
@@ -662,7 +925,7 @@ public:
     }
 
     std::shared_ptr<RequestDispatcher> startRequest(const std::shared_ptr<HTTPConnection> &connection) {
-        return std::make_shared<RequestDispatcher>(shared_from_this(), connection);
+        return allocateShared<RequestDispatcher>(connection->getArena(), shared_from_this(), connection);
     }
 
     template <typename... Args>
@@ -815,8 +1078,40 @@ public:
     const StringSet& getTrustedDownstream() const {
         return _trustedDownstream;
     }
+
+    void setRequestArenaSize(size_t requestArenaSize) {
+        _requestArenaSize = requestArenaSize;
+    }
+
+    size_t getRequestArenaSize() const {
+        return _requestArenaSize;
+    }
+
+    // Caps the requests in flight over every route, on top of the limiters set on single routes
+    void setConcurrencyLimiter(ConcurrencyLimiterPtr concurrencyLimiter) {
+        _concurrencyLimiter = std::move(concurrencyLimiter);
+    }
+
+    const ConcurrencyLimiterPtr& getConcurrencyLimiter() const {
+        return _concurrencyLimiter;
+    }
+
+    // Records per route counters and latencies, served by a MetricsHandler mounted on any route
+    void setMetricsEnabled(bool metricsEnabled);
+
+    const RequestMetricsPtr& getMetrics() const {
+        return _metrics;
+    }
+
+    const HostHandlersType& getHandlers() const {
+        return _handlers;
+    }
+
+    static constexpr size_t MAX_CACHED_HOSTS = 1024;
 protected:
-    std::vector<UrlSpecPtr> getHostHandlers(const std::shared_ptr<const HTTPServerRequest> &request) const;
+    UrlRouterPtr getHostRouter(const std::shared_ptr<const HTTPServerRequest> &request) const;
+
+    UrlRouterPtr findHostRouter(const std::string &host) const;
 
     TransformsType _transforms;
     HostHandlersType _handlers;
@@ -835,8 +1130,14 @@ protected:
     size_t _maxBufferSize{0};
     double _idleConnectionTimeout{3600.0};
     double _bodyTimeout{0.0};
+    size_t _requestArenaSize{Arena::DEFAULT_BLOCK_SIZE};
+    ConcurrencyLimiterPtr _concurrencyLimiter;
+    RequestMetricsPtr _metrics;
     std::string _protocol;
     StringSet _trustedDownstream;
+    mutable std::mutex _routersLock;
+    mutable HostRoutersType _hostRouters;
+    mutable RoutersType _routers;
 };
 
 
@@ -0,0 +1,169 @@
+//
+// Created by yuwenyong.vincent on 2019-03-22.
+//
+
+#include "net4cxx/plugins/websocket/broadcast.h"
+#include <boost/endian/conversion.hpp>
+#include "net4cxx/core/network/reactor.h"
+
+
+NS_BEGIN
+
+
+const WebSocketPreparedMessage::FramePtr& WebSocketPreparedMessage::getFrame() {
+    if (!_frame) {
+        _frame = makeFrame(_payload.data(), _payload.size(), false);
+    }
+    return _frame;
+}
+
+WebSocketPreparedMessage::FramePtr WebSocketPreparedMessage::getFrame(PerMessageCompress *compress) {
+    auto key = compress->getSharedCompressKey();
+    if (key.empty()) {
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> lock(_compressedFramesLock);
+    for (auto &compressedFrame: _compressedFrames) {
+        if (compressedFrame.first == key) {
+            return compressedFrame.second;
+        }
+    }
+    // The first peer of a parameter set compresses for all of them, its context is reset before its next message
+    if (!compress->startCompressMessage()) {
+        return nullptr;
+    }
+    ByteArray compressed = compress->compressMessageData(_payload.data(), _payload.size());
+    BufferUtil::concat(compressed, compress->endCompressMessage());
+    auto frame = makeFrame(compressed.data(), compressed.size(), true);
+    _compressedFrames.emplace_back(std::move(key), frame);
+    return frame;
+}
+
+WebSocketPreparedMessage::FramePtr WebSocketPreparedMessage::makeFrame(const Byte *payload, size_t length,
+                                                                       bool compressed) const {
+    auto frame = std::make_shared<std::string>();
+    frame->reserve(length + 10);
+    frame->push_back((char)(0x80u | (compressed ? 0x40u : 0u) | (_isBinary ? 2u : 1u)));
+    if (length <= 125) {
+        frame->push_back((char)length);
+    } else if (length <= 0xFFFFu) {
+        frame->push_back((char)126u);
+        uint16_t len = boost::endian::native_to_big((uint16_t)length);
+        frame->append((const char *)&len, sizeof(len));
+    } else {
+        frame->push_back((char)127u);
+        uint64_t len = boost::endian::native_to_big((uint64_t)length);
+        frame->append((const char *)&len, sizeof(len));
+    }
+    frame->append((const char *)payload, length);
+    return frame;
+}
+
+
+constexpr size_t WebSocketBroadcastGroup::DEFAULT_MAX_PENDING_BYTES;
+constexpr double WebSocketBroadcastGroup::COALESCE_RETRY_INTERVAL;
+
+WebSocketBroadcastGroup::~WebSocketBroadcastGroup() {
+    if (!_flushCall.cancelled()) {
+        _flushCall.cancel();
+    }
+}
+
+void WebSocketBroadcastGroup::add(const WebSocketProtocolPtr &protocol) {
+    auto &member = _members[protocol.get()];
+    if (member.coalesced) {
+        member.coalesced.reset();
+        --_coalescedCount;
+    }
+    member.protocol = protocol;
+}
+
+bool WebSocketBroadcastGroup::remove(const WebSocketProtocol *protocol) {
+    auto iter = _members.find(protocol);
+    if (iter == _members.end()) {
+        return false;
+    }
+    if (iter->second.coalesced) {
+        --_coalescedCount;
+    }
+    _members.erase(iter);
+    return true;
+}
+
+size_t WebSocketBroadcastGroup::broadcast(const WebSocketPreparedMessagePtr &message,
+                                          const WebSocketProtocol *exclude) {
+    size_t count = 0;
+    for (auto iter = _members.begin(); iter != _members.end();) {
+        auto protocol = iter->second.protocol.lock();
+        if (!protocol || protocol->disconnected()) {
+            if (iter->second.coalesced) {
+                --_coalescedCount;
+            }
+            iter = _members.erase(iter);
+            continue;
+        }
+        auto &member = iter->second;
+        ++iter;
+        if (protocol.get() == exclude) {
+            continue;
+        }
+        if (isWritable(*protocol, *message)) {
+            // A newer message supersedes the one held back
+            if (member.coalesced) {
+                member.coalesced.reset();
+                --_coalescedCount;
+            }
+            protocol->sendPreparedMessage(*message);
+            ++count;
+        } else if (_slowConsumerPolicy == COALESCE_MESSAGES) {
+            if (!member.coalesced) {
+                ++_coalescedCount;
+            } else {
+                ++_skippedCount;
+            }
+            member.coalesced = message;
+        } else {
+            ++_skippedCount;
+        }
+    }
+    if (_coalescedCount && _flushCall.cancelled()) {
+        if (!_reactor) {
+            _reactor = Reactor::current();
+        }
+        NET4CXX_ASSERT(_reactor);
+        _flushCall = _reactor->callLater(COALESCE_RETRY_INTERVAL, [this]() {
+            flushCoalesced();
+        });
+    }
+    return count;
+}
+
+void WebSocketBroadcastGroup::flushCoalesced() {
+    for (auto iter = _members.begin(); iter != _members.end() && _coalescedCount;) {
+        auto &member = iter->second;
+        if (!member.coalesced) {
+            ++iter;
+            continue;
+        }
+        auto protocol = member.protocol.lock();
+        if (!protocol || protocol->disconnected()) {
+            --_coalescedCount;
+            iter = _members.erase(iter);
+            continue;
+        }
+        ++iter;
+        if (isWritable(*protocol, *member.coalesced)) {
+            auto message = std::move(member.coalesced);
+            member.coalesced.reset();
+            --_coalescedCount;
+            protocol->sendPreparedMessage(*message);
+        }
+    }
+    if (_coalescedCount) {
+        _flushCall = _reactor->callLater(COALESCE_RETRY_INTERVAL, [this]() {
+            flushCoalesced();
+        });
+    }
+}
+
+NS_END
@@ -0,0 +1,164 @@
+//
+// Created by yuwenyong.vincent on 2019-03-22.
+//
+
+#ifndef NET4CXX_PLUGINS_WEBSOCKET_BROADCAST_H
+#define NET4CXX_PLUGINS_WEBSOCKET_BROADCAST_H
+
+#include "net4cxx/plugins/websocket/base.h"
+#include <mutex>
+#include <unordered_map>
+#include "net4cxx/plugins/websocket/protocol.h"
+
+
+NS_BEGIN
+
+
+// A message framed once and shared by every recipient. Unmasked frames are byte for byte the same on each connection,
+// compressed ones on each connection whose compressor starts every message from a fresh context. Once the plain frame
+// was built the message may be sent from several reactor threads
+class NET4CXX_COMMON_API WebSocketPreparedMessage: public boost::noncopyable {
+public:
+    typedef std::shared_ptr<const std::string> FramePtr;
+
+    WebSocketPreparedMessage(const Byte *payload, size_t length, bool isBinary=false)
+            : _payload(payload, payload + length)
+            , _isBinary(isBinary) {
+
+    }
+
+    explicit WebSocketPreparedMessage(ByteArray payload, bool isBinary=false)
+            : _payload(std::move(payload))
+            , _isBinary(isBinary) {
+
+    }
+
+    explicit WebSocketPreparedMessage(const std::string &payload, bool isBinary=false)
+            : WebSocketPreparedMessage((const Byte *)payload.data(), payload.size(), isBinary) {
+
+    }
+
+    const ByteArray& getPayload() const {
+        return _payload;
+    }
+
+    bool isBinary() const {
+        return _isBinary;
+    }
+
+    const FramePtr& getFrame();
+
+    // Compressed once per distinct parameter set; null when the compressor keeps its context between messages or has
+    // no memory left for one
+    FramePtr getFrame(PerMessageCompress *compress);
+
+    size_t getCompressedFrameCount() const {
+        std::lock_guard<std::mutex> lock(_compressedFramesLock);
+        return _compressedFrames.size();
+    }
+protected:
+    FramePtr makeFrame(const Byte *payload, size_t length, bool compressed) const;
+
+    ByteArray _payload;
+    bool _isBinary;
+    FramePtr _frame;
+    mutable std::mutex _compressedFramesLock;
+    std::vector<std::pair<std::string, FramePtr>> _compressedFrames;
+};
+
+using WebSocketPreparedMessagePtr = std::shared_ptr<WebSocketPreparedMessage>;
+
+
+// Members are held weakly and forgotten once closed. Like EventSourceHub a group is only used from the reactor thread
+// serving its members
+class NET4CXX_COMMON_API WebSocketBroadcastGroup: public boost::noncopyable {
+public:
+    enum SlowConsumerPolicy {
+        SKIP_SLOW_CONSUMER,
+        COALESCE_MESSAGES,
+    };
+
+    struct Member {
+        std::weak_ptr<WebSocketProtocol> protocol;
+        WebSocketPreparedMessagePtr coalesced;
+    };
+
+    // Coalesced messages are retried on the given reactor, by default the one current when first needed
+    explicit WebSocketBroadcastGroup(Reactor *reactor=nullptr)
+            : _reactor(reactor) {
+
+    }
+
+    ~WebSocketBroadcastGroup();
+
+    void add(const WebSocketProtocolPtr &protocol);
+
+    bool remove(const WebSocketProtocol *protocol);
+
+    bool contains(const WebSocketProtocol *protocol) const {
+        return _members.find(protocol) != _members.end();
+    }
+
+    size_t size() const {
+        return _members.size();
+    }
+
+    size_t broadcast(const Byte *payload, size_t length, bool isBinary=false,
+                     const WebSocketProtocol *exclude=nullptr) {
+        return broadcast(std::make_shared<WebSocketPreparedMessage>(payload, length, isBinary), exclude);
+    }
+
+    size_t broadcast(const ByteArray &payload, bool isBinary=false, const WebSocketProtocol *exclude=nullptr) {
+        return broadcast(payload.data(), payload.size(), isBinary, exclude);
+    }
+
+    size_t broadcast(const std::string &payload, bool isBinary=false, const WebSocketProtocol *exclude=nullptr) {
+        return broadcast((const Byte *)payload.data(), payload.size(), isBinary, exclude);
+    }
+
+    // Returns the number of members the message was written to, slow members are skipped or get it later
+    size_t broadcast(const WebSocketPreparedMessagePtr &message, const WebSocketProtocol *exclude=nullptr);
+
+    void setMaxPendingBytes(size_t maxPendingBytes) {
+        _maxPendingBytes = maxPendingBytes;
+    }
+
+    size_t getMaxPendingBytes() const {
+        return _maxPendingBytes;
+    }
+
+    void setSlowConsumerPolicy(SlowConsumerPolicy policy) {
+        _slowConsumerPolicy = policy;
+    }
+
+    SlowConsumerPolicy getSlowConsumerPolicy() const {
+        return _slowConsumerPolicy;
+    }
+
+    uint64_t getSkippedCount() const {
+        return _skippedCount;
+    }
+
+    static constexpr size_t DEFAULT_MAX_PENDING_BYTES = 256 * 1024;
+    static constexpr double COALESCE_RETRY_INTERVAL = 0.01;
+protected:
+    bool isWritable(const WebSocketProtocol &protocol, const WebSocketPreparedMessage &message) const {
+        // A member streaming a message of its own is treated as slow until it is done
+        return !protocol.isSendingMessage() && (_maxPendingBytes == 0 ||
+               protocol.getPendingWriteSize() + message.getPayload().size() <= _maxPendingBytes);
+    }
+
+    void flushCoalesced();
+
+    std::unordered_map<const WebSocketProtocol *, Member> _members;
+    size_t _maxPendingBytes{DEFAULT_MAX_PENDING_BYTES};
+    SlowConsumerPolicy _slowConsumerPolicy{SKIP_SLOW_CONSUMER};
+    uint64_t _skippedCount{0};
+    size_t _coalescedCount{0};
+    Reactor *_reactor{nullptr};
+    DelayedCall _flushCall;
+};
+
+NS_END
+
+#endif //NET4CXX_PLUGINS_WEBSOCKET_BROADCAST_H
@@ -177,6 +177,11 @@ std::string PerMessageDeflateResponseAccept::getExtensionName() const {
 }
 
 
+std::string PerMessageCompress::getSharedCompressKey() const {
+    return {};
+}
+
+
 constexpr int PerMessageDeflate::DEFAULT_WINDOW_BITS;
 constexpr int PerMessageDeflate::DEFAULT_MEM_LEVEL;
 
@@ -185,52 +190,75 @@ std::string PerMessageDeflate::getExtensionName() const {
     return PerMessageDeflateConstants::EXTENSION_NAME;
 }
 
-void PerMessageDeflate::startCompressMessage() {
-    if (_isServer) {
-        if (!_compressor || _serverNoContextTakeover) {
-            _compressor = std::make_unique<CompressObj>(Zlib::zDefaultCompression, Zlib::deflated,
-                                                        -_serverMaxWindowBits, _memLevel);
-        }
-    } else {
-        if (!_compressor || _clientNoContextTakeover) {
-            _compressor = std::make_unique<CompressObj>(Zlib::zDefaultCompression, Zlib::deflated,
-                                                        -_clientMaxWindowBits, _memLevel);
+std::string PerMessageDeflate::getSharedCompressKey() const {
+    bool noContextTakeover = _isServer ? _serverNoContextTakeover : _clientNoContextTakeover;
+    if (!noContextTakeover) {
+        return {};
+    }
+    int windowBits = _isServer ? _serverMaxWindowBits : _clientMaxWindowBits;
+    return getExtensionName() + "; window_bits=" + std::to_string(windowBits) + "; mem_level=" +
+           std::to_string(_memLevel);
+}
+
+bool PerMessageDeflate::startCompressMessage() {
+    bool noContextTakeover = _isServer ? _serverNoContextTakeover : _clientNoContextTakeover;
+    if (!_compressor) {
+        // Without context takeover the context is only borrowed for the message, so idle sessions hold no zlib state
+        int windowBits = _isServer ? _serverMaxWindowBits : _clientMaxWindowBits;
+        _compressor = CompressorPool::tryAcquireCompressor(Zlib::zDefaultCompression, -windowBits, _memLevel);
+        if (!_compressor) {
+            return false;
         }
+    } else if (noContextTakeover) {
+        _compressor->reset();
     }
+    return true;
 }
 
 ByteArray PerMessageDeflate::compressMessageData(const Byte *data, size_t length) {
-    return _compressor->compress(data, length);
+    ByteArray retVal;
+    _compressor->compress(data, length, retVal);
+    return retVal;
 }
 
 ByteArray PerMessageDeflate::endCompressMessage() {
-    auto data = _compressor->flush(Zlib::zSyncFlush);
-    data.erase(std::prev(data.end(), (ssize_t)std::max(4ul, (unsigned long)data.size())), data.end());
+    ByteArray data;
+    _compressor->flush(data, Zlib::zSyncFlush);
+    data.resize(data.size() - std::min<size_t>(4, data.size()));
+    if (_isServer ? _serverNoContextTakeover : _clientNoContextTakeover) {
+        _compressor.reset();
+    }
     return data;
 }
 
 void PerMessageDeflate::startDecompressMessage() {
-    if (_isServer) {
-        if (!_decompressor || _clientNoContextTakeover) {
-            _decompressor = std::make_unique<DecompressObj>(-_clientMaxWindowBits);
-        }
-    } else {
-        if (!_decompressor || _serverNoContextTakeover) {
-            _decompressor = std::make_unique<DecompressObj>(-_serverMaxWindowBits);
-        }
+    bool noContextTakeover = _isServer ? _clientNoContextTakeover : _serverNoContextTakeover;
+    if (!_decompressor) {
+        int windowBits = _isServer ? _clientMaxWindowBits : _serverMaxWindowBits;
+        _decompressor = CompressorPool::acquireDecompressor(-windowBits);
+    } else if (noContextTakeover) {
+        _decompressor->reset();
     }
 }
 
 ByteArray PerMessageDeflate::decompressMessageData(const Byte *data, size_t length) {
-    if (_maxMessageSize) {
-        return _decompressor->decompress(data, length, *_maxMessageSize);
-    }
-    return _decompressor->decompress(data, length);
+    ByteArray retVal;
+    _decompressor->decompress(data, length, retVal, _maxMessageSize ? *_maxMessageSize : 0);
+    return retVal;
 }
 
 void PerMessageDeflate::endDecompressMessage() {
-    const ByteArray block = {0x00, 0x00, 0xff, 0xff};
-    _decompressor->decompress(block);
+    const Byte block[] = {0x00, 0x00, 0xff, 0xff};
+    ByteArray discarded;
+    _decompressor->decompress(block, sizeof(block), discarded);
+    if (_isServer ? _clientNoContextTakeover : _serverNoContextTakeover) {
+        _decompressor.reset();
+    }
+}
+
+bool PerMessageDeflate::isMemoryAvailable() {
+    return CompressorPool::hasMemoryFor(CompressorPool::getCompressorMemory(DEFAULT_WINDOW_BITS, DEFAULT_MEM_LEVEL) +
+                                        CompressorPool::getDecompressorMemory(DEFAULT_WINDOW_BITS));
 }
 
 
@@ -6,7 +6,7 @@
 #define NET4CXX_PLUGINS_WEBSOCKET_COMPRESS_H
 
 #include "net4cxx/plugins/websocket/base.h"
-#include "net4cxx/common/compress/zlib.h"
+#include "net4cxx/common/compress/compressor.h"
 #include "net4cxx/common/utilities/util.h"
 
 
@@ -52,13 +52,16 @@ using PerMessageCompressResponseAcceptPtr = std::shared_ptr<PerMessageCompressRe
 
 class NET4CXX_COMMON_API PerMessageCompress {
 public:
-    virtual void startCompressMessage() = 0;
+    // False when the message has to be sent uncompressed, e.g. because no compression context fits the memory budget
+    virtual bool startCompressMessage() = 0;
     virtual ByteArray compressMessageData(const Byte *data, size_t length) = 0;
     virtual ByteArray endCompressMessage() = 0;
     virtual void startDecompressMessage() = 0;
     virtual ByteArray decompressMessageData(const Byte *data, size_t length) = 0;
     virtual void endDecompressMessage() = 0;
     virtual std::string getExtensionName() const = 0;
+    // Non-empty when each outgoing message is compressed from a fresh context, peers with equal keys produce equal output
+    virtual std::string getSharedCompressKey() const;
     virtual ~PerMessageCompress()= default;
 };
 
@@ -287,7 +290,9 @@ public:
 
     std::string getExtensionName() const override;
 
-    void startCompressMessage() override;
+    std::string getSharedCompressKey() const override;
+
+    bool startCompressMessage() override;
 
     ByteArray compressMessageData(const Byte *data, size_t length) override;
 
@@ -298,6 +303,9 @@ public:
     ByteArray decompressMessageData(const Byte *data, size_t length) override;
 
     void endDecompressMessage() override;
+
+    // Whether a session with default parameters still fits the zlib memory budget of this thread
+    static bool isMemoryAvailable();
 protected:
     bool _isServer;
     bool _serverNoContextTakeover;
@@ -306,8 +314,8 @@ protected:
     int _clientMaxWindowBits;
     int _memLevel;
     boost::optional<size_t> _maxMessageSize;
-    std::unique_ptr<CompressObj> _compressor;
-    std::unique_ptr<DecompressObj> _decompressor;
+    CompressorPool::CompressorPtr _compressor;
+    CompressorPool::DecompressorPtr _decompressor;
 };
 
 using PerMessageDeflatePtr = std::shared_ptr<PerMessageDeflate>;
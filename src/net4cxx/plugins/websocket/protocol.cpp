@@ -8,6 +8,7 @@
 #include "net4cxx/common/crypto/hashlib.h"
 #include "net4cxx/common/utilities/random.h"
 #include "net4cxx/core/network/reactor.h"
+#include "net4cxx/plugins/websocket/broadcast.h"
 
 
 NS_BEGIN
@@ -48,6 +49,10 @@ constexpr unsigned WebSocketProtocol::MESSAGE_TYPE_TEXT;
 
 constexpr unsigned WebSocketProtocol::MESSAGE_TYPE_BINARY;
 
+constexpr size_t WebSocketProtocol::MAX_FRAME_RESERVE;
+constexpr size_t WebSocketProtocol::MAX_FRAME_HEADER_LENGTH;
+constexpr size_t WebSocketProtocol::MAX_MASK_BUFFER_SIZE;
+
 const std::string WebSocketProtocol::WS_MAGIC = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
 
 const double WebSocketProtocol::QUEUED_WRITE_DELAY = 0.00001;
@@ -80,6 +85,9 @@ void WebSocketProtocol::onClose(bool wasClean, boost::optional<unsigned short> c
 
 void WebSocketProtocol::sendMessage(const Byte *payload, size_t length, bool isBinary, size_t fragmentSize, bool sync,
                                     bool doNotCompress) {
+    if (_sendState != SendState::GROUND) {
+        NET4CXX_THROW_EXCEPTION(Exception, "attempt to send message while streaming another one");
+    }
     if (_state != State::OPEN) {
         return;
     }
@@ -94,9 +102,8 @@ void WebSocketProtocol::sendMessage(const Byte *payload, size_t length, bool isB
 
     _trafficStats._outgoingWebSocketMessages += 1;
 
-    if (_perMessageCompress && !doNotCompress) {
+    if (_perMessageCompress && !doNotCompress && _perMessageCompress->startCompressMessage()) {
         sendCompressed = true;
-        _perMessageCompress->startCompressMessage();
         _trafficStats._outgoingOctetsAppLevel += length;
 
         payload1 = _perMessageCompress->compressMessageData(payload, length);
@@ -144,6 +151,108 @@ void WebSocketProtocol::sendMessage(const Byte *payload, size_t length, bool isB
     }
 }
 
+void WebSocketProtocol::sendPreparedMessage(WebSocketPreparedMessage &message) {
+    if (_sendState != SendState::GROUND) {
+        NET4CXX_THROW_EXCEPTION(Exception, "attempt to send message while streaming another one");
+    }
+    if (_state != State::OPEN) {
+        return;
+    }
+
+    const ByteArray &payload = message.getPayload();
+    WebSocketPreparedMessage::FramePtr frame;
+    bool masked = (bool)((!_isServer && _maskClientFrames) || (_isServer && _maskServerFrames));
+    if (!masked && (_autoFragmentSize == 0 || payload.size() <= _autoFragmentSize)) {
+        frame = _perMessageCompress ? message.getFrame(_perMessageCompress.get()) : message.getFrame();
+    }
+    if (!frame) {
+        sendMessage(payload, message.isBinary());
+        return;
+    }
+
+    if (_trackedTimings) {
+        _trackedTimings->track("sendMessage");
+    }
+
+    size_t headerLen = frameHeaderLength((Byte)(*frame)[1]);
+    _trafficStats._outgoingWebSocketMessages += 1;
+    _trafficStats._outgoingWebSocketFrames += 1;
+    _trafficStats._outgoingOctetsAppLevel += payload.size();
+    _trafficStats._outgoingOctetsWebSocketLevel += frame->size() - headerLen;
+
+    if (_logFrames) {
+        FrameHeader frameHeader((Byte)((Byte)(*frame)[0] & 0x0fu), true, (Byte)(((Byte)(*frame)[0] & 0x70u) >> 4u),
+                                frame->size() - headerLen, boost::none);
+        logTxFrame(frameHeader, payload.data(), payload.size(), 0, 0, false);
+    }
+    if (!_sendQueue.empty()) {
+        _sendQueue.emplace_back(std::make_pair(ByteArray(frame->begin(), frame->end()), false));
+        trigger();
+    } else {
+        BufferChain chain;
+        chain.append(MessageBuffer(frame));
+        write(std::move(chain));
+        _trafficStats._outgoingOctetsWireLevel += frame->size();
+
+        if (_logOctets) {
+            logTxOctets((const Byte *)frame->data(), frame->size(), false);
+        }
+    }
+}
+
+void WebSocketProtocol::beginMessage(bool isBinary, bool doNotCompress) {
+    if (_sendState != SendState::GROUND) {
+        NET4CXX_THROW_EXCEPTION(Exception, "attempt to begin message while streaming another one");
+    }
+    if (_trackedTimings) {
+        _trackedTimings->track("beginMessage");
+    }
+    _sendState = SendState::MESSAGE_BEGIN;
+    _sendMessageOpcode = isBinary ? MESSAGE_TYPE_BINARY : MESSAGE_TYPE_TEXT;
+    _sendMessageCompressed = _state == State::OPEN && _perMessageCompress && !doNotCompress &&
+                             _perMessageCompress->startCompressMessage();
+    if (_state == State::OPEN) {
+        _trafficStats._outgoingWebSocketMessages += 1;
+    }
+}
+
+bool WebSocketProtocol::sendMessageData(const Byte *payload, size_t length, bool sync) {
+    if (_sendState == SendState::GROUND) {
+        NET4CXX_THROW_EXCEPTION(Exception, "attempt to send message data outside of a message");
+    }
+    if (_state != State::OPEN) {
+        return true;
+    }
+    _trafficStats._outgoingOctetsAppLevel += length;
+    ByteArray compressed;
+    if (_sendMessageCompressed) {
+        compressed = _perMessageCompress->compressMessageData(payload, length);
+        if (compressed.empty()) {
+            return false;
+        }
+        payload = compressed.data();
+        length = compressed.size();
+    }
+    _trafficStats._outgoingOctetsWebSocketLevel += length;
+    sendMessageFrame(payload, length, false, sync);
+    return true;
+}
+
+void WebSocketProtocol::endMessage(bool sync) {
+    if (_sendState == SendState::GROUND) {
+        NET4CXX_THROW_EXCEPTION(Exception, "attempt to end message outside of a message");
+    }
+    ByteArray tail;
+    if (_sendMessageCompressed) {
+        // Also hands a borrowed compression context back
+        tail = _perMessageCompress->endCompressMessage();
+        _trafficStats._outgoingOctetsWebSocketLevel += tail.size();
+    }
+    sendMessageFrame(tail.data(), tail.size(), true, sync);
+    _sendState = SendState::GROUND;
+    _sendMessageCompressed = false;
+}
+
 void WebSocketProtocol::sendPing(const Byte *payload, size_t length) {
     if (_state != State::OPEN) {
         return;
@@ -190,6 +299,14 @@ void WebSocketProtocol::sendClose(boost::optional<unsigned short> code, boost::o
     sendCloseFrame(code, std::move(reasonUtf8), false);
 }
 
+size_t WebSocketProtocol::getPendingWriteSize() const {
+    size_t pendingSize = _transport ? Protocol::getPendingWriteSize() : 0;
+    for (auto &e: _sendQueue) {
+        pendingSize += e.first.size();
+    }
+    return pendingSize;
+}
+
 void WebSocketProtocol::connectionMade() {
     _peer = makePeerName();
 
@@ -216,6 +333,20 @@ void WebSocketProtocol::dataReceived(Byte *data, size_t length) {
     if (_logOctets) {
         logRxOctets(data, length);
     }
+    if (_state == State::OPEN || _state == State::CLOSING) {
+        size_t pos = 0;
+        if (!_data.empty() && !_currentFrame) {
+            // Only the bytes completing a frame header split over two reads are buffered
+            pos = completeFrameHeader(data, length);
+            consumeData();
+        }
+        if (_data.empty() && (_state == State::OPEN || _state == State::CLOSING)) {
+            consumeFrames(data + pos, length - pos);
+            return;
+        }
+        data += pos;
+        length -= pos;
+    }
     _data.insert(_data.end(), data, data + length);
     consumeData();
 }
@@ -361,9 +492,9 @@ void WebSocketProtocol::dropConnection(bool abort) {
 
 void WebSocketProtocol::consumeData() {
     if (_state == State::OPEN || _state == State::CLOSING) {
-        while (processData() && _state != State::CLOSED) {
-
-        }
+        ByteArray data = std::move(_data);
+        _data.clear();
+        consumeFrames(data.data(), data.size());
     } else if (_state == State::PROXY_CONNECTING) {
         processProxyConnect();
     } else if (_state == State::CONNECTING) {
@@ -375,16 +506,41 @@ void WebSocketProtocol::consumeData() {
     }
 }
 
-bool WebSocketProtocol::processData() {
-    size_t bufferedLen = _data.size();
+void WebSocketProtocol::consumeFrames(Byte *data, size_t length) {
+    size_t pos = 0;
+    while (processData(data, length, pos) && _state != State::CLOSED) {
+
+    }
+    if (pos < length) {
+        _data.insert(_data.end(), data + pos, data + length);
+    }
+}
+
+size_t WebSocketProtocol::completeFrameHeader(const Byte *data, size_t length) {
+    size_t pos = 0;
+    while (pos < length) {
+        size_t headerLen = _data.size() < 2 ? 2 : frameHeaderLength(_data[1]);
+        if (_data.size() >= headerLen) {
+            break;
+        }
+        size_t n = std::min(headerLen - _data.size(), length - pos);
+        _data.insert(_data.end(), data + pos, data + pos + n);
+        pos += n;
+    }
+    return pos;
+}
+
+bool WebSocketProtocol::processData(Byte *data, size_t length, size_t &pos) {
+    size_t bufferedLen = length - pos;
+    Byte *buffer = data + pos;
     if (!_currentFrame) {
         if (bufferedLen >= 2) {
-            Byte b = _data[0];
+            Byte b = buffer[0];
             bool frameFin = (b & 0x80u) != 0;
             Byte frameRsv = (b & 0x70u) >> 4u;
             Byte frameOpcode = b & 0x0fu;
 
-            b = _data[1];
+            b = buffer[1];
             bool frameMasked = (b & 0x80u) != 0;
             Byte framePayloadLen1 = (b & 0x7fu);
 
@@ -468,22 +624,12 @@ bool WebSocketProtocol::processData() {
                 }
             }
 
-            size_t maskLen = frameMasked ? 4u : 0u;
-            size_t frameHeaderLen;
-            if (framePayloadLen1 < 126u) {
-                frameHeaderLen = 2 + maskLen;
-            } else if (framePayloadLen1 == 126u) {
-                frameHeaderLen = 2 + 2 + maskLen;
-            } else {
-                NET4CXX_ASSERT(framePayloadLen1 == 127u);
-                frameHeaderLen = 2 + 8 + maskLen;
-            }
-
+            size_t frameHeaderLen = frameHeaderLength(b);
             if (bufferedLen >=  frameHeaderLen) {
                 size_t i = 2;
                 uint64_t framePayloadLen;
                 if (framePayloadLen1 == 126u) {
-                    framePayloadLen = boost::endian::big_to_native(*(uint16_t *)(_data.data() + i));
+                    framePayloadLen = boost::endian::big_to_native(*(uint16_t *)(buffer + i));
                     if (framePayloadLen < 126u) {
                         if (protocolViolation("invalid data frame length (not using minimal length encoding)")) {
                             return false;
@@ -491,7 +637,7 @@ bool WebSocketProtocol::processData() {
                     }
                     i += 2;
                 } else if (framePayloadLen1 == 127u) {
-                    framePayloadLen = boost::endian::big_to_native(*(uint64_t *)(_data.data() + i));
+                    framePayloadLen = boost::endian::big_to_native(*(uint64_t *)(buffer + i));
                     if (framePayloadLen > 0x7FFFFFFFFFFFFFFFu) {
                         if (protocolViolation("invalid data frame length (>2^63)")) {
                             return false;
@@ -508,8 +654,7 @@ bool WebSocketProtocol::processData() {
                 }
                 WebSocketMask frameMask;
                 if (frameMasked) {
-                    std::copy(_data.begin() + (std::ptrdiff_t)i, _data.begin() + (std::ptrdiff_t)i + 4,
-                              frameMask.begin());
+                    std::copy(buffer + i, buffer + i + 4, frameMask.begin());
                     i += 4;
                 }
                 if (frameMasked && framePayloadLen > 0 && _applyMask) {
@@ -517,10 +662,10 @@ bool WebSocketProtocol::processData() {
                 } else {
                     _currentFrameMasker = std::make_unique<XorMaskerNull>();
                 }
-                _data.erase(_data.begin(), _data.begin() + (std::ptrdiff_t)i);
+                pos += i;
                 _currentFrame = FrameHeader(frameOpcode, frameFin, frameRsv, framePayloadLen, frameMask);
                 onFrameBegin();
-                return framePayloadLen == 0 || !_data.empty();
+                return framePayloadLen == 0 || pos < length;
             } else {
                 return false;
             }
@@ -529,18 +674,13 @@ bool WebSocketProtocol::processData() {
         }
     } else {
         uint64_t rest = _currentFrame->_length - _currentFrameMasker->pointer();
-        ByteArray payload;
-        if (bufferedLen >= rest) {
-            payload.assign(_data.begin(), _data.begin() + (std::ptrdiff_t)rest);
-            _data.erase(_data.begin(), _data.begin() + (std::ptrdiff_t)rest);
-        } else {
-            payload = std::move(_data);
-        }
-
-        if (!payload.empty()) {
-            _currentFrameMasker->process(payload.data(), payload.size());
+        auto payloadLen = (size_t)std::min(rest, (uint64_t)bufferedLen);
+        // Unmasked in place, the payload is copied once into the frame buffer
+        if (payloadLen > 0) {
+            _currentFrameMasker->process(buffer, payloadLen);
         }
-        if (!onFrameData(std::move(payload))) {
+        pos += payloadLen;
+        if (!onFrameData(buffer, payloadLen)) {
             return false;
         }
         if (_currentFrameMasker->pointer() == _currentFrame->_length) {
@@ -548,7 +688,7 @@ bool WebSocketProtocol::processData() {
                 return false;
             }
         }
-        return !_data.empty();
+        return pos < length;
     }
 }
 
@@ -608,66 +748,46 @@ void WebSocketProtocol::sendCloseFrame(boost::optional<unsigned short> code, boo
 
 void WebSocketProtocol::sendFrame(Byte opcode, const Byte *payload, size_t length, bool fin, Byte rsv,
                                   boost::optional<WebSocketMask> mask, size_t payloadLen, size_t chopsize, bool sync) {
-    ByteArray pl;
-    size_t l;
-    if (payloadLen > 0) {
-        if (length == 0) {
-            NET4CXX_THROW_EXCEPTION(Exception, "cannot construct repeated payload with length %llu"
-                                               " from payload of length 0", payloadLen);
-        }
-        l = payloadLen;
-        for (size_t i = 0; i < payloadLen / length; ++i) {
-            pl.insert(pl.end(), payload, payload + length);
-        }
-        pl.insert(pl.end(), payload, payload + payloadLen % length);
-    } else {
-        l = length;
-        pl.assign(payload, payload + length);
+    if (payloadLen > 0 && length == 0) {
+        NET4CXX_THROW_EXCEPTION(Exception, "cannot construct repeated payload with length %llu"
+                                           " from payload of length 0", payloadLen);
     }
+    size_t l = payloadLen > 0 ? payloadLen : length;
 
-    Byte b0 = 0u;
+    Byte header[MAX_FRAME_HEADER_LENGTH];
+    size_t headerLength = 0;
+    header[headerLength] = 0u;
     if (fin) {
-        b0 |= (1u << 7u);
+        header[headerLength] |= (1u << 7u);
     }
-    b0 |= (Byte)((rsv % 8u) << 4u);
-    b0 |= opcode % 128u;
+    header[headerLength] |= (Byte)((rsv % 8u) << 4u);
+    header[headerLength++] |= opcode % 128u;
 
-    Byte b1 = 0u;
-    ByteArray mv;
-    if (mask || (!_isServer && _maskClientFrames) || (_isServer && _maskServerFrames)) {
-        b1 |= 1u << 7u;
-        if (!mask) {
-            mask.emplace();
-            Random::randBytes(*mask);
-            mv.insert(mv.end(), mask->begin(), mask->end());
-        }
-
-        if (l > 0 && _applyMask) {
-            auto masker = createXorMasker(*mask, l);
-            masker->process(pl.data(), pl.size());
-        }
-    }
-    ByteArray el;
+    bool masked = mask || (bool)((!_isServer && _maskClientFrames) || (_isServer && _maskServerFrames));
+    Byte b1 = masked ? (Byte)(1u << 7u) : (Byte)0u;
     if (l <= 125) {
-        b1 |= (Byte)l;
+        header[headerLength++] = b1 | (Byte)l;
     } else if (l <= 0xFFFFu) {
-        b1 |= 126u;
+        header[headerLength++] = b1 | (Byte)126u;
         uint16_t len = boost::endian::native_to_big((uint16_t)l);
-        el.insert(el.end(), (Byte *)&len, (Byte *)&len + sizeof(len));
+        std::memcpy(header + headerLength, &len, sizeof(len));
+        headerLength += sizeof(len);
     } else if (l <= 0x7FFFFFFFFFFFFFFFu) {
-        b1 |= 127u;
+        header[headerLength++] = b1 | (Byte)127u;
         uint64_t len = boost::endian::native_to_big((uint64_t)l);
-        el.insert(el.end(), (Byte *)&len, (Byte *)&len + sizeof(len));
+        std::memcpy(header + headerLength, &len, sizeof(len));
+        headerLength += sizeof(len);
     } else {
         NET4CXX_THROW_EXCEPTION(Exception, "invalid payload length");
     }
-
-    ByteArray raw;
-    raw.push_back(b0);
-    raw.push_back(b1);
-    raw.insert(raw.end(), el.begin(), el.end());
-    raw.insert(raw.end(), mv.begin(), mv.end());
-    raw.insert(raw.end(), pl.begin(), pl.end());
+    if (masked) {
+        if (!mask) {
+            mask.emplace();
+            Random::randBytes(*mask);
+        }
+        std::memcpy(header + headerLength, mask->data(), mask->size());
+        headerLength += mask->size();
+    }
 
     if (opcode == 0u || opcode == 1u || opcode == 2u) {
         _trafficStats._outgoingWebSocketFrames += 1;
@@ -677,6 +797,41 @@ void WebSocketProtocol::sendFrame(Byte opcode, const Byte *payload, size_t lengt
         FrameHeader frameHeader(opcode, fin, rsv, l, mask);
         logTxFrame(frameHeader, payload, length, payloadLen, chopsize, sync);
     }
+
+    bool applyMask = masked && l > 0 && _applyMask;
+    if (payloadLen == 0 && chopsize == 0 && !sync && _sendQueue.empty() && !_logOctets) {
+        // Header and payload go to the transport as they are, only a masked payload needs a copy
+        const Byte *data = payload;
+        ByteArray scratch;
+        if (applyMask) {
+            ByteArray &masking = length <= MAX_MASK_BUFFER_SIZE ? _maskBuffer : scratch;
+            masking.assign(payload, payload + length);
+            maskPayload(*mask, masking.data(), length);
+            data = masking.data();
+        }
+        write(header, headerLength, data, length);
+        if (_state == State::OPEN) {
+            _trafficStats._outgoingOctetsWireLevel += headerLength + length;
+        } else if (_state == State::CONNECTING || _state == State::PROXY_CONNECTING) {
+            _trafficStats._preopenOutgoingOctetsWireLevel += headerLength + length;
+        }
+        return;
+    }
+
+    ByteArray raw;
+    raw.reserve(headerLength + l);
+    raw.insert(raw.end(), header, header + headerLength);
+    if (payloadLen > 0) {
+        for (size_t i = 0; i < payloadLen / length; ++i) {
+            raw.insert(raw.end(), payload, payload + length);
+        }
+        raw.insert(raw.end(), payload, payload + payloadLen % length);
+    } else {
+        raw.insert(raw.end(), payload, payload + length);
+    }
+    if (applyMask) {
+        maskPayload(*mask, raw.data() + headerLength, l);
+    }
     sendData(raw.data(), raw.size(), sync, chopsize);
 }
 
@@ -714,6 +869,18 @@ void WebSocketProtocol::sendData(const Byte *data, size_t length, bool sync, siz
     }
 }
 
+void WebSocketProtocol::sendMessageFrame(const Byte *payload, size_t length, bool fin, bool sync) {
+    if (_state != State::OPEN) {
+        return;
+    }
+    if (_sendState == SendState::MESSAGE_BEGIN) {
+        sendFrame(_sendMessageOpcode, payload, length, fin, (Byte)(_sendMessageCompressed ? 4 : 0), {}, 0, 0, sync);
+        _sendState = SendState::INSIDE_MESSAGE;
+    } else {
+        sendFrame(0, payload, length, fin, 0u, {}, 0, 0, sync);
+    }
+}
+
 void WebSocketProtocol::send() {
     if (!_sendQueue.empty()) {
         auto e = std::move(_sendQueue.front());
@@ -768,7 +935,9 @@ bool WebSocketProtocol::onFrameBegin() {
             if (_trackedTimings) {
                 _trackedTimings->track("onMessageBegin");
             }
-            onMessageBegin(_currentFrame->_opcode == MESSAGE_TYPE_BINARY);
+            _messageIsBinary = _currentFrame->_opcode == MESSAGE_TYPE_BINARY;
+            _messageDataTotalLength = 0;
+            onMessageBegin(_messageIsBinary);
         }
         onMessageFrameBegin(_currentFrame->_length);
     }
@@ -792,18 +961,21 @@ void WebSocketProtocol::onMessageFrameBegin(uint64_t length) {
     }
 }
 
-bool WebSocketProtocol::onFrameData(ByteArray payload) {
+bool WebSocketProtocol::onFrameData(const Byte *payload, size_t length) {
     if (_currentFrame->_opcode > 7u) {
-        BufferUtil::concat(_controlFrameData, std::move(payload));
+        _controlFrameData.insert(_controlFrameData.end(), payload, payload + length);
     } else {
         size_t compressedLen, uncompressedLen;
+        ByteArray decompressed;
         if (_isMessageCompressed) {
-            compressedLen = payload.size();
+            compressedLen = length;
             NET4CXX_LOG_DEBUG(gGenLog, "RX compressed %llu octets", compressedLen);
-            payload = _perMessageCompress->decompressMessageData(payload.data(), payload.size());
-            uncompressedLen = payload.size();
+            decompressed = _perMessageCompress->decompressMessageData(payload, length);
+            payload = decompressed.data();
+            length = decompressed.size();
+            uncompressedLen = length;
         } else {
-            compressedLen = payload.size();
+            compressedLen = length;
             uncompressedLen = compressedLen;
         }
 
@@ -813,7 +985,7 @@ bool WebSocketProtocol::onFrameData(ByteArray payload) {
         }
 
         if (_utf8validateIncomingCurrentMessage) {
-            _utf8validateLast = _utf8validator.validate(payload);
+            _utf8validateLast = _utf8validator.validate(payload, length);
             if (!std::get<0>(_utf8validateLast)) {
                 if (invalidPayload("encountered invalid UTF-8 while processing text message at payload octet index " +
                                    std::to_string(std::get<3>(_utf8validateLast)))) {
@@ -821,25 +993,35 @@ bool WebSocketProtocol::onFrameData(ByteArray payload) {
                 }
             }
         }
-        onMessageFrameData(std::move(payload));
-    }
-    return true;
-}
-
-void WebSocketProtocol::onMessageFrameData(ByteArray payload) {
-    if (!_failedByMe) {
-        if (_webSocketVersion == 0) {
-            _messageDataTotalLength += payload.size();
+        if (_webSocketVersion == 0 && !_failedByMe) {
+            _messageDataTotalLength += length;
             if (0 < _maxMessagePayloadSize && _maxMessagePayloadSize < _messageDataTotalLength) {
                 _wasMaxMessagePayloadSizeExceeded = true;
                 failConnection(CLOSE_STATUS_CODE_MESSAGE_TOO_BIG, "message exceeds payload limit of " +
                                                                   std::to_string(_maxMessagePayloadSize) + " octets");
             }
-            BufferUtil::concat(_messageData, std::move(payload));
-        } else {
-            BufferUtil::concat(_frameData, std::move(payload));
+        }
+        if (!_failedByMe) {
+            onMessageFrameData(payload, length);
         }
     }
+    return true;
+}
+
+void WebSocketProtocol::onMessageBegin(bool isBinary) {
+    _messageData.clear();
+}
+
+void WebSocketProtocol::onMessageFrameData(const Byte *payload, size_t length) {
+    if (_webSocketVersion == 0) {
+        _messageData.insert(_messageData.end(), payload, payload + length);
+    } else {
+        if (_frameData.empty() && !_isMessageCompressed) {
+            // Sized up front, so a large frame arriving over many reads is never reallocated
+            _frameData.reserve((size_t)std::min(_frameLength, (uint64_t)MAX_FRAME_RESERVE));
+        }
+        _frameData.insert(_frameData.end(), payload, payload + length);
+    }
 }
 
 bool WebSocketProtocol::onFrameEnd() {
@@ -874,7 +1056,10 @@ bool WebSocketProtocol::onFrameEnd() {
                 _trafficStats._incomingWebSocketMessages += 1;
             }
 
-            onMessageEnd();
+            if (!_failedByMe) {
+                onMessageEnd();
+            }
+            _messageData.clear();
             _insideMessage = false;
         }
 
@@ -884,13 +1069,10 @@ bool WebSocketProtocol::onFrameEnd() {
 }
 
 void WebSocketProtocol::onMessageEnd() {
-    if (!_failedByMe) {
-        if (_trackedTimings) {
-            _trackedTimings->track("onMessage");
-        }
-        onMessage(std::move(_messageData), _messageIsBinary);
+    if (_trackedTimings) {
+        _trackedTimings->track("onMessage");
     }
-    _messageData.clear();
+    onMessage(std::move(_messageData), _messageIsBinary);
 }
 
 bool WebSocketProtocol::processControlFrame() {
@@ -1550,6 +1732,13 @@ void WebSocketServerProtocol::succeedHandshake(std::pair<std::string, WebSocketH
         }
     }
 
+    if (!pmceOffers.empty() && !PerMessageDeflate::isMemoryAvailable()) {
+        // Falls back to uncompressed messages rather than growing past the zlib memory budget
+        NET4CXX_LOG_DEBUG(gGenLog, "client request permessage-compress extension, "
+                                   "but the compression memory budget is exhausted");
+        pmceOffers.clear();
+    }
+
     if (!pmceOffers.empty()) {
         PerMessageCompressOfferAcceptPtr accept;
         if (_perMessageCompressionAccept) {
@@ -2137,8 +2326,12 @@ void WebSocketClientProtocol::startHandshake() {
 
     StringVector extensions;
 
-    for (auto &offer: _perMessageCompressionOffers) {
-        extensions.emplace_back(offer->getExtensionString());
+    if (PerMessageDeflate::isMemoryAvailable()) {
+        for (auto &offer: _perMessageCompressionOffers) {
+            extensions.emplace_back(offer->getExtensionString());
+        }
+    } else if (!_perMessageCompressionOffers.empty()) {
+        NET4CXX_LOG_DEBUG(gGenLog, "compression memory budget exhausted, not offering permessage-compress");
     }
 
     if (!extensions.empty()) {
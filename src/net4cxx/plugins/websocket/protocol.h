@@ -21,6 +21,9 @@
 NS_BEGIN
 
 
+class WebSocketPreparedMessage;
+
+
 enum CloseStatus: unsigned short {
     CLOSE_STATUS_CODE_NORMAL = 1000,
     CLOSE_STATUS_CODE_GOING_AWAY = 1001,
@@ -62,6 +65,14 @@ public:
 
     virtual void onMessage(ByteArray payload, bool isBinary);
 
+    // By default these assemble each message for onMessage. Overriding them receives a message piece by piece in
+    // constant memory, where a payload is only valid during the call
+    virtual void onMessageBegin(bool isBinary);
+
+    virtual void onMessageFrameData(const Byte *payload, size_t length);
+
+    virtual void onMessageEnd();
+
     virtual void onPing(ByteArray payload);
 
     virtual void onPong(ByteArray payload);
@@ -86,6 +97,22 @@ public:
         sendMessage((const Byte *)payload.data(), payload.size(), isBinary, fragmentSize, sync, doNotCompress);
     }
 
+    // Queues the shared frame of the message when this connection can use it, otherwise frames the payload itself
+    void sendPreparedMessage(WebSocketPreparedMessage &message);
+
+    // Sends a message in pieces, each piece one fragment. Other messages must wait for endMessage(), control frames
+    // may still go out in between
+    void beginMessage(bool isBinary=false, bool doNotCompress=false);
+
+    // False when the compressor absorbed the piece without output, so no fragment was sent for it
+    bool sendMessageData(const Byte *payload, size_t length, bool sync=false);
+
+    void endMessage(bool sync=false);
+
+    bool isSendingMessage() const {
+        return _sendState != SendState::GROUND;
+    }
+
     void sendPing(const Byte *payload, size_t length);
 
     void sendPing(const ByteArray &payload) {
@@ -130,6 +157,10 @@ public:
         return _peer;
     }
 
+    State getState() const {
+        return _state;
+    }
+
     const Timings* getTrackedTimings() const {
         return _trackedTimings.get_ptr();
     }
@@ -138,6 +169,9 @@ public:
         return _trafficStats;
     }
 
+    // Also counts frames still held back in the send queue
+    size_t getPendingWriteSize() const;
+
     template <typename SelfT>
     std::shared_ptr<const SelfT> getSelf() const {
         return std::static_pointer_cast<SelfT>(shared_from_this());
@@ -186,7 +220,17 @@ protected:
 
     void consumeData();
 
-    bool processData();
+    void consumeFrames(Byte *data, size_t length);
+
+    size_t completeFrameHeader(const Byte *data, size_t length);
+
+    static size_t frameHeaderLength(Byte b) {
+        Byte payloadLen1 = b & 0x7fu;
+        size_t extendedLen = payloadLen1 == 126u ? 2 : (payloadLen1 == 127u ? 8 : 0);
+        return 2 + extendedLen + ((b & 0x80u) != 0 ? 4 : 0);
+    }
+
+    bool processData(Byte *data, size_t length, size_t &pos);
 
     bool protocolViolation(const std::string &reason) {
         NET4CXX_LOG_DEBUG(gGenLog, "Protocol violation: %s", reason.c_str());
@@ -210,6 +254,16 @@ protected:
 
     void sendData(const Byte *data, size_t length, bool sync=false, size_t chopsize=0);
 
+    void sendMessageFrame(const Byte *payload, size_t length, bool fin, bool sync);
+
+    static void maskPayload(const WebSocketMask &mask, Byte *data, size_t length) {
+        if (length < XorMaskerWide::MIN_LENGTH) {
+            XorMaskerSimple(mask).process(data, length);
+        } else {
+            XorMaskerWide(mask).process(data, length);
+        }
+    }
+
     void trigger() {
         if (!_triggered) {
             _triggered = true;
@@ -221,17 +275,9 @@ protected:
 
     bool onFrameBegin();
 
-    void onMessageBegin(bool isBinary) {
-        _messageIsBinary = isBinary;
-        _messageData.clear();
-        _messageDataTotalLength = 0;
-    }
-
     void onMessageFrameBegin(uint64_t length);
 
-    bool onFrameData(ByteArray payload);
-
-    void onMessageFrameData(ByteArray payload);
+    bool onFrameData(const Byte *payload, size_t length);
 
     bool onFrameEnd();
 
@@ -248,8 +294,6 @@ protected:
         }
     }
 
-    void onMessageEnd();
-
     bool processControlFrame();
 
     bool onCloseFrame(boost::optional<unsigned short> code, boost::optional<std::string> reasonRaw);
@@ -331,6 +375,9 @@ protected:
     TrafficStats _trafficStats;
     State _state;
     SendState _sendState;
+    Byte _sendMessageOpcode{0};
+    bool _sendMessageCompressed{false};
+    ByteArray _maskBuffer;
     ByteArray _data;
     std::deque<std::pair<ByteArray, bool>> _sendQueue;
     bool _triggered{false};
@@ -374,6 +421,10 @@ protected:
 
     static const std::string WS_MAGIC;
     static const double QUEUED_WRITE_DELAY;
+    static constexpr size_t MAX_FRAME_RESERVE = 16 * 1024 * 1024;
+    static constexpr size_t MAX_FRAME_HEADER_LENGTH = 14;
+    // Larger payloads are masked in a temporary buffer rather than one kept for the connection's lifetime
+    static constexpr size_t MAX_MASK_BUFFER_SIZE = 64 * 1024;
 };
 
 using WebSocketProtocolPtr = std::shared_ptr<WebSocketProtocol>;
@@ -0,0 +1,202 @@
+//
+// Created by yuwenyong.vincent on 2019-03-23.
+//
+
+#include "net4cxx/plugins/websocket/pubsub.h"
+#include "net4cxx/core/network/reactor.h"
+
+
+NS_BEGIN
+
+
+bool WebSocketPubSubHub::subscribe(const std::string &topic, const WebSocketProtocolPtr &protocol) {
+    Reactor *reactor = protocol->reactor();
+    if (!reactor) {
+        return false;
+    }
+    NET4CXX_ASSERT_MSG(reactor == Reactor::current(), "Subscribe from the reactor serving the protocol");
+    Shard *shard = getShard(reactor);
+    auto &target = shard->topics[topic];
+    if (!target.group) {
+        target.group.reset(new WebSocketBroadcastGroup(reactor));
+        target.group->setMaxPendingBytes(_maxPendingBytes);
+        target.group->setSlowConsumerPolicy(_slowConsumerPolicy);
+    } else if (target.group->contains(protocol.get())) {
+        return false;
+    }
+    target.group->add(protocol);
+    updateSubscribers(*shard, topic);
+    return true;
+}
+
+bool WebSocketPubSubHub::unsubscribe(const std::string &topic, const WebSocketProtocol *protocol) {
+    Shard *shard = getShard(Reactor::current());
+    auto iter = shard->topics.find(topic);
+    if (iter == shard->topics.end() || !iter->second.group->remove(protocol)) {
+        return false;
+    }
+    updateSubscribers(*shard, topic);
+    return true;
+}
+
+size_t WebSocketPubSubHub::unsubscribeAll(const WebSocketProtocol *protocol) {
+    Shard *shard = getShard(Reactor::current());
+    StringVector topics;
+    for (auto &kv: shard->topics) {
+        if (kv.second.group->remove(protocol)) {
+            topics.emplace_back(kv.first);
+        }
+    }
+    for (auto &topic: topics) {
+        updateSubscribers(*shard, topic);
+    }
+    return topics.size();
+}
+
+size_t WebSocketPubSubHub::publish(const std::string &topic, const WebSocketPreparedMessagePtr &message,
+                                   const WebSocketProtocol *exclude) {
+    // Framed before any reactor sees it, the reactors then only read the shared frame
+    message->getFrame();
+    size_t count = 0;
+    std::lock_guard<std::mutex> lock(_lock);
+    auto iter = _topics.find(topic);
+    if (iter == _topics.end()) {
+        return 0;
+    }
+    auto &state = iter->second;
+    ++state->published;
+    for (size_t i = 0; i != state->subscribers.size(); ++i) {
+        if (state->subscribers[i] == 0) {
+            continue;
+        }
+        Shard *shard = _shards[i].get();
+        bool schedule;
+        {
+            std::lock_guard<std::mutex> pendingLock(shard->pendingLock);
+            shard->pending.emplace_back(Publication{state, message, exclude});
+            schedule = !shard->scheduled;
+            shard->scheduled = true;
+        }
+        // One callback per reactor turn however many messages pile up for it meanwhile
+        if (schedule) {
+            shard->reactor->addCallback([this, shard]() {
+                drain(*shard);
+            });
+        }
+        ++count;
+    }
+    return count;
+}
+
+size_t WebSocketPubSubHub::getSubscriberCount(const std::string &topic) const {
+    std::lock_guard<std::mutex> lock(_lock);
+    auto iter = _topics.find(topic);
+    if (iter == _topics.end()) {
+        return 0;
+    }
+    size_t count = 0;
+    for (auto subscribers: iter->second->subscribers) {
+        count += subscribers;
+    }
+    return count;
+}
+
+bool WebSocketPubSubHub::getTopicStats(const std::string &topic, TopicStats &stats) const {
+    std::lock_guard<std::mutex> lock(_lock);
+    auto iter = _topics.find(topic);
+    if (iter == _topics.end()) {
+        return false;
+    }
+    stats = makeStats(*iter->second);
+    return true;
+}
+
+std::vector<WebSocketPubSubHub::TopicStats> WebSocketPubSubHub::getAllTopicStats() const {
+    std::vector<TopicStats> stats;
+    std::lock_guard<std::mutex> lock(_lock);
+    stats.reserve(_topics.size());
+    for (auto &kv: _topics) {
+        stats.emplace_back(makeStats(*kv.second));
+    }
+    return stats;
+}
+
+WebSocketPubSubHub::Shard* WebSocketPubSubHub::getShard(Reactor *reactor) {
+    NET4CXX_ASSERT(reactor);
+    std::lock_guard<std::mutex> lock(_lock);
+    for (auto &shard: _shards) {
+        if (shard->reactor == reactor) {
+            return shard.get();
+        }
+    }
+    _shards.emplace_back(new Shard(reactor, _shards.size()));
+    return _shards.back().get();
+}
+
+void WebSocketPubSubHub::updateSubscribers(Shard &shard, const std::string &topic) {
+    auto iter = shard.topics.find(topic);
+    NET4CXX_ASSERT(iter != shard.topics.end());
+    size_t subscribers = iter->second.group->size();
+    std::lock_guard<std::mutex> lock(_lock);
+    auto &state = _topics[topic];
+    if (!state) {
+        state = std::make_shared<TopicState>(topic);
+    }
+    if (state->subscribers.size() <= shard.index) {
+        state->subscribers.resize(shard.index + 1, 0);
+    }
+    state->subscribers[shard.index] = subscribers;
+    iter->second.subscribers = subscribers;
+    if (subscribers == 0) {
+        // A session unsubscribing from its onClose while the group is sending leaves the group to the delivery
+        if (!shard.delivering) {
+            shard.topics.erase(iter);
+        }
+        if (std::all_of(state->subscribers.begin(), state->subscribers.end(), [](size_t count) {
+            return count == 0;
+        })) {
+            _topics.erase(topic);
+        }
+    }
+}
+
+void WebSocketPubSubHub::drain(Shard &shard) {
+    std::vector<Publication> pending;
+    {
+        std::lock_guard<std::mutex> lock(shard.pendingLock);
+        pending.swap(shard.pending);
+        shard.scheduled = false;
+    }
+    for (auto &publication: pending) {
+        deliver(shard, publication);
+    }
+}
+
+void WebSocketPubSubHub::deliver(Shard &shard, const Publication &publication) {
+    const std::string &topic = publication.topic->topic;
+    auto iter = shard.topics.find(topic);
+    if (iter == shard.topics.end()) {
+        return;
+    }
+    auto &target = iter->second;
+    uint64_t skipped = target.group->getSkippedCount();
+    ++shard.delivering;
+    size_t count = target.group->broadcast(publication.message, publication.exclude);
+    --shard.delivering;
+    publication.topic->delivered += count;
+    publication.topic->skipped += target.group->getSkippedCount() - skipped;
+    // Closed sessions were dropped by the group
+    if (target.group->size() != target.subscribers || target.subscribers == 0) {
+        updateSubscribers(shard, topic);
+    }
+}
+
+WebSocketPubSubHub::TopicStats WebSocketPubSubHub::makeStats(const TopicState &state) {
+    TopicStats stats{state.topic, 0, state.published, state.delivered, state.skipped};
+    for (auto subscribers: state.subscribers) {
+        stats.subscribers += subscribers;
+    }
+    return stats;
+}
+
+NS_END
@@ -0,0 +1,157 @@
+//
+// Created by yuwenyong.vincent on 2019-03-23.
+//
+
+#ifndef NET4CXX_PLUGINS_WEBSOCKET_PUBSUB_H
+#define NET4CXX_PLUGINS_WEBSOCKET_PUBSUB_H
+
+#include "net4cxx/plugins/websocket/base.h"
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include "net4cxx/plugins/websocket/broadcast.h"
+
+
+NS_BEGIN
+
+
+// Topic subscriptions kept in one shard per reactor, each only touched by its own reactor thread. A publish from any
+// thread frames the message once and hands it to the shards having subscribers, a shard drains everything queued for
+// it in a single reactor callback and fans out to its local sessions. The hub must outlive the reactors it serves
+class NET4CXX_COMMON_API WebSocketPubSubHub: public boost::noncopyable {
+public:
+    struct TopicStats {
+        std::string topic;
+        size_t subscribers;
+        uint64_t published;
+        uint64_t delivered;
+        uint64_t skipped;
+    };
+
+    struct TopicState {
+        explicit TopicState(std::string topic)
+                : topic(std::move(topic)) {
+
+        }
+
+        const std::string topic;
+        // Subscribers per shard index, guarded by the hub lock
+        std::vector<size_t> subscribers;
+        std::atomic<uint64_t> published{0};
+        std::atomic<uint64_t> delivered{0};
+        std::atomic<uint64_t> skipped{0};
+    };
+
+    using TopicStatePtr = std::shared_ptr<TopicState>;
+
+    struct Publication {
+        TopicStatePtr topic;
+        WebSocketPreparedMessagePtr message;
+        const WebSocketProtocol *exclude;
+    };
+
+    struct ShardTopic {
+        std::unique_ptr<WebSocketBroadcastGroup> group;
+        size_t subscribers{0};
+    };
+
+    struct Shard {
+        Shard(Reactor *reactor, size_t index)
+                : reactor(reactor)
+                , index(index) {
+
+        }
+
+        Reactor *const reactor;
+        const size_t index;
+        std::mutex pendingLock;
+        std::vector<Publication> pending;
+        bool scheduled{false};
+        size_t delivering{0};
+        std::unordered_map<std::string, ShardTopic> topics;
+    };
+
+    WebSocketPubSubHub() = default;
+
+    // Called from the reactor thread serving the protocol
+    bool subscribe(const std::string &topic, const WebSocketProtocolPtr &protocol);
+
+    bool unsubscribe(const std::string &topic, const WebSocketProtocol *protocol);
+
+    // Meant for onClose, closed sessions are otherwise only dropped at the next delivery to their topics
+    size_t unsubscribeAll(const WebSocketProtocol *protocol);
+
+    size_t publish(const std::string &topic, const Byte *payload, size_t length, bool isBinary=false,
+                   const WebSocketProtocol *exclude=nullptr) {
+        return publish(topic, std::make_shared<WebSocketPreparedMessage>(payload, length, isBinary), exclude);
+    }
+
+    size_t publish(const std::string &topic, const ByteArray &payload, bool isBinary=false,
+                   const WebSocketProtocol *exclude=nullptr) {
+        return publish(topic, payload.data(), payload.size(), isBinary, exclude);
+    }
+
+    size_t publish(const std::string &topic, const std::string &payload, bool isBinary=false,
+                   const WebSocketProtocol *exclude=nullptr) {
+        return publish(topic, (const Byte *)payload.data(), payload.size(), isBinary, exclude);
+    }
+
+    // Safe from any thread. Returns the number of reactors the message was queued for
+    size_t publish(const std::string &topic, const WebSocketPreparedMessagePtr &message,
+                   const WebSocketProtocol *exclude=nullptr);
+
+    size_t getSubscriberCount(const std::string &topic) const;
+
+    size_t getTopicCount() const {
+        std::lock_guard<std::mutex> lock(_lock);
+        return _topics.size();
+    }
+
+    size_t getShardCount() const {
+        std::lock_guard<std::mutex> lock(_lock);
+        return _shards.size();
+    }
+
+    bool getTopicStats(const std::string &topic, TopicStats &stats) const;
+
+    std::vector<TopicStats> getAllTopicStats() const;
+
+    // Applies to the topics a reactor starts serving afterwards
+    void setMaxPendingBytes(size_t maxPendingBytes) {
+        _maxPendingBytes = maxPendingBytes;
+    }
+
+    size_t getMaxPendingBytes() const {
+        return _maxPendingBytes;
+    }
+
+    void setSlowConsumerPolicy(WebSocketBroadcastGroup::SlowConsumerPolicy policy) {
+        _slowConsumerPolicy = policy;
+    }
+
+    WebSocketBroadcastGroup::SlowConsumerPolicy getSlowConsumerPolicy() const {
+        return _slowConsumerPolicy;
+    }
+protected:
+    Shard* getShard(Reactor *reactor);
+
+    // Records the size of the shard's group, dropping the topic once nobody subscribes to it anywhere
+    void updateSubscribers(Shard &shard, const std::string &topic);
+
+    void drain(Shard &shard);
+
+    void deliver(Shard &shard, const Publication &publication);
+
+    static TopicStats makeStats(const TopicState &state);
+
+    mutable std::mutex _lock;
+    std::vector<std::unique_ptr<Shard>> _shards;
+    std::unordered_map<std::string, TopicStatePtr> _topics;
+    std::atomic<size_t> _maxPendingBytes{WebSocketBroadcastGroup::DEFAULT_MAX_PENDING_BYTES};
+    std::atomic<WebSocketBroadcastGroup::SlowConsumerPolicy> _slowConsumerPolicy{
+            WebSocketBroadcastGroup::SKIP_SLOW_CONSUMER};
+};
+
+NS_END
+
+#endif //NET4CXX_PLUGINS_WEBSOCKET_PUBSUB_H
@@ -0,0 +1,79 @@
+//
+// Created by yuwenyong.vincent on 2019-03-23.
+//
+
+#include "net4cxx/plugins/websocket/stream.h"
+
+
+NS_BEGIN
+
+
+constexpr size_t WebSocketMessageWriter::DEFAULT_FRAGMENT_SIZE;
+
+DeferredPtr WebSocketMessageWriter::start() {
+    NET4CXX_ASSERT_MSG(!_deferred && !_finished, "Writer already started");
+    auto deferred = _deferred = makeDeferred();
+    auto protocol = _protocol.lock();
+    if (!protocol || protocol->getState() != WebSocketProtocol::State::OPEN) {
+        finish(std::make_exception_ptr(NET4CXX_MAKE_EXCEPTION(ConnectionDone, "WebSocket connection is not open")));
+        return deferred;
+    }
+    protocol->beginMessage(_isBinary, _doNotCompress);
+    // Not a streaming producer, the transport asks for more each time its write queue drained
+    protocol->registerProducer(shared_from_this(), false);
+    return deferred;
+}
+
+void WebSocketMessageWriter::stopProducing() {
+    if (!_finished) {
+        finish(std::make_exception_ptr(NET4CXX_MAKE_EXCEPTION(ConnectionDone, "")));
+    }
+}
+
+void WebSocketMessageWriter::resumeProducing() {
+    auto self = shared_from_this();
+    auto protocol = _protocol.lock();
+    if (_finished || !protocol) {
+        return;
+    }
+    if (protocol->getState() != WebSocketProtocol::State::OPEN) {
+        protocol->endMessage();
+        protocol->unregisterProducer();
+        finish(std::make_exception_ptr(NET4CXX_MAKE_EXCEPTION(ConnectionDone, "WebSocket connection is closing")));
+        return;
+    }
+    try {
+        // Keeps reading until a fragment went out, the transport only asks again after a write
+        size_t length;
+        do {
+            length = _reader(_buffer.data(), _buffer.size());
+            if (length == 0) {
+                protocol->endMessage();
+                protocol->unregisterProducer();
+                finish(nullptr);
+                return;
+            }
+            _bytesSent += length;
+        } while (!protocol->sendMessageData(_buffer.data(), length));
+    } catch (...) {
+        // The message can not be completed, so nothing sent after it could be framed correctly
+        protocol->unregisterProducer();
+        protocol->abortConnection();
+        finish(std::current_exception());
+    }
+}
+
+void WebSocketMessageWriter::finish(std::exception_ptr error) {
+    _finished = true;
+    if (_deferred) {
+        auto deferred = std::move(_deferred);
+        _deferred.reset();
+        if (error) {
+            deferred->errback(error);
+        } else {
+            deferred->callback(nullptr);
+        }
+    }
+}
+
+NS_END
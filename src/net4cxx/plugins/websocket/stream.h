@@ -0,0 +1,67 @@
+//
+// Created by yuwenyong.vincent on 2019-03-23.
+//
+
+#ifndef NET4CXX_PLUGINS_WEBSOCKET_STREAM_H
+#define NET4CXX_PLUGINS_WEBSOCKET_STREAM_H
+
+#include "net4cxx/plugins/websocket/base.h"
+#include "net4cxx/core/network/defer.h"
+#include "net4cxx/plugins/websocket/protocol.h"
+
+
+NS_BEGIN
+
+
+// Sends a message read piece by piece from a source. Registered as the transport's producer, it reads the next
+// fragment only once the previous ones were written, so a large payload is sent in constant memory
+class NET4CXX_COMMON_API WebSocketMessageWriter: public Producer,
+                                                 public std::enable_shared_from_this<WebSocketMessageWriter> {
+public:
+    // Fills the buffer and returns the number of bytes read, 0 once the payload is exhausted
+    using ReaderType = std::function<size_t (Byte *, size_t)>;
+
+    WebSocketMessageWriter(const WebSocketProtocolPtr &protocol, ReaderType reader, bool isBinary=false,
+                           size_t fragmentSize=DEFAULT_FRAGMENT_SIZE, bool doNotCompress=false)
+            : _protocol(protocol)
+            , _reader(std::move(reader))
+            , _isBinary(isBinary)
+            , _doNotCompress(doNotCompress)
+            , _buffer(fragmentSize ? fragmentSize : DEFAULT_FRAGMENT_SIZE) {
+
+    }
+
+    // Fires once the last fragment is queued, fails when the connection goes away or the reader throws first
+    DeferredPtr start();
+
+    void stopProducing() override;
+
+    void resumeProducing() override;
+
+    uint64_t getBytesSent() const {
+        return _bytesSent;
+    }
+
+    bool finished() const {
+        return _finished;
+    }
+
+    static constexpr size_t DEFAULT_FRAGMENT_SIZE = 64 * 1024;
+protected:
+    void finish(std::exception_ptr error);
+
+    std::weak_ptr<WebSocketProtocol> _protocol;
+    ReaderType _reader;
+    bool _isBinary;
+    bool _doNotCompress;
+    ByteArray _buffer;
+    DeferredPtr _deferred;
+    uint64_t _bytesSent{0};
+    bool _finished{false};
+};
+
+using WebSocketMessageWriterPtr = std::shared_ptr<WebSocketMessageWriter>;
+
+NS_END
+
+#endif //NET4CXX_PLUGINS_WEBSOCKET_STREAM_H
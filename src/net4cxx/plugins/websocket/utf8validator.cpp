@@ -3,9 +3,12 @@
 //
 
 #include "net4cxx/plugins/websocket/utf8validator.h"
+#include "net4cxx/common/utilities/utf8.h"
 
 NS_BEGIN
 
+constexpr size_t Utf8Validator::VECTORIZED_MIN_LENGTH;
+
 static const Byte UTF8VALIDATOR_DFA[] = {
         0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  // 00..1f
         0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  // 20..3f
@@ -38,12 +41,37 @@ Byte Utf8Validator::decode(Byte b) {
 
 Utf8Validator::ValidateResult Utf8Validator::validate(const Byte *ba, size_t len) {
     Byte state = _state;
-    for (size_t i = 0; i < len; ++i) {
+    size_t i = 0;
+    // Finish the code point left open by the previous fragment
+    for (; i < len && state != 0; ++i) {
+        state = UTF8VALIDATOR_DFA[256 + (state << 4u) + UTF8VALIDATOR_DFA[ba[i]]];
+        if (state == 1) {
+            return fail(i);
+        }
+    }
+    if (len - i >= VECTORIZED_MIN_LENGTH) {
+        // Only whole code points go to the vectorized check, a sequence cut at the end is left to the DFA
+        size_t end = len;
+        for (size_t k = 1; k <= 3; ++k) {
+            Byte b = ba[len - k];
+            if (b >= 0xC0) {
+                if ((size_t)(b >= 0xF0 ? 4 : (b >= 0xE0 ? 3 : 2)) > k) {
+                    end = len - k;
+                }
+                break;
+            } else if (b < 0x80) {
+                break;
+            }
+        }
+        // On failure the DFA runs over the same bytes again to find the offending octet
+        if (Utf8Util::validate(ba + i, end - i)) {
+            i = end;
+        }
+    }
+    for (; i < len; ++i) {
         state = UTF8VALIDATOR_DFA[256 + (state << 4u) + UTF8VALIDATOR_DFA[ba[i]]];
         if (state == 1) {
-            _state = state;
-            _index += i;
-            return std::make_tuple(false, false, i, _index);
+            return fail(i);
         }
     }
     _state = state;
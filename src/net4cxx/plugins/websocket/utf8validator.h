@@ -35,7 +35,15 @@ public:
     ValidateResult validate(const char *s) {
         return validate((const Byte *)s, strlen(s));
     }
+
+    static constexpr size_t VECTORIZED_MIN_LENGTH = 64;
 protected:
+    ValidateResult fail(size_t i) {
+        _state = 1;
+        _index += i;
+        return std::make_tuple(false, false, i, _index);
+    }
+
     unsigned int _codepoint{0};
     Byte _state{0};
     size_t _index{0};
@@ -6,7 +6,10 @@
 #define NET4CXX_PLUGINS_WEBSOCKET_WEBSOCKET_H
 
 #include "net4cxx/plugins/websocket/base.h"
+#include "net4cxx/plugins/websocket/broadcast.h"
 #include "net4cxx/plugins/websocket/protocol.h"
+#include "net4cxx/plugins/websocket/pubsub.h"
+#include "net4cxx/plugins/websocket/stream.h"
 
 
 NS_BEGIN
@@ -3,6 +3,12 @@
 //
 
 #include "net4cxx/plugins/websocket/xormasker.h"
+#include <cstring>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define NET4CXX_XORMASKER_X86
+#include <immintrin.h>
+#endif
 
 NS_BEGIN
 
@@ -51,4 +57,98 @@ void XorMaskerShifted1::process(Byte *data, uint64_t len) {
     _ptr += len;
 }
 
+
+
+namespace {
+
+void maskPortable(Byte *data, uint64_t len, uint64_t mask) {
+    uint64_t word;
+    for (; len >= 8; data += 8, len -= 8) {
+        std::memcpy(&word, data, 8);
+        word ^= mask;
+        std::memcpy(data, &word, 8);
+    }
+    // Whole words keep the phase, so the tail starts at the first mask byte again
+    auto tail = reinterpret_cast<const Byte *>(&mask);
+    for (uint64_t k = 0; k < len; ++k) {
+        data[k] = (Byte)(data[k] ^ tail[k]);
+    }
+}
+
+#ifdef NET4CXX_XORMASKER_X86
+
+void maskSSE2(Byte *data, uint64_t len, uint64_t mask) {
+    __m128i vmask = _mm_set1_epi64x((long long)mask);
+    for (; len >= 16; data += 16, len -= 16) {
+        auto p = reinterpret_cast<__m128i *>(data);
+        _mm_storeu_si128(p, _mm_xor_si128(_mm_loadu_si128(p), vmask));
+    }
+    maskPortable(data, len, mask);
+}
+
+__attribute__((target("avx2")))
+void maskAVX2(Byte *data, uint64_t len, uint64_t mask) {
+    __m256i vmask = _mm256_set1_epi64x((long long)mask);
+    for (; len >= 64; data += 64, len -= 64) {
+        auto p = reinterpret_cast<__m256i *>(data);
+        _mm256_storeu_si256(p, _mm256_xor_si256(_mm256_loadu_si256(p), vmask));
+        _mm256_storeu_si256(p + 1, _mm256_xor_si256(_mm256_loadu_si256(p + 1), vmask));
+    }
+    for (; len >= 32; data += 32, len -= 32) {
+        auto p = reinterpret_cast<__m256i *>(data);
+        _mm256_storeu_si256(p, _mm256_xor_si256(_mm256_loadu_si256(p), vmask));
+    }
+    maskSSE2(data, len, mask);
+}
+
+#endif
+
+}
+
+constexpr uint64_t XorMaskerWide::MIN_LENGTH;
+
+XorMaskerWide::XorMaskerWide(const WebSocketMask &mask, Kernel kernel)
+        : _ptr(0) {
+    for (size_t j = 0; j < _msk.size(); ++j) {
+        _msk[j] = mask[j & 3u];
+    }
+    switch (std::min(kernel, bestKernel())) {
+#ifdef NET4CXX_XORMASKER_X86
+        case AVX2:
+            _kernel = maskAVX2;
+            break;
+        case SSE2:
+            _kernel = maskSSE2;
+            break;
+#endif
+        default:
+            _kernel = maskPortable;
+            break;
+    }
+}
+
+uint64_t XorMaskerWide::pointer() const {
+    return _ptr;
+}
+
+void XorMaskerWide::reset() {
+    _ptr = 0;
+}
+
+void XorMaskerWide::process(Byte *data, uint64_t len) {
+    uint64_t mask;
+    std::memcpy(&mask, _msk.data() + (_ptr & 3u), 8);
+    _kernel(data, len, mask);
+    _ptr += len;
+}
+
+XorMaskerWide::Kernel XorMaskerWide::bestKernel() {
+#ifdef NET4CXX_XORMASKER_X86
+    static const Kernel kernel = __builtin_cpu_supports("avx2") ? AVX2 : SSE2;
+    return kernel;
+#else
+    return PORTABLE;
+#endif
+}
+
 NS_END
\ No newline at end of file
@@ -78,11 +78,46 @@ protected:
 };
 
 
+// Masks a word or a vector register at a time, the kernel is picked once from what the cpu supports
+class NET4CXX_COMMON_API XorMaskerWide: public XorMasker {
+public:
+    enum Kernel {
+        PORTABLE,
+        SSE2,
+        AVX2,
+    };
+
+    explicit XorMaskerWide(const WebSocketMask &mask)
+            : XorMaskerWide(mask, bestKernel()) {
+
+    }
+
+    XorMaskerWide(const WebSocketMask &mask, Kernel kernel);
+
+    uint64_t pointer() const override;
+
+    void reset() override;
+
+    void process(Byte *data, uint64_t len) override;
+
+    static Kernel bestKernel();
+
+    static constexpr uint64_t MIN_LENGTH = 16;
+protected:
+    typedef void (*KernelType)(Byte *data, uint64_t len, uint64_t mask);
+
+    uint64_t _ptr;
+    // The mask repeated twice, so that any phase can be read as eight consecutive bytes
+    std::array<Byte, 12> _msk;
+    KernelType _kernel;
+};
+
+
 inline std::unique_ptr<XorMasker> createXorMasker(const WebSocketMask &mask, uint64_t length=0) {
-    if (length < 128) {
+    if (length < XorMaskerWide::MIN_LENGTH) {
         return std::make_unique<XorMaskerSimple>(mask);
     } else {
-        return std::make_unique<XorMaskerShifted1>(mask);
+        return std::make_unique<XorMaskerWide>(mask);
     }
 }
 
@@ -58,6 +58,21 @@ void LogUtil::enablePrettyLogging(const OptionParser *options) {
         builder.setFilter(severity);
         Logging::addSink(builder.build());
     }
+    if (options->has("log_async")) {
+        const auto &overflow = options->get<std::string>("log_async_overflow");
+        AsyncLogging::OverflowPolicy policy;
+        if (overflow == "block") {
+            policy = AsyncLogging::BLOCK_PRODUCER;
+        } else if (overflow == "drop") {
+            policy = AsyncLogging::DROP_RECORDS;
+        } else if (overflow == "count") {
+            policy = AsyncLogging::REPORT_DROPPED;
+        } else {
+            NET4CXX_THROW_EXCEPTION(ValueError, "The value of log_async_overflow option should be"
+                                                " \"block\", \"drop\" or \"count\", not \"%s\"", overflow);
+        }
+        AsyncLogging::start(options->get<size_t>("log_async_buffer_size"), policy);
+    }
 }
 
 void LogUtil::defineLoggingOptions(OptionParser *options) {
@@ -74,6 +89,11 @@ void LogUtil::defineLoggingOptions(OptionParser *options) {
     options->addArgument<std::string>("log_rotate_interval", "The interval value of timed rotating", {}, {}, "logging");
     options->addArgument<std::string>("log_rotate_mode", "The mode of rotating files(time or size)",
                                       std::string("size"), {}, "logging");
+    options->addArgument("log_async", "Write log records from a background thread", "logging");
+    options->addArgument<size_t>("log_async_buffer_size", "Records buffered per thread when logging asynchronously",
+                                 AsyncLogging::DEFAULT_RING_CAPACITY, {}, "logging");
+    options->addArgument<std::string>("log_async_overflow", "What a thread does with a full log buffer(block, drop "
+                                      "or count)", std::string("count"), {}, "logging");
     options->addParseCallback([options]() {
         enablePrettyLogging(options);
     });
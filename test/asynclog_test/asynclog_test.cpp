@@ -0,0 +1,136 @@
+//
+// Created by yuwenyong.vincent on 2019-03-23.
+//
+
+#include "net4cxx/net4cxx.h"
+
+using namespace net4cxx;
+
+
+class AsyncLogTest: public Bootstrapper {
+public:
+    using Bootstrapper::Bootstrapper;
+
+    void onRun() override {
+        FileSinkBuilder builder(LOG_FILE, false);
+        builder.setFormatter();
+        builder.setFilter(NET4CXX_SEVERITY_INFO);
+        _sink = builder.build();
+        Logging::addSink(_sink);
+        reactor()->addCallback([this]() {
+            runTests();
+            reactor()->stop();
+        });
+    }
+
+    void onQuit() override {
+        Logging::removeSink(_sink);
+        _sink.reset();
+        std::remove(LOG_FILE);
+    }
+
+    void runTests() {
+        double syncRate = runThreads(THREADS, LINES);
+        bool ok = checkLines(THREADS, LINES);
+        std::cout << "synchronous: " << (ok ? "OK" : "FAILED") << ", " << syncRate << " lines/s" << std::endl;
+
+        AsyncLogging::start(AsyncLogging::DEFAULT_RING_CAPACITY, AsyncLogging::BLOCK_PRODUCER);
+        auto start = TimestampClock::now();
+        double asyncRate = runThreads(THREADS, LINES);
+        AsyncLogging::flush();
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(TimestampClock::now() - start);
+        ok = checkLines(THREADS, LINES) && AsyncLogging::getDroppedCount() == 0;
+        std::cout << "asynchronous: " << (ok ? "OK" : "FAILED") << ", " << asyncRate << " lines/s logged, "
+                  << (double)THREADS * LINES * 1000000.0 / (double)elapsed.count() << " lines/s written"
+                  << std::endl;
+
+        // Formatted by the caller, the writer thread could not copy the argument
+        std::ostringstream threadId;
+        threadId << std::this_thread::get_id();
+        NET4CXX_LOG_INFO(gGenLog, "caller formatted %s, %s", std::this_thread::get_id(), "deferred");
+        NET4CXX_LOG_INFO(gGenLog, (const Byte *)"dump", 4);
+        // A fatal record is on disk once the call returns
+        NET4CXX_LOG_FATAL(gGenLog, "fatal %d", 42);
+        std::string content = readLog(false);
+        ok = content.find("caller formatted " + threadId.str() + ", deferred") != std::string::npos &&
+             content.find("64 75 6d 70") != std::string::npos && content.find("fatal 42") != std::string::npos;
+        std::cout << "flush on fatal: " << (ok ? "OK" : "FAILED") << std::endl;
+        AsyncLogging::stop();
+
+        // Tiny rings overflow, every record is either written or counted as dropped
+        uint64_t written = AsyncLogging::getWrittenCount(), dropped = AsyncLogging::getDroppedCount();
+        AsyncLogging::start(16, AsyncLogging::DROP_RECORDS);
+        runThreads(THREADS, LINES);
+        AsyncLogging::stop();
+        written = AsyncLogging::getWrittenCount() - written;
+        dropped = AsyncLogging::getDroppedCount() - dropped;
+        ok = dropped > 0 && written + dropped == THREADS * LINES;
+        std::cout << "drop on overflow: " << (ok ? "OK" : "FAILED") << ", " << written << " written, " << dropped
+                  << " dropped" << std::endl;
+    }
+
+    double runThreads(size_t threads, size_t lines) {
+        std::vector<std::thread> workers;
+        size_t phase = ++_phase;
+        auto start = TimestampClock::now();
+        for (size_t i = 0; i != threads; ++i) {
+            workers.emplace_back([phase, i, lines]() {
+                for (size_t j = 0; j != lines; ++j) {
+                    NET4CXX_LOG_INFO(gGenLog, "phase %u thread %u line %u payload %s", phase, i, j,
+                                     std::string(32, 'x'));
+                }
+            });
+        }
+        for (auto &worker: workers) {
+            worker.join();
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(TimestampClock::now() - start);
+        return (double)threads * lines * 1000000.0 / (double)elapsed.count();
+    }
+
+    bool checkLines(size_t threads, size_t lines) {
+        std::istringstream content(readLog(true));
+        std::vector<size_t> next(threads, 0);
+        std::string line;
+        // The file keeps the lines of earlier phases
+        std::string prefix = StrUtil::format("phase %u ", _phase);
+        while (std::getline(content, line)) {
+            size_t pos = line.find(prefix);
+            if (pos == std::string::npos) {
+                continue;
+            }
+            unsigned thread, number;
+            if (sscanf(line.c_str() + pos + prefix.size(), "thread %u line %u", &thread, &number) != 2 ||
+                thread >= threads || number != next[thread]++) {
+                return false;
+            }
+        }
+        return std::all_of(next.begin(), next.end(), [lines](size_t count) {
+            return count == lines;
+        });
+    }
+
+    std::string readLog(bool flush) {
+        if (flush) {
+            logging::core::get()->flush();
+        }
+        std::ifstream file(LOG_FILE);
+        return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    static constexpr const char *LOG_FILE = "asynclog_test.log";
+    static constexpr size_t THREADS = 8;
+    static constexpr size_t LINES = 20000;
+protected:
+    SinkPtr _sink;
+    size_t _phase{0};
+};
+
+
+int main(int argc, char **argv) {
+    // Only the file sink set up by the test
+    const char *args[] = {argv[0], "--log_level=none"};
+    AsyncLogTest app;
+    app.run(2, args);
+    return 0;
+}
@@ -0,0 +1,179 @@
+//
+// Created by yuwenyong.vincent on 2019-03-09.
+//
+
+#include "net4cxx/net4cxx.h"
+
+using namespace net4cxx;
+
+
+static size_t gAllocations = 0;
+static void (*volatile gFree)(void *) = std::free;
+
+void* operator new(size_t size) {
+    ++gAllocations;
+    void *p = std::malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void *p) noexcept {
+    gFree(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    gFree(p);
+}
+
+
+class CompressTest: public Bootstrapper {
+public:
+    using Bootstrapper::Bootstrapper;
+
+    void onRun() override {
+        std::string body;
+        for (int i = 0; body.size() < 16 * 1024; ++i) {
+            body += StrUtil::format("<li class=\"item\">item %d: lorem ipsum dolor sit amet</li>\n", i);
+        }
+
+        checkRoundTrip(body);
+        checkPerMessageDeflate(body);
+        checkMemoryBudget(body);
+
+        const size_t rounds = 2000;
+        benchmark("gzipfile", body, rounds, [](const std::string &chunk) {
+            auto value = std::make_shared<std::stringstream>();
+            GzipFile gzipFile;
+            gzipFile.initWithOutputStream(value, 6);
+            gzipFile.write(chunk);
+            gzipFile.close();
+            return value->str().size();
+        });
+        benchmark("compressobj", body, rounds, [](const std::string &chunk) {
+            CompressObj compressObj(6, Zlib::deflated, 16 + Zlib::maxWBits);
+            auto data = compressObj.compressToString(chunk);
+            data += compressObj.flushToString();
+            return data.size();
+        });
+        size_t created = CompressorPool::getCreatedCount();
+        benchmark("pooled compressor", body, rounds, [](const std::string &chunk) {
+            auto compressor = CompressorPool::acquireCompressor(6, 16 + Zlib::maxWBits);
+            std::string data;
+            data.reserve(compressor->bound(chunk.size()));
+            compressor->compress(chunk, data, Zlib::zFinish);
+            return data.size();
+        });
+        std::cout << "contexts created by pool: " << CompressorPool::getCreatedCount() - created << std::endl;
+
+        auto compressed = Zlib::compressToString(body);
+        benchmark("decompressobj", compressed, rounds, [](const std::string &chunk) {
+            DecompressObj decompressObj;
+            auto data = decompressObj.decompressToString(chunk);
+            data += decompressObj.flushToString();
+            return data.size();
+        });
+        created = CompressorPool::getCreatedCount();
+        benchmark("pooled decompressor", compressed, rounds, [](const std::string &chunk) {
+            auto decompressor = CompressorPool::acquireDecompressor();
+            std::string data;
+            decompressor->decompress(chunk, data);
+            return data.size();
+        });
+        std::cout << "contexts created by pool: " << CompressorPool::getCreatedCount() - created << std::endl;
+    }
+
+    void checkRoundTrip(const std::string &body) {
+        auto compressor = CompressorPool::acquireCompressor(6, 16 + Zlib::maxWBits);
+        std::string gzipped;
+        for (size_t pos = 0; pos < body.size(); pos += 1000) {
+            compressor->compress(body.substr(pos, 1000), gzipped, Zlib::zSyncFlush);
+        }
+        compressor->flush(gzipped);
+        GzipDecompressor decompressor;
+        std::string data = decompressor.decompressToString(gzipped, 4096);
+        while (!decompressor.getUnconsumedTail().empty()) {
+            data += decompressor.decompressToString(decompressor.getUnconsumedTail(), 4096);
+        }
+        data += decompressor.flushToString();
+        std::cout << "gzip round trip: " << (data == body ? "OK" : "FAILED") << std::endl;
+        std::cout << "zlib round trip: " << (Zlib::decompressToString(Zlib::compressToString(body)) == body ?
+                                             "OK" : "FAILED") << std::endl;
+    }
+
+    void checkPerMessageDeflate(const std::string &body) {
+        PerMessageDeflate server(true, true, true, 0, 0, boost::none, boost::none);
+        PerMessageDeflate client(false, true, true, 0, 0, boost::none, boost::none);
+        bool ok = true;
+        for (int i = 0; i != 3; ++i) {
+            server.startCompressMessage();
+            auto frame = server.compressMessageData((const Byte *)body.data(), body.size());
+            auto tail = server.endCompressMessage();
+            frame.insert(frame.end(), tail.begin(), tail.end());
+            client.startDecompressMessage();
+            auto message = client.decompressMessageData(frame.data(), frame.size());
+            client.endDecompressMessage();
+            ok = ok && std::string(message.begin(), message.end()) == body;
+        }
+        std::cout << "permessage-deflate round trip: " << (ok ? "OK" : "FAILED") << std::endl;
+        // Without context takeover the sessions only borrow their contexts for the message
+        bool borrowed = CompressorPool::getMemoryUsage() == CompressorPool::getIdleMemory();
+        std::cout << "permessage-deflate holds no context between messages: " << (borrowed ? "OK" : "FAILED")
+                  << std::endl;
+    }
+
+    void checkMemoryBudget(const std::string &body) {
+        CompressorPool::clear();
+        size_t contextSize = CompressorPool::getCompressorMemory(Zlib::maxWBits, Zlib::defMemLevel);
+        CompressorPool::setMemoryBudget(contextSize);
+        size_t rejected = CompressorPool::getStats().rejected;
+        auto first = CompressorPool::tryAcquireCompressor(6);
+        auto second = CompressorPool::tryAcquireCompressor(1);
+        bool ok = first && !second && CompressorPool::getStats().rejected == rejected + 1 &&
+                  CompressorPool::getMemoryUsage() == contextSize;
+        // The idle context is dropped to make room for one with other parameters
+        first.reset();
+        ok = ok && CompressorPool::getIdleMemory() == contextSize;
+        second = CompressorPool::tryAcquireCompressor(1);
+        ok = ok && second && CompressorPool::getMemoryUsage() == contextSize && CompressorPool::getIdleCount() == 0;
+        std::cout << "compressor memory budget: " << (ok ? "OK" : "FAILED") << std::endl;
+
+        // A session with no room for a context sends its message uncompressed
+        PerMessageDeflate server(true, true, true, 0, 0, boost::none, boost::none);
+        ok = !PerMessageDeflate::isMemoryAvailable() && !server.startCompressMessage();
+        second.reset();
+        ok = ok && server.startCompressMessage();
+        auto frame = server.compressMessageData((const Byte *)body.data(), body.size());
+        auto tail = server.endCompressMessage();
+        ok = ok && frame.size() + tail.size() > 0 &&
+             CompressorPool::getMemoryUsage() == CompressorPool::getIdleMemory();
+        std::cout << "permessage-deflate budget fallback: " << (ok ? "OK" : "FAILED") << std::endl;
+        CompressorPool::setMemoryBudget(0);
+        CompressorPool::clear();
+        std::cout << "contexts after clear: " << (CompressorPool::getMemoryUsage() == 0 ? "OK" : "FAILED")
+                  << std::endl;
+    }
+
+    template <typename CallbackT>
+    void benchmark(const char *name, const std::string &input, size_t rounds, CallbackT &&callback) {
+        size_t outputSize = 0;
+        size_t allocations = gAllocations;
+        auto start = TimestampClock::now();
+        for (size_t i = 0; i != rounds; ++i) {
+            outputSize += callback(input);
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(TimestampClock::now() - start);
+        allocations = gAllocations - allocations;
+        std::cout << name << ": " << (double)(input.size() * rounds) / (double)elapsed.count() << "MB/s, "
+                  << (double)allocations / (double)rounds << " allocs/op, output " << outputSize / rounds
+                  << " bytes" << std::endl;
+    }
+};
+
+
+int main(int argc, char **argv) {
+    CompressTest app{false};
+    app.run(argc, argv);
+    return 0;
+}
@@ -0,0 +1,89 @@
+//
+// Created by yuwenyong.vincent on 2019-03-18.
+//
+
+#include "net4cxx/net4cxx.h"
+
+using namespace net4cxx;
+
+
+class Slow: public RequestHandler {
+public:
+    using RequestHandler::RequestHandler;
+
+    DeferredPtr onGet(const StringVector &args) override {
+        double delay = std::stod(getArgument("delay", "0.2"));
+        return sleepAsync(getConnection()->reactor(), delay)->addCallback([this, self=shared_from_this()](
+                DeferredValue value) {
+            write("done\n");
+            return value;
+        });
+    }
+};
+
+
+class Stats: public RequestHandler {
+public:
+    using RequestHandler::RequestHandler;
+
+    void initialize(const boost::any &args) override {
+        _limiters = boost::any_cast<const std::map<std::string, ConcurrencyLimiterPtr>&>(args);
+    }
+
+    DeferredPtr onGet(const StringVector &args) override {
+        JsonValue response;
+        for (auto &kv: _limiters) {
+            auto &limiter = kv.second;
+            JsonValue item;
+            item["limit"] = (uint64_t)limiter->getLimit();
+            item["inFlight"] = (uint64_t)limiter->getInFlight();
+            item["queued"] = (uint64_t)limiter->getQueueSize();
+            item["admitted"] = limiter->getAdmittedCount();
+            item["rejected"] = limiter->getRejectedCount();
+            item["timedOut"] = limiter->getTimeoutCount();
+            response[kv.first] = item;
+        }
+        write(response);
+        return nullptr;
+    }
+protected:
+    std::map<std::string, ConcurrencyLimiterPtr> _limiters;
+};
+
+
+class ConcurrencyLimitTest: public Bootstrapper {
+public:
+    using Bootstrapper::Bootstrapper;
+
+    void onRun() override {
+        // Two slow requests at a time, two more may wait up to half a second
+        auto slowLimiter = std::make_shared<ConcurrencyLimiter>(2, 2, 0.5);
+        slowLimiter->setRetryAfter(2);
+        auto adaptiveLimiter = std::make_shared<ConcurrencyLimiter>(20, 100, 2.0);
+        adaptiveLimiter->setAdaptive(ConcurrencyLimiter::AIMD, 2, 200);
+        adaptiveLimiter->setLatencyThreshold(0.1);
+        auto globalLimiter = std::make_shared<ConcurrencyLimiter>(64, 64, 1.0);
+        auto slow = url<Slow>(R"(/slow)");
+        slow->setLimiter(slowLimiter);
+        auto adaptive = url<Slow>(R"(/adaptive)");
+        adaptive->setLimiter(adaptiveLimiter);
+        auto webApp = makeWebApp<WebApp>({
+                                                 slow,
+                                                 adaptive,
+                                                 url<Stats>(R"(/stats)", std::map<std::string, ConcurrencyLimiterPtr>{
+                                                         {"slow", slowLimiter},
+                                                         {"adaptive", adaptiveLimiter},
+                                                         {"global", globalLimiter},
+                                                 }),
+                                         });
+        webApp->setConcurrencyLimiter(globalLimiter);
+        reactor()->listenTCP("8080", std::move(webApp));
+    }
+};
+
+
+int main(int argc, char **argv) {
+    ConcurrencyLimitTest app;
+    app.run(argc, argv);
+    return 0;
+}
@@ -0,0 +1,82 @@
+//
+// Created by yuwenyong.vincent on 2019-03-16.
+//
+
+#include "net4cxx/net4cxx.h"
+
+using namespace net4cxx;
+
+
+class Scoreboard: public EventSourceHandler {
+public:
+    using EventSourceHandler::EventSourceHandler;
+
+    void open(const StringVector &args) override {
+        if (getQueryArgument("coalesce", "0") == "1") {
+            setSlowConsumerPolicy(COALESCE_EVENTS);
+            setMaxPendingBytes(4096);
+        }
+        subscribe("scores");
+        ServerSentEvent hello("connected");
+        hello.setRetry(3000);
+        sendEvent(hello);
+    }
+
+    void onClose() override {
+        NET4CXX_LOG_INFO("Scoreboard client %s gone", _request->getRemoteIp());
+    }
+};
+
+
+class Publish: public RequestHandler {
+public:
+    using RequestHandler::RequestHandler;
+
+    DeferredPtr onPost(const StringVector &args) override {
+        EventSourceHub::publishAll("scores", ServerSentEvent(_request->getBody(), getArgument("event", "")));
+        return nullptr;
+    }
+};
+
+
+class Stats: public RequestHandler {
+public:
+    using RequestHandler::RequestHandler;
+
+    DeferredPtr onGet(const StringVector &args) override {
+        JsonValue response;
+        response["subscribers"] = (uint64_t)EventSourceHub::local()->getSubscriberCount("scores");
+        write(response);
+        return nullptr;
+    }
+};
+
+
+class EventSourceTest: public Bootstrapper {
+public:
+    using Bootstrapper::Bootstrapper;
+
+    void onRun() override {
+        auto webApp = makeWebApp<WebApp>({
+                                                 url<Scoreboard>(R"(/events)"),
+                                                 url<Publish>(R"(/publish)"),
+                                                 url<Stats>(R"(/stats)"),
+                                         });
+        reactor()->listenTCP("8080", std::move(webApp));
+        PeriodicCallback::create([this]() {
+            ++_round;
+            EventSourceHub::local()->publish("scores", ServerSentEvent(
+                    StrUtil::format("{\"round\": %d,\n\"home\": %d, \"away\": %d}", _round, _round % 7, _round % 5),
+                    "score"));
+        }, 1.0f)->start();
+    }
+protected:
+    int _round{0};
+};
+
+
+int main(int argc, char **argv) {
+    EventSourceTest app;
+    app.run(argc, argv);
+    return 0;
+}
@@ -0,0 +1,70 @@
+//
+// Created by yuwenyong.vincent on 2019-03-19.
+//
+
+#include "net4cxx/net4cxx.h"
+
+using namespace net4cxx;
+
+
+class Books: public RequestHandler {
+public:
+    using RequestHandler::RequestHandler;
+
+    DeferredPtr onGet(const StringVector &args) override {
+        JsonValue response;
+        response["books"] = JsonType::arrayValue;
+        write(response);
+        return nullptr;
+    }
+
+    DeferredPtr onPost(const StringVector &args) override {
+        write(StrUtil::format("received %d bytes\n", _request->getBody().size()));
+        return nullptr;
+    }
+};
+
+
+class Slow: public RequestHandler {
+public:
+    using RequestHandler::RequestHandler;
+
+    DeferredPtr onGet(const StringVector &args) override {
+        double delay = std::stod(getArgument("delay", "0.05"));
+        return sleepAsync(getConnection()->reactor(), delay)->addCallback([this, self=shared_from_this()](
+                DeferredValue value) {
+            if (getArgument("fail", "0") == "1") {
+                sendError(500);
+            } else {
+                write(std::string(256 * 1024, 'x'));
+            }
+            return value;
+        });
+    }
+};
+
+
+class MetricsTest: public Bootstrapper {
+public:
+    using Bootstrapper::Bootstrapper;
+
+    void onRun() override {
+        auto slow = url<Slow>(R"(/slow)", boost::any{}, "slow");
+        slow->setLimiter(std::make_shared<ConcurrencyLimiter>(4, 16, 1.0));
+        auto webApp = makeWebApp<WebApp>({
+                                                 url<Books>(R"(/books/)", boost::any{}, "books"),
+                                                 slow,
+                                                 url<MetricsHandler>(R"(/metrics)"),
+                                         });
+        webApp->setMetricsEnabled(true);
+        webApp->setConcurrencyLimiter(std::make_shared<ConcurrencyLimiter>(64));
+        reactor()->listenTCP("8080", std::move(webApp));
+    }
+};
+
+
+int main(int argc, char **argv) {
+    MetricsTest app(4, false);
+    app.run(argc, argv);
+    return 0;
+}
@@ -0,0 +1,119 @@
+//
+// Created by yuwenyong.vincent on 2019-03-17.
+//
+
+#include "net4cxx/net4cxx.h"
+
+using namespace net4cxx;
+
+
+class BackendArgs {
+public:
+    explicit BackendArgs(std::string name): _name(std::move(name)) {}
+
+    const std::string& getName() const {
+        return _name;
+    }
+protected:
+    std::string _name;
+};
+
+
+class Backend: public RequestHandler {
+public:
+    using RequestHandler::RequestHandler;
+
+    void initialize(const boost::any &args) override {
+        _name = boost::any_cast<const BackendArgs&>(args).getName();
+    }
+
+    DeferredPtr onGet(const StringVector &args) override {
+        if (args[0] == "stream") {
+            // Large enough to exercise the backpressure between the two connections
+            std::string block(64 * 1024, 'x');
+            for (int i = 0; i != 64; ++i) {
+                write(block);
+                flush();
+            }
+            return nullptr;
+        }
+        write(StrUtil::format("%s %s %s forwarded-for=%s\n", _name, _request->getMethod(), _request->getURI(),
+                              _request->getHTTPHeaders()->get("X-Forwarded-For")));
+        return nullptr;
+    }
+
+    DeferredPtr onPost(const StringVector &args) override {
+        write(StrUtil::format("%s received %d bytes\n", _name, _request->getBody().size()));
+        return nullptr;
+    }
+protected:
+    std::string _name;
+};
+
+
+class Stats: public RequestHandler {
+public:
+    using RequestHandler::RequestHandler;
+
+    void initialize(const boost::any &args) override {
+        _pools = boost::any_cast<const std::vector<UpstreamPoolPtr>&>(args);
+    }
+
+    DeferredPtr onGet(const StringVector &args) override {
+        JsonValue response(JsonType::arrayValue);
+        auto now = TimestampClock::now();
+        for (auto &pool: _pools) {
+            JsonValue item;
+            item["idle"] = (uint64_t)pool->getIdleCount();
+            for (auto &upstream: pool->getUpstreams()) {
+                JsonValue state;
+                state["outstanding"] = (uint64_t)upstream->getOutstanding();
+                state["ejected"] = upstream->isEjected(now);
+                item[StrUtil::format("%s:%u", upstream->getHost(), upstream->getPort())] = state;
+            }
+            response.append(item);
+        }
+        write(response);
+        return nullptr;
+    }
+protected:
+    std::vector<UpstreamPoolPtr> _pools;
+};
+
+
+class ProxyTest: public Bootstrapper {
+public:
+    using Bootstrapper::Bootstrapper;
+
+    void onRun() override {
+        for (int i = 1; i <= 2; ++i) {
+            auto backend = makeWebApp<WebApp>({
+                                                      url<Backend>(R"(/\w+/(\w+).*)", BackendArgs(
+                                                              StrUtil::format("backend%d", i))),
+                                              });
+            reactor()->listenTCP(std::to_string(8080 + i), std::move(backend));
+        }
+        // Nothing listens on 8083, so it gets ejected after a few failed connects
+        StringVector addresses{"127.0.0.1:8081", "127.0.0.1:8082", "127.0.0.1:8083"};
+        auto roundRobin = std::make_shared<UpstreamPool>(addresses, UpstreamPool::ROUND_ROBIN);
+        auto leastOutstanding = std::make_shared<UpstreamPool>(addresses, UpstreamPool::LEAST_OUTSTANDING);
+        auto consistentHash = std::make_shared<UpstreamPool>(addresses, UpstreamPool::CONSISTENT_HASH);
+        ProxyHandlerArgs hashArgs(consistentHash);
+        hashArgs.setHashHeader("X-User");
+        auto webApp = makeWebApp<WebApp>({
+                                                 url<ProxyHandler>(R"(/rr/.*)", ProxyHandlerArgs(roundRobin)),
+                                                 url<ProxyHandler>(R"(/lo/.*)", ProxyHandlerArgs(leastOutstanding)),
+                                                 url<ProxyHandler>(R"(/hash/.*)", hashArgs),
+                                                 url<Stats>(R"(/stats)", std::vector<UpstreamPoolPtr>{
+                                                         roundRobin, leastOutstanding, consistentHash}),
+                                         });
+        reactor()->listenTCP("8080", std::move(webApp));
+    }
+};
+
+
+int main(int argc, char **argv) {
+    ProxyTest app;
+    app.run(argc, argv);
+    return 0;
+}
@@ -0,0 +1,93 @@
+//
+// Created by yuwenyong.vincent on 2019-03-30.
+//
+
+#include "net4cxx/net4cxx.h"
+
+using namespace net4cxx;
+
+
+static std::atomic<size_t> gAllocations{0};
+static void (*volatile gFree)(void *) = std::free;
+
+void* operator new(size_t size) {
+    ++gAllocations;
+    void *p = std::malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void *p) noexcept {
+    gFree(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    gFree(p);
+}
+
+
+static size_t gRequests = 0;
+static size_t gLastAllocations = 0;
+
+
+class Hello: public RequestHandler {
+public:
+    using RequestHandler::RequestHandler;
+
+    DeferredPtr onGet(const StringVector &args) override {
+        ++gRequests;
+        setHeader("Content-Type", "text/plain");
+        write("Hello, " + getArgument("name", "world") + "\n");
+        return nullptr;
+    }
+};
+
+
+// Reports the allocations made per request since the previous call, drive the server with keep-alive requests
+// first, e.g. curl -s "http://127.0.0.1:8080/hello?name=[1-1000]" > /dev/null
+class Stats: public RequestHandler {
+public:
+    using RequestHandler::RequestHandler;
+
+    DeferredPtr onGet(const StringVector &args) override {
+        size_t allocations = gAllocations - gLastAllocations;
+        JsonValue response;
+        response["requests"] = (uint64_t)gRequests;
+        response["allocations"] = (uint64_t)allocations;
+        response["allocsPerRequest"] = gRequests ? (double)allocations / (double)gRequests : 0.0;
+        write(response);
+        gRequests = 0;
+        gLastAllocations = gAllocations;
+        return nullptr;
+    }
+};
+
+
+class RequestArenaTest: public Bootstrapper {
+public:
+    using Bootstrapper::Bootstrapper;
+
+    void onRun() override {
+        auto webApp = makeWebApp<WebApp>({
+                                                 url<Hello>(R"(/hello)"),
+                                                 url<Stats>(R"(/stats)"),
+                                         });
+        reactor()->listenTCP("8080", std::move(webApp));
+
+        webApp = makeWebApp<WebApp>({
+                                            url<Hello>(R"(/hello)"),
+                                            url<Stats>(R"(/stats)"),
+                                    });
+        webApp->setRequestArenaSize(0);
+        reactor()->listenTCP("8081", std::move(webApp));
+    }
+};
+
+
+int main(int argc, char **argv) {
+    RequestArenaTest app;
+    app.run(argc, argv);
+    return 0;
+}
@@ -0,0 +1,104 @@
+//
+// Created by yuwenyong.vincent on 2019-03-02.
+//
+
+#include "net4cxx/net4cxx.h"
+
+using namespace net4cxx;
+
+
+class Dummy: public RequestHandler {
+public:
+    using RequestHandler::RequestHandler;
+};
+
+
+class RoutingTest: public Bootstrapper {
+public:
+    using Bootstrapper::Bootstrapper;
+
+    void onRun() override {
+        WebApp::HandlersType handlers;
+        for (int i = 0; i != 100; ++i) {
+            handlers.emplace_back(url<Dummy>(StrUtil::format("/api/v1/resource%d/", i)));
+            handlers.emplace_back(url<Dummy>(StrUtil::format(R"(/api/v1/resource%d/(\d+))", i)));
+            handlers.emplace_back(url<Dummy>(StrUtil::format("/api/v1/resource%d/([^/]+)/items/([^/]+)", i)));
+        }
+        handlers.emplace_back(url<Dummy>(R"(/static/(.*))"));
+        handlers.emplace_back(url<Dummy>(R"(/api/v1/resource50/([a-z]+)-(\d+))"));
+
+        StringVector paths = {
+                "/api/v1/resource0/",
+                "/api/v1/resource99/",
+                "/api/v1/resource42/12345",
+                "/api/v1/resource77/abc/items/def",
+                "/api/v1/resource50/abc-12",
+                "/static/js/app.js",
+                "/not/found",
+        };
+
+        UrlRouter router(handlers);
+        std::cout << "tree routes: " << router.getTreeRouteCount() << ", regex routes: "
+                  << router.getRegexRouteCount() << std::endl;
+
+        for (auto &path: paths) {
+            StringVector expectedArgs, args;
+            UrlSpecPtr expected;
+            boost::smatch match;
+            for (auto &spec: handlers) {
+                if (boost::regex_match(path, match, spec->getRegex())) {
+                    expected = spec;
+                    for (size_t i = 1; i < match.size(); ++i) {
+                        expectedArgs.emplace_back(match[i].str());
+                    }
+                    break;
+                }
+            }
+            auto matched = router.match(path, args);
+            if (matched != expected || args != expectedArgs) {
+                std::cerr << "Mismatch for " << path << std::endl;
+            } else {
+                std::cout << path << " -> " << (matched ? matched->getPattern() : "None") << std::endl;
+            }
+        }
+
+        const size_t rounds = 20000;
+        size_t found = 0;
+        auto start = TimestampClock::now();
+        for (size_t i = 0; i != rounds; ++i) {
+            for (auto &path: paths) {
+                boost::smatch match;
+                for (auto &spec: handlers) {
+                    if (boost::regex_match(path, match, spec->getRegex())) {
+                        ++found;
+                        break;
+                    }
+                }
+            }
+        }
+        auto regexElapsed = std::chrono::duration_cast<std::chrono::microseconds>(TimestampClock::now() - start);
+
+        start = TimestampClock::now();
+        for (size_t i = 0; i != rounds; ++i) {
+            for (auto &path: paths) {
+                StringVector args;
+                if (router.match(path, args)) {
+                    ++found;
+                }
+            }
+        }
+        auto routerElapsed = std::chrono::duration_cast<std::chrono::microseconds>(TimestampClock::now() - start);
+
+        double lookups = (double)(rounds * paths.size());
+        std::cout << "regex: " << (double)regexElapsed.count() * 1000.0 / lookups << "ns/lookup" << std::endl;
+        std::cout << "router: " << (double)routerElapsed.count() * 1000.0 / lookups << "ns/lookup" << std::endl;
+        std::cout << "found: " << found << std::endl;
+    }
+};
+
+
+int main(int argc, char **argv) {
+    RoutingTest app{false};
+    app.run(argc, argv);
+    return 0;
+}
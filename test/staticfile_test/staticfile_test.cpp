@@ -0,0 +1,30 @@
+//
+// Created by yuwenyong.vincent on 2019-02-16.
+//
+
+#include "net4cxx/net4cxx.h"
+
+using namespace net4cxx;
+
+
+class StaticFileTest: public Bootstrapper {
+public:
+    using Bootstrapper::Bootstrapper;
+
+    void onRun() override {
+        StaticFileHandlerArgs args(".", "index.html");
+        args.setPrecompressed(true);
+        args.setMaxAge(3600);
+        auto webApp = makeWebApp<WebApp>({
+                                                 url<StaticFileHandler>(R"(/static/(.*))", args)
+                                         });
+        reactor()->listenTCP("8080", std::move(webApp));
+    }
+};
+
+
+int main(int argc, char **argv) {
+    StaticFileTest app;
+    app.run(argc, argv);
+    return 0;
+}
@@ -0,0 +1,90 @@
+//
+// Created by yuwenyong.vincent on 2019-03-16.
+//
+
+#include "net4cxx/net4cxx.h"
+#include <boost/filesystem.hpp>
+
+using namespace net4cxx;
+
+
+class Upload: public RequestHandler {
+public:
+    using RequestHandler::RequestHandler;
+
+    void initialize(const boost::any &args) override {
+        _streaming = boost::any_cast<bool>(args);
+    }
+
+    bool hasStreamRequestBody() const override {
+        return _streaming;
+    }
+
+    DeferredPtr prepare() override {
+        if (!_streaming) {
+            return nullptr;
+        }
+        getConnection()->setMaxBodySize(1024 * 1024 * 1024);
+        std::string boundary = MultipartParser::getBoundary(_request->getHTTPHeaders()->get("Content-Type"));
+        _parser = std::make_unique<MultipartParser>(boundary, _request->bodyArguments(), _request->files(),
+                                                    boost::filesystem::temp_directory_path().string());
+        return sleepAsync(getConnection()->reactor(), 0.1);
+    }
+
+    void dataReceived(std::string data) override {
+        _parser->feed(data);
+        _received += data.size();
+        pauseReading();
+        sleepAsync(getConnection()->reactor(), 0.001)->addCallback([this, self=shared_from_this()](DeferredValue value) {
+            resumeReading();
+            return value;
+        });
+    }
+
+    DeferredPtr onPost(const StringVector &args) override {
+        if (_parser) {
+            _parser->finish();
+        }
+        JsonValue response;
+        response["streaming"] = _streaming;
+        response["received"] = (uint64_t)_received;
+        for (auto &kv: _request->getBodyArguments()) {
+            response["arguments"][kv.first] = kv.second.front();
+        }
+        for (auto &kv: _request->getFiles()) {
+            auto &file = kv.second.front();
+            JsonValue item;
+            item["filename"] = file.getFileName();
+            item["size"] = (uint64_t)file.getSize();
+            item["spooled"] = (bool)file.getSpooledFile();
+            response["files"][kv.first] = item;
+        }
+        write(response);
+        return nullptr;
+    }
+protected:
+    bool _streaming{false};
+    size_t _received{0};
+    std::unique_ptr<MultipartParser> _parser;
+};
+
+
+class StreamBodyTest: public Bootstrapper {
+public:
+    using Bootstrapper::Bootstrapper;
+
+    void onRun() override {
+        auto webApp = makeWebApp<WebApp>({
+                                                 url<Upload>(R"(/upload)", true),
+                                                 url<Upload>(R"(/buffered)", false),
+                                         });
+        reactor()->listenTCP("8080", std::move(webApp));
+    }
+};
+
+
+int main(int argc, char **argv) {
+    StreamBodyTest app;
+    app.run(argc, argv);
+    return 0;
+}
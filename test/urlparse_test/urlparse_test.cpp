@@ -0,0 +1,117 @@
+//
+// Created by yuwenyong.vincent on 2019-03-23.
+//
+
+#include "net4cxx/net4cxx.h"
+
+using namespace net4cxx;
+
+
+static size_t gAllocations = 0;
+static void (*volatile gFree)(void *) = std::free;
+
+void* operator new(size_t size) {
+    ++gAllocations;
+    void *p = std::malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void *p) noexcept {
+    gFree(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    gFree(p);
+}
+
+
+class UrlParseTest: public Bootstrapper {
+public:
+    using Bootstrapper::Bootstrapper;
+
+    void onRun() override {
+        check("unquote", UrlParse::unquote("abc%20def%2Fg%zz%4"), "abc def/g%zz%4");
+        check("unquote lower", UrlParse::unquote("%e4%bd%a0%E5%A5%BD"), "\xe4\xbd\xa0\xe5\xa5\xbd");
+        check("unquotePlus", UrlParse::unquotePlus("a+b%2Bc%"), "a b+c%");
+        check("quote", UrlParse::quote("/path with spaces/~x?"), "/path%20with%20spaces/%7Ex%3F");
+        check("quote safe", UrlParse::quote("a:b/c", ":"), "a:b%2Fc");
+        check("quote binary", UrlParse::quote(std::string("\x00\xff", 2)), "%00%FF");
+        check("quotePlus", UrlParse::quotePlus("a b&c=d"), "a+b%26c%3Dd");
+        check("urlEncode", UrlParse::urlEncode(QueryArgList{{"a b", "1"}, {"c", "x&y"}}), "a+b=1&c=x%26y");
+
+        auto args = UrlParse::parseQSL("a=1&b=&c&d=x+y%21;e=%zz&&a=2", true);
+        check("parseQSL", toString(args), "a=1,b=,c=,d=x y!,e=%zz,a=2,");
+        args = UrlParse::parseQSL("a=1&b=&c&d=x+y%21");
+        check("parseQSL drop blank", toString(args), "a=1,d=x y!,");
+        auto dict = UrlParse::parseQS("a=1&b=2&a=3");
+        check("parseQS", dict["a"].size() == 2 && dict["a"][1] == "3" && dict["b"][0] == "2" ? "ok" : "", "ok");
+        bool raised = false;
+        try {
+            UrlParse::parseQSL("a=1&b", false, true);
+        } catch (ValueError &e) {
+            raised = true;
+        }
+        check("strict parsing", raised ? "raised" : "", "raised");
+
+        std::string query;
+        for (int i = 0; i != 20; ++i) {
+            query += StrUtil::format("%sfield_%d=some+value+%%E4%%BD%%A0%d", i ? "&" : "", i, i);
+        }
+        const size_t rounds = 20000;
+        benchmark("parseQS", query, rounds, [](const std::string &s) {
+            return UrlParse::parseQS(s, true).size();
+        });
+        benchmark("query iterator", query, rounds, [](const std::string &s) {
+            size_t count = 0;
+            QueryStringIterator iter(s, true);
+            while (iter.next()) {
+                count += iter.value().size();
+            }
+            return count;
+        });
+        std::string path = "/static/images/some%20file%20name/with%2Fescaped/parts.png";
+        benchmark("unquote", path, rounds * 10, [](const std::string &s) {
+            return UrlParse::unquote(s).size();
+        });
+        benchmark("quote", UrlParse::unquote(path), rounds * 10, [](const std::string &s) {
+            return UrlParse::quote(s).size();
+        });
+    }
+
+    static std::string toString(const QueryArgList &args) {
+        std::string result;
+        for (auto &kv: args) {
+            result += kv.first + "=" + kv.second + ",";
+        }
+        return result;
+    }
+
+    static void check(const char *name, const std::string &result, const std::string &expected) {
+        std::cout << name << ": " << (result == expected ? "OK" : "FAILED (" + result + ")") << std::endl;
+    }
+
+    template <typename CallbackT>
+    void benchmark(const char *name, const std::string &input, size_t rounds, CallbackT &&callback) {
+        size_t outputSize = 0;
+        size_t allocations = gAllocations;
+        auto start = TimestampClock::now();
+        for (size_t i = 0; i != rounds; ++i) {
+            outputSize += callback(input);
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(TimestampClock::now() - start);
+        allocations = gAllocations - allocations;
+        std::cout << name << ": " << (double)(input.size() * rounds) / (double)elapsed.count() << "MB/s, "
+                  << (double)allocations / (double)rounds << " allocs/op" << std::endl;
+        (void)outputSize;
+    }
+};
+
+
+int main(int argc, char **argv) {
+    UrlParseTest app{false};
+    app.run(argc, argv);
+    return 0;
+}
@@ -0,0 +1,150 @@
+//
+// Created by yuwenyong.vincent on 2019-03-20.
+//
+
+#include "net4cxx/net4cxx.h"
+
+using namespace net4cxx;
+
+
+class Utf8ValidatorTest: public Bootstrapper {
+public:
+    using Bootstrapper::Bootstrapper;
+
+    void onRun() override {
+        check("ascii", Utf8Util::validate("plain ascii text"), true);
+        check("multibyte", Utf8Util::validate(std::string("\xce\xba\xe1\xbd\xb9\xf0\x9f\x98\x80")), true);
+        check("overlong", Utf8Util::validate(std::string("\xc0\xaf")), false);
+        check("surrogate", Utf8Util::validate(std::string("\xed\xa0\x80")), false);
+        check("too large", Utf8Util::validate(std::string("\xf4\x90\x80\x80")), false);
+        check("truncated", Utf8Util::validate(std::string(70, 'a') + "\xe2\x82"), false);
+
+        std::vector<Utf8Util::Kernel> kernels{Utf8Util::PORTABLE};
+        if (Utf8Util::bestKernel() >= Utf8Util::SSSE3) {
+            kernels.emplace_back(Utf8Util::SSSE3);
+        }
+        if (Utf8Util::bestKernel() >= Utf8Util::AVX2) {
+            kernels.emplace_back(Utf8Util::AVX2);
+        }
+        bool kernelsAgree = true, fragmentsAgree = true;
+        for (size_t i = 0; i != 20000; ++i) {
+            ByteArray text = generate((size_t)Random::randRange(0, 300), i % 2 == 0);
+            Utf8Validator reference;
+            ValidateResult expected = std::make_tuple(true, true, 0, 0);
+            for (auto b: text) {
+                expected = reference.validate(&b, 1);
+                if (!std::get<0>(expected)) {
+                    break;
+                }
+            }
+            for (auto kernel: kernels) {
+                if (Utf8Util::validate(text.data(), text.size(), kernel) !=
+                    (std::get<0>(expected) && std::get<1>(expected))) {
+                    kernelsAgree = false;
+                }
+            }
+            // The incremental validator must fail at the same octet however the payload is fragmented
+            Utf8Validator validator;
+            ValidateResult result = std::make_tuple(true, true, 0, 0);
+            size_t pos = 0;
+            do {
+                size_t len = std::min((size_t)Random::randRange(0, 160), text.size() - pos);
+                result = validator.validate(text.data() + pos, len);
+                pos += len;
+            } while (std::get<0>(result) && pos < text.size());
+            if (std::get<0>(result) != std::get<0>(expected) || std::get<1>(result) != std::get<1>(expected) ||
+                std::get<3>(result) != std::get<3>(expected)) {
+                fragmentsAgree = false;
+            }
+        }
+        check("fuzz kernels", kernelsAgree, true);
+        check("fuzz fragments", fragmentsAgree, true);
+
+        JsonValue root;
+        std::string errs;
+        CharReaderBuilder builder;
+        std::istringstream invalid("{\"name\": \"\xc3\x28\"}");
+        check("json default", parseFromStream(builder, invalid, &root, &errs), true);
+        CharReaderBuilder::strictMode(&builder.settings());
+        invalid.seekg(0);
+        check("json strict", parseFromStream(builder, invalid, &root, &errs), false);
+        std::istringstream valid("{\"name\": \"\xe4\xbd\xa0\xe5\xa5\xbd\"}");
+        check("json strict valid", parseFromStream(builder, valid, &root, &errs), true);
+
+        std::string json;
+        while (json.size() < 64 * 1024) {
+            json += R"({"id":12345,"name":"some user name","tags":["alpha","beta"],"active":true},)";
+        }
+        std::string cjk;
+        while (cjk.size() < 64 * 1024) {
+            cjk += "\xe4\xbd\xa0\xe5\xa5\xbd\xef\xbc\x8c\xe4\xb8\x96\xe7\x95\x8c abc ";
+        }
+        benchmark("ascii json", json, kernels);
+        benchmark("cjk", cjk, kernels);
+    }
+
+    typedef Utf8Validator::ValidateResult ValidateResult;
+
+    static ByteArray generate(size_t count, bool corrupt) {
+        static const char *samples[] = {"a", "Z", "{", "\xc2\x80", "\xdf\xbf", "\xe0\xa0\x80", "\xed\x9f\xbf",
+                                        "\xef\xbf\xbf", "\xf0\x90\x80\x80", "\xf4\x8f\xbf\xbf"};
+        ByteArray text;
+        for (size_t i = 0; i != count; ++i) {
+            auto sample = samples[Random::randRange((int)(sizeof(samples) / sizeof(samples[0])))];
+            text.insert(text.end(), sample, sample + strlen(sample));
+        }
+        if (corrupt && !text.empty()) {
+            text[(size_t)Random::randRange((int)text.size())] = (Byte)Random::randRange(256);
+            if (Random::randRange(4) == 0) {
+                text.resize((size_t)Random::randRange((int)text.size()));
+            }
+        }
+        return text;
+    }
+
+    static void check(const char *name, bool result, bool expected) {
+        std::cout << name << ": " << (result == expected ? "OK" : "FAILED") << std::endl;
+    }
+
+    static void benchmark(const char *name, const std::string &text, const std::vector<Utf8Util::Kernel> &kernels) {
+        const size_t rounds = 2000;
+        auto data = (const Byte *)text.data();
+        measure(StrUtil::format("%s dfa", name).c_str(), text.size() * rounds / 10, [&]() {
+            for (size_t i = 0; i != rounds / 10; ++i) {
+                Utf8Validator validator;
+                for (size_t j = 0; j != text.size(); ++j) {
+                    validator.decode(data[j]);
+                }
+            }
+        });
+        static const char *kernelNames[] = {"portable", "ssse3", "avx2"};
+        for (auto kernel: kernels) {
+            measure(StrUtil::format("%s %s", name, kernelNames[kernel]).c_str(), text.size() * rounds, [&]() {
+                for (size_t i = 0; i != rounds; ++i) {
+                    Utf8Util::validate(data, text.size(), kernel);
+                }
+            });
+        }
+        measure(StrUtil::format("%s validator", name).c_str(), text.size() * rounds, [&]() {
+            for (size_t i = 0; i != rounds; ++i) {
+                Utf8Validator validator;
+                validator.validate(data, text.size());
+            }
+        });
+    }
+
+    template <typename CallbackT>
+    static void measure(const char *name, size_t bytes, CallbackT &&callback) {
+        auto start = TimestampClock::now();
+        callback();
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(TimestampClock::now() - start);
+        std::cout << name << ": " << (double)bytes / (double)elapsed.count() << "MB/s" << std::endl;
+    }
+};
+
+
+int main(int argc, char **argv) {
+    Utf8ValidatorTest app{false};
+    app.run(argc, argv);
+    return 0;
+}
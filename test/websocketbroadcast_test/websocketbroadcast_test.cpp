@@ -0,0 +1,295 @@
+//
+// Created by yuwenyong.vincent on 2019-03-22.
+//
+
+#include "net4cxx/net4cxx.h"
+
+using namespace net4cxx;
+
+
+class BroadcastTest;
+
+
+class BroadcastTestServerProtocol: public WebSocketServerProtocol {
+public:
+    void onOpen() override;
+};
+
+
+class BroadcastTestServerFactory: public WebSocketServerFactory {
+public:
+    BroadcastTestServerFactory(std::string url, BroadcastTest *test)
+            : WebSocketServerFactory(std::move(url))
+            , _test(test) {
+
+    }
+
+    ProtocolPtr buildProtocol(const Address &address) override {
+        return std::make_shared<BroadcastTestServerProtocol>();
+    }
+
+    BroadcastTest* getTest() {
+        return _test;
+    }
+protected:
+    BroadcastTest *_test;
+};
+
+
+class BroadcastTestClientProtocol: public WebSocketClientProtocol {
+public:
+    void onMessage(ByteArray payload, bool isBinary) override;
+
+    size_t getMessages() const {
+        return _messages;
+    }
+
+    const ByteArray& getLastPayload() const {
+        return _lastPayload;
+    }
+
+    void resetMessages() {
+        _messages = 0;
+        _lastPayload.clear();
+    }
+protected:
+    size_t _messages{0};
+    ByteArray _lastPayload;
+};
+
+
+class BroadcastTestClientFactory: public WebSocketClientFactory {
+public:
+    BroadcastTestClientFactory(std::string url, BroadcastTest *test)
+            : WebSocketClientFactory(std::move(url))
+            , _test(test) {
+
+    }
+
+    ProtocolPtr buildProtocol(const Address &address) override {
+        auto client = std::make_shared<BroadcastTestClientProtocol>();
+        _clients.emplace_back(client);
+        return client;
+    }
+
+    BroadcastTest* getTest() {
+        return _test;
+    }
+
+    const std::vector<std::shared_ptr<BroadcastTestClientProtocol>>& getClients() const {
+        return _clients;
+    }
+protected:
+    BroadcastTest *_test;
+    std::vector<std::shared_ptr<BroadcastTestClientProtocol>> _clients;
+};
+
+
+class BroadcastTest: public Bootstrapper {
+public:
+    using Bootstrapper::Bootstrapper;
+
+    void onRun() override {
+        auto serverFactory = std::make_shared<BroadcastTestServerFactory>("ws://127.0.0.1:9100", this);
+        serverFactory->setPerMessageCompressionAccept([](std::vector<PerMessageCompressOfferPtr> offers) {
+            PerMessageCompressOfferAcceptPtr accept;
+            for (auto &offer: offers) {
+                if (std::dynamic_pointer_cast<PerMessageDeflateOffer>(offer)) {
+                    accept = std::make_shared<PerMessageDeflateOfferAccept>(offer);
+                    break;
+                }
+            }
+            return accept;
+        });
+        listenWS(reactor(), serverFactory);
+
+        _plainClients = std::make_shared<BroadcastTestClientFactory>("ws://127.0.0.1:9100", this);
+        // Asks for server_no_context_takeover, so one compressed frame serves all these clients
+        _deflateClients = std::make_shared<BroadcastTestClientFactory>("ws://127.0.0.1:9100", this);
+        _deflateClients->setPerMessageCompressionOffers({std::make_shared<PerMessageDeflateOffer>(true, true, true)});
+        _deflateClients->setPerMessageCompressionAccept([](PerMessageCompressResponsePtr response) {
+            return std::make_shared<PerMessageDeflateResponseAccept>(std::move(response));
+        });
+        for (size_t i = 0; i != CLIENTS / 2; ++i) {
+            connectWS(reactor(), _plainClients);
+            connectWS(reactor(), _deflateClients);
+        }
+    }
+
+    void onQuit() override {
+        // Connections must go before the reactor owning their sockets
+        _servers.clear();
+        _plainClients.reset();
+        _deflateClients.reset();
+    }
+
+    void onServerOpen(const WebSocketServerProtocolPtr &protocol) {
+        _servers.emplace_back(protocol);
+        if (_servers.size() == CLIENTS) {
+            reactor()->callLater(0.1, [this]() {
+                runSendMessage();
+            });
+        }
+    }
+
+    void onClientMessage() {
+        if (_waiting && ++_received == _expected) {
+            auto callback = std::move(_waiting);
+            _waiting = nullptr;
+            callback();
+        }
+    }
+
+    void runSendMessage() {
+        expect(ROUNDS * CLIENTS, [this]() {
+            report("sendMessage loop", ROUNDS, true);
+            runBroadcast();
+        });
+        auto start = TimestampClock::now();
+        for (size_t i = 0; i != ROUNDS; ++i) {
+            auto payload = makePayload(i, PAYLOAD_SIZE);
+            for (auto &server: _servers) {
+                server->sendMessage(payload);
+            }
+        }
+        _queueTime = TimestampClock::now() - start;
+    }
+
+    void runBroadcast() {
+        for (auto &server: _servers) {
+            _group.add(server);
+        }
+        _group.setMaxPendingBytes(0);
+        expect(ROUNDS * CLIENTS, [this]() {
+            report("group broadcast", ROUNDS, true);
+            runCoalesce();
+        });
+        auto start = TimestampClock::now();
+        for (size_t i = 0; i != ROUNDS; ++i) {
+            auto message = std::make_shared<WebSocketPreparedMessage>(makePayload(i, PAYLOAD_SIZE));
+            _group.broadcast(message);
+            _compressedFrames = std::max(_compressedFrames, message->getCompressedFrameCount());
+        }
+        _queueTime = TimestampClock::now() - start;
+    }
+
+    void runCoalesce() {
+        // Queued within one reactor turn, so once the socket buffers are full the members pass the limit and only
+        // the newest message is kept for them
+        for (size_t i = 0; i != SLOW_MEMBERS; ++i) {
+            _slowGroup.add(_servers[i]);
+        }
+        _slowGroup.setMaxPendingBytes(SLOW_PAYLOAD_SIZE * 4);
+        _slowGroup.setSlowConsumerPolicy(WebSocketBroadcastGroup::COALESCE_MESSAGES);
+        expect(0, nullptr);
+        auto start = TimestampClock::now();
+        size_t written = 0;
+        for (size_t i = 0; i != SLOW_ROUNDS; ++i) {
+            written += _slowGroup.broadcast(makePayload(i, SLOW_PAYLOAD_SIZE));
+        }
+        _queueTime = TimestampClock::now() - start;
+        _expected = written;
+        checkCoalesced(makePayload(SLOW_ROUNDS - 1, SLOW_PAYLOAD_SIZE));
+    }
+
+    void checkCoalesced(std::string last) {
+        size_t done = 0;
+        for (auto &factory: {_plainClients, _deflateClients}) {
+            for (auto &client: factory->getClients()) {
+                if (TypeCast<std::string>(client->getLastPayload()) == last) {
+                    ++done;
+                }
+            }
+        }
+        if (done != SLOW_MEMBERS && TimestampClock::now() - _start < std::chrono::seconds(30)) {
+            reactor()->callLater(0.01, [this, last=std::move(last)]() {
+                checkCoalesced(std::move(last));
+            });
+            return;
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(TimestampClock::now() - _start);
+        auto queued = std::chrono::duration_cast<std::chrono::microseconds>(_queueTime);
+        bool ok = done == SLOW_MEMBERS && _expected < SLOW_MEMBERS * SLOW_ROUNDS;
+        std::cout << "coalesced broadcast: " << (ok ? "OK" : "FAILED") << ", queued in " << queued.count() << "us, "
+                  << "written " << _expected << " of " << SLOW_MEMBERS * SLOW_ROUNDS << ", skipped "
+                  << _slowGroup.getSkippedCount() << ", drained in " << elapsed.count() << "us" << std::endl;
+        std::cout << "compressed frames per message: " << _compressedFrames << std::endl;
+        reactor()->stop();
+    }
+
+    void expect(size_t count, std::function<void ()> callback) {
+        for (auto &factory: {_plainClients, _deflateClients}) {
+            for (auto &client: factory->getClients()) {
+                client->resetMessages();
+            }
+        }
+        _received = 0;
+        _expected = count;
+        _waiting = std::move(callback);
+        _start = TimestampClock::now();
+    }
+
+    void report(const char *name, size_t rounds, bool complete) {
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(TimestampClock::now() - _start);
+        auto queued = std::chrono::duration_cast<std::chrono::microseconds>(_queueTime);
+        auto last = makePayload(ROUNDS - 1, PAYLOAD_SIZE);
+        bool ok = true;
+        for (auto &factory: {_plainClients, _deflateClients}) {
+            for (auto &client: factory->getClients()) {
+                if ((complete && client->getMessages() != rounds) ||
+                    TypeCast<std::string>(client->getLastPayload()) != last) {
+                    ok = false;
+                }
+            }
+        }
+        std::cout << name << ": " << (ok ? "OK" : "FAILED") << ", queued in " << queued.count() << "us, "
+                  << (double)_expected * 1000000.0 / (double)elapsed.count() << " deliveries/s" << std::endl;
+    }
+
+    static std::string makePayload(size_t round, size_t size) {
+        std::string payload = StrUtil::format("{\"round\": %u, \"quotes\": [", round);
+        for (size_t i = 0; payload.size() < size - 32; ++i) {
+            payload += StrUtil::format("{\"symbol\": \"S%u\", \"price\": %u.%02u}, ", i, (round + i) % 997, i % 100);
+        }
+        payload += "{}]}";
+        return payload;
+    }
+
+    static constexpr size_t CLIENTS = 100;
+    static constexpr size_t ROUNDS = 200;
+    static constexpr size_t PAYLOAD_SIZE = 4096;
+    static constexpr size_t SLOW_MEMBERS = 4;
+    static constexpr size_t SLOW_ROUNDS = 400;
+    static constexpr size_t SLOW_PAYLOAD_SIZE = 64 * 1024;
+protected:
+    std::shared_ptr<BroadcastTestClientFactory> _plainClients;
+    std::shared_ptr<BroadcastTestClientFactory> _deflateClients;
+    std::vector<WebSocketServerProtocolPtr> _servers;
+    WebSocketBroadcastGroup _group;
+    WebSocketBroadcastGroup _slowGroup;
+    size_t _compressedFrames{0};
+    size_t _received{0};
+    size_t _expected{0};
+    std::function<void ()> _waiting;
+    Timestamp _start;
+    Duration _queueTime;
+};
+
+
+void BroadcastTestServerProtocol::onOpen() {
+    getFactory<BroadcastTestServerFactory>()->getTest()->onServerOpen(getSelf<BroadcastTestServerProtocol>());
+}
+
+
+void BroadcastTestClientProtocol::onMessage(ByteArray payload, bool isBinary) {
+    ++_messages;
+    _lastPayload = std::move(payload);
+    getFactory<BroadcastTestClientFactory>()->getTest()->onClientMessage();
+}
+
+
+int main(int argc, char **argv) {
+    BroadcastTest app;
+    app.run(argc, argv);
+    return 0;
+}
@@ -0,0 +1,121 @@
+//
+// Created by yuwenyong.vincent on 2019-03-21.
+//
+
+#include "net4cxx/net4cxx.h"
+
+using namespace net4cxx;
+
+
+// Fed straight from memory, as if the frames had arrived on an open connection
+class FrameSink: public WebSocketServerProtocol {
+public:
+    void open() {
+        _state = State::OPEN;
+        _applyMask = true;
+        _utf8validateIncomming = true;
+        _webSocketVersion = 13;
+    }
+
+    void onMessage(ByteArray payload, bool isBinary) override {
+        ++_messages;
+        _bytes += payload.size();
+        _lastPayload = std::move(payload);
+    }
+
+    size_t getMessages() const {
+        return _messages;
+    }
+
+    size_t getBytes() const {
+        return _bytes;
+    }
+
+    const ByteArray& getLastPayload() const {
+        return _lastPayload;
+    }
+protected:
+    size_t _messages{0};
+    size_t _bytes{0};
+    ByteArray _lastPayload;
+};
+
+
+class WebSocketFrameTest: public Bootstrapper {
+public:
+    using Bootstrapper::Bootstrapper;
+
+    void onRun() override {
+        benchmark("100B text", 100, 200000, 1u);
+        benchmark("100B binary", 100, 200000, 2u);
+        benchmark("1MiB binary", 1024 * 1024, 64, 2u);
+        // Fragmented messages and reads cut in the middle of frame headers
+        benchmark("1MiB fragmented", 1024 * 1024, 16, 2u, 1000, 7);
+    }
+
+    static ByteArray makePayload(size_t size, unsigned opcode) {
+        ByteArray payload(size);
+        for (size_t i = 0; i != size; ++i) {
+            payload[i] = (Byte)(opcode == 1u ? 'a' + i % 26 : i * 31);
+        }
+        return payload;
+    }
+
+    static void appendFrame(ByteArray &stream, const Byte *payload, size_t size, unsigned opcode, bool fin) {
+        stream.push_back((Byte)((fin ? 0x80u : 0u) | opcode));
+        if (size < 126) {
+            stream.push_back((Byte)(0x80u | size));
+        } else if (size < 65536) {
+            stream.push_back(0x80u | 126u);
+            stream.push_back((Byte)(size >> 8));
+            stream.push_back((Byte)size);
+        } else {
+            stream.push_back(0x80u | 127u);
+            for (int shift = 56; shift >= 0; shift -= 8) {
+                stream.push_back((Byte)((uint64_t)size >> shift));
+            }
+        }
+        WebSocketMask mask{{0x12, 0x34, 0x56, 0x78}};
+        stream.insert(stream.end(), mask.begin(), mask.end());
+        size_t start = stream.size();
+        stream.insert(stream.end(), payload, payload + size);
+        XorMaskerSimple(mask).process(stream.data() + start, size);
+    }
+
+    static void benchmark(const char *name, size_t size, size_t count, unsigned opcode, size_t fragments=1,
+                          size_t readSize=64 * 1024) {
+        ByteArray payload = makePayload(size, opcode);
+        ByteArray stream;
+        for (size_t i = 0; i != count; ++i) {
+            size_t offset = 0, fragmentSize = (size + fragments - 1) / fragments;
+            for (size_t j = 0; j != fragments; ++j) {
+                size_t len = std::min(fragmentSize, size - offset);
+                appendFrame(stream, payload.data() + offset, len, j == 0 ? opcode : 0u, j + 1 == fragments);
+                offset += len;
+            }
+        }
+        auto sink = std::make_shared<FrameSink>();
+        sink->open();
+        ByteArray readBuffer(readSize);
+        auto start = TimestampClock::now();
+        for (size_t pos = 0; pos < stream.size(); pos += readSize) {
+            // The parser unmasks in place, so every read lands in a scratch buffer like a socket read would
+            size_t len = std::min(readSize, stream.size() - pos);
+            std::memcpy(readBuffer.data(), stream.data() + pos, len);
+            sink->dataReceived(readBuffer.data(), len);
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(TimestampClock::now() - start);
+        bool ok = sink->getMessages() == count && sink->getBytes() == size * count &&
+                  sink->getLastPayload() == payload;
+        std::cout << name << ": " << (ok ? "OK" : "FAILED") << ", "
+                  << (double)stream.size() / (double)elapsed.count() << "MB/s, "
+                  << (double)count * 1000000.0 / (double)elapsed.count() << " msgs/s" << std::endl;
+    }
+};
+
+
+int main(int argc, char **argv) {
+    WebSocketFrameTest app{false};
+    app.run(argc, argv);
+    return 0;
+}
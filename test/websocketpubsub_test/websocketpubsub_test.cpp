@@ -0,0 +1,269 @@
+//
+// Created by yuwenyong.vincent on 2019-03-23.
+//
+
+#include "net4cxx/net4cxx.h"
+
+using namespace net4cxx;
+
+
+class PubSubTest;
+
+
+class PubSubTestServerProtocol: public WebSocketServerProtocol {
+public:
+    void onMessage(ByteArray payload, bool isBinary) override;
+
+    void onClose(bool wasClean, boost::optional<unsigned short> code, boost::optional<std::string> reason) override;
+};
+
+
+class PubSubTestServerFactory: public WebSocketServerFactory {
+public:
+    PubSubTestServerFactory(std::string url, PubSubTest *test)
+            : WebSocketServerFactory(std::move(url))
+            , _test(test) {
+
+    }
+
+    ProtocolPtr buildProtocol(const Address &address) override {
+        return std::make_shared<PubSubTestServerProtocol>();
+    }
+
+    PubSubTest* getTest() {
+        return _test;
+    }
+protected:
+    PubSubTest *_test;
+};
+
+
+class PubSubTestClientProtocol: public WebSocketClientProtocol {
+public:
+    explicit PubSubTestClientProtocol(std::string topics)
+            : _topics(std::move(topics)) {
+
+    }
+
+    void onOpen() override {
+        sendMessage(_topics);
+    }
+
+    void onMessage(ByteArray payload, bool isBinary) override;
+
+    const std::string& getTopics() const {
+        return _topics;
+    }
+
+    bool isOk() const {
+        return _ok;
+    }
+protected:
+    std::string _topics;
+    std::map<std::string, size_t> _next;
+    bool _ok{true};
+};
+
+
+class PubSubTestClientFactory: public WebSocketClientFactory {
+public:
+    PubSubTestClientFactory(std::string url, PubSubTest *test)
+            : WebSocketClientFactory(std::move(url))
+            , _test(test) {
+
+    }
+
+    ProtocolPtr buildProtocol(const Address &address) override {
+        // Every third client also follows the chat
+        auto client = std::make_shared<PubSubTestClientProtocol>(_clients.size() % 3 ? "quotes" : "quotes chat");
+        _clients.emplace_back(client);
+        return client;
+    }
+
+    PubSubTest* getTest() {
+        return _test;
+    }
+
+    const std::vector<std::shared_ptr<PubSubTestClientProtocol>>& getClients() const {
+        return _clients;
+    }
+
+    void reset() {
+        _clients.clear();
+    }
+protected:
+    PubSubTest *_test;
+    std::vector<std::shared_ptr<PubSubTestClientProtocol>> _clients;
+};
+
+
+class PubSubTest: public Bootstrapper {
+public:
+    PubSubTest()
+            : Bootstrapper(SUB_REACTORS) {
+
+    }
+
+    void onRun() override {
+        // Delivers everything, so the received counts can be checked exactly
+        _hub.setMaxPendingBytes(0);
+        listenWS(reactor(), std::make_shared<PubSubTestServerFactory>("ws://127.0.0.1:9103", this));
+        _clients = std::make_shared<PubSubTestClientFactory>("ws://127.0.0.1:9103", this);
+        for (size_t i = 0; i != CLIENTS; ++i) {
+            connectWS(reactor(), _clients);
+        }
+        _start = TimestampClock::now();
+        waitSubscribed();
+    }
+
+    void onQuit() override {
+        // Connections must go before the reactor owning their sockets
+        if (_publisher.joinable()) {
+            _publisher.join();
+        }
+        _clients->reset();
+        _clients.reset();
+    }
+
+    WebSocketPubSubHub& getHub() {
+        return _hub;
+    }
+
+    void onClientMessage() {
+        ++_received;
+    }
+
+    void waitSubscribed() {
+        if (_hub.getSubscriberCount("quotes") != CLIENTS || _hub.getSubscriberCount("chat") != CHAT_CLIENTS) {
+            retry([this]() {
+                waitSubscribed();
+            });
+            return;
+        }
+        std::cout << "subscribed across " << _hub.getShardCount() << " reactors: "
+                  << (_hub.getShardCount() == SUB_REACTORS ? "OK" : "FAILED") << std::endl;
+        _start = TimestampClock::now();
+        _publisher = std::thread([this]() {
+            // Publishes from a thread owning none of the sessions
+            size_t queued = 0;
+            auto start = TimestampClock::now();
+            for (size_t i = 0; i != ROUNDS; ++i) {
+                queued += _hub.publish("quotes", StrUtil::format("quotes %u", i));
+                queued += _hub.publish("chat", StrUtil::format("chat %u", i));
+                queued += _hub.publish("nobody", StrUtil::format("nobody %u", i));
+            }
+            _publishTime = TimestampClock::now() - start;
+            _queued = queued;
+        });
+        waitDelivered();
+    }
+
+    void waitDelivered() {
+        size_t expected = ROUNDS * (CLIENTS + CHAT_CLIENTS);
+        if (_received != expected) {
+            retry([this]() {
+                waitDelivered();
+            });
+            return;
+        }
+        _publisher.join();
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(TimestampClock::now() - _start);
+        auto published = std::chrono::duration_cast<std::chrono::microseconds>(_publishTime);
+        bool ok = true;
+        for (auto &client: _clients->getClients()) {
+            ok = ok && client->isOk();
+        }
+        WebSocketPubSubHub::TopicStats quotes{}, chat{}, nobody{};
+        ok = ok && _hub.getTopicStats("quotes", quotes) && _hub.getTopicStats("chat", chat) &&
+             !_hub.getTopicStats("nobody", nobody);
+        ok = ok && quotes.published == ROUNDS && quotes.delivered == ROUNDS * CLIENTS && quotes.skipped == 0;
+        ok = ok && chat.published == ROUNDS && chat.delivered == ROUNDS * CHAT_CLIENTS && chat.skipped == 0;
+        std::cout << "cross-reactor publish: " << (ok ? "OK" : "FAILED") << ", "
+                  << (double)ROUNDS * 3 * 1000000.0 / (double)published.count() << " publishes/s, "
+                  << (double)expected * 1000000.0 / (double)elapsed.count() << " deliveries/s, "
+                  << (double)_queued / (double)(ROUNDS * 3) << " reactors per publish" << std::endl;
+
+        // The chat followers leave, their sessions unsubscribe from onClose
+        for (auto &client: _clients->getClients()) {
+            if (client->getTopics() != "quotes") {
+                client->sendClose();
+            }
+        }
+        _start = TimestampClock::now();
+        waitUnsubscribed();
+    }
+
+    void waitUnsubscribed() {
+        bool done = _hub.getSubscriberCount("chat") == 0 && _hub.getSubscriberCount("quotes") == CLIENTS - CHAT_CLIENTS;
+        if (!done && TimestampClock::now() - _start < std::chrono::seconds(10)) {
+            retry([this]() {
+                waitUnsubscribed();
+            });
+            return;
+        }
+        bool ok = done && _hub.getTopicCount() == 1 && _hub.publish("chat", "gone") == 0 &&
+                  _hub.publish("quotes", "done") != 0;
+        std::cout << "unsubscribe on close: " << (ok ? "OK" : "FAILED") << std::endl;
+        reactor()->stop();
+    }
+
+    template <typename CallbackT>
+    void retry(CallbackT &&callback) {
+        if (TimestampClock::now() - _start > std::chrono::seconds(60)) {
+            std::cout << "timed out: FAILED" << std::endl;
+            reactor()->stop();
+            return;
+        }
+        reactor()->callLater(0.01, std::forward<CallbackT>(callback));
+    }
+
+    static constexpr size_t SUB_REACTORS = 2;
+    static constexpr size_t CLIENTS = 40;
+    static constexpr size_t CHAT_CLIENTS = (CLIENTS + 2) / 3;
+    static constexpr size_t ROUNDS = 10000;
+protected:
+    WebSocketPubSubHub _hub;
+    std::shared_ptr<PubSubTestClientFactory> _clients;
+    std::thread _publisher;
+    size_t _received{0};
+    size_t _queued{0};
+    Duration _publishTime;
+    Timestamp _start;
+};
+
+
+void PubSubTestServerProtocol::onMessage(ByteArray payload, bool isBinary) {
+    auto &hub = getFactory<PubSubTestServerFactory>()->getTest()->getHub();
+    StringVector topics;
+    std::string request = TypeCast<std::string>(payload);
+    boost::split(topics, request, boost::is_any_of(" "));
+    for (auto &topic: topics) {
+        hub.subscribe(topic, shared_from_this());
+    }
+}
+
+void PubSubTestServerProtocol::onClose(bool wasClean, boost::optional<unsigned short> code,
+                                       boost::optional<std::string> reason) {
+    getFactory<PubSubTestServerFactory>()->getTest()->getHub().unsubscribeAll(this);
+}
+
+
+void PubSubTestClientProtocol::onMessage(ByteArray payload, bool isBinary) {
+    // Each topic arrives in publishing order
+    StringVector parts;
+    std::string message = TypeCast<std::string>(payload);
+    boost::split(parts, message, boost::is_any_of(" "));
+    if (parts.size() == 2) {
+        auto &next = _next[parts[0]];
+        _ok = _ok && std::to_string(next) == parts[1];
+        ++next;
+    }
+    getFactory<PubSubTestClientFactory>()->getTest()->onClientMessage();
+}
+
+
+int main(int argc, char **argv) {
+    PubSubTest app;
+    app.run(argc, argv);
+    return 0;
+}
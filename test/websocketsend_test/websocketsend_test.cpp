@@ -0,0 +1,229 @@
+//
+// Created by yuwenyong.vincent on 2019-03-23.
+//
+
+#include "net4cxx/net4cxx.h"
+
+using namespace net4cxx;
+
+
+static size_t gAllocations = 0;
+static void (*volatile gFree)(void *) = std::free;
+
+void* operator new(size_t size) {
+    ++gAllocations;
+    void *p = std::malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void *p) noexcept {
+    gFree(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    gFree(p);
+}
+
+
+class SendTest;
+
+
+class SendTestServerProtocol: public WebSocketServerProtocol {
+public:
+    void onOpen() override;
+
+    void onMessage(ByteArray payload, bool isBinary) override;
+};
+
+
+class SendTestServerFactory: public WebSocketServerFactory {
+public:
+    SendTestServerFactory(std::string url, SendTest *test)
+            : WebSocketServerFactory(std::move(url))
+            , _test(test) {
+
+    }
+
+    ProtocolPtr buildProtocol(const Address &address) override {
+        return std::make_shared<SendTestServerProtocol>();
+    }
+
+    SendTest* getTest() {
+        return _test;
+    }
+protected:
+    SendTest *_test;
+};
+
+
+class SendTestClientProtocol: public WebSocketClientProtocol {
+public:
+    void onOpen() override;
+
+    void onMessage(ByteArray payload, bool isBinary) override;
+};
+
+
+class SendTestClientFactory: public WebSocketClientFactory {
+public:
+    SendTestClientFactory(std::string url, SendTest *test)
+            : WebSocketClientFactory(std::move(url))
+            , _test(test) {
+
+    }
+
+    ProtocolPtr buildProtocol(const Address &address) override {
+        return std::make_shared<SendTestClientProtocol>();
+    }
+
+    SendTest* getTest() {
+        return _test;
+    }
+protected:
+    SendTest *_test;
+};
+
+
+class SendTest: public Bootstrapper {
+public:
+    using Bootstrapper::Bootstrapper;
+
+    void onRun() override {
+        listenWS(reactor(), std::make_shared<SendTestServerFactory>("ws://127.0.0.1:9102", this));
+        _clientFactory = std::make_shared<SendTestClientFactory>("ws://127.0.0.1:9102", this);
+        connectWS(reactor(), _clientFactory);
+    }
+
+    void onQuit() override {
+        // Connections must go before the reactor owning their sockets
+        _server.reset();
+        _client.reset();
+        _clientFactory.reset();
+    }
+
+    void onServerOpen(const WebSocketProtocolPtr &protocol) {
+        _server = protocol;
+        start();
+    }
+
+    void onClientOpen(const WebSocketProtocolPtr &protocol) {
+        _client = protocol;
+        start();
+    }
+
+    void start() {
+        if (!_server || !_client) {
+            return;
+        }
+        _phases = {
+                {"server to client 16B", _server, 16},
+                {"server to client 100B", _server, 100},
+                {"server to client 1KiB", _server, 1024},
+                {"client to server 16B", _client, 16},
+                {"client to server 100B", _client, 100},
+                {"client to server 1KiB", _client, 1024},
+        };
+        startPhase();
+    }
+
+    void startPhase() {
+        auto &phase = _phases[_phase];
+        _payload.assign(phase.size, 'x');
+        _sent = 0;
+        _received = 0;
+        _allocations = 0;
+        _sendTime = Duration::zero();
+        _start = TimestampClock::now();
+        sendBatch();
+    }
+
+    void sendBatch() {
+        auto &phase = _phases[_phase];
+        size_t allocations = gAllocations;
+        auto start = TimestampClock::now();
+        for (size_t i = 0; i != BATCH; ++i) {
+            phase.sender->sendMessage(_payload, true);
+        }
+        _sendTime += TimestampClock::now() - start;
+        _allocations += gAllocations - allocations;
+        _sent += BATCH;
+    }
+
+    void onReceived(const ByteArray &payload) {
+        _ok = _ok && payload.size() == _payload.size();
+        if (++_received != _sent) {
+            return;
+        }
+        if (_sent < ROUNDS) {
+            // Each batch fits the socket buffers, so it measures the send path rather than queueing
+            reactor()->addCallback([this]() {
+                sendBatch();
+            });
+            return;
+        }
+        auto &phase = _phases[_phase];
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(TimestampClock::now() - _start);
+        auto sendTime = std::chrono::duration_cast<std::chrono::microseconds>(_sendTime);
+        std::cout << phase.name << ": " << (_ok ? "OK" : "FAILED") << ", "
+                  << (double)ROUNDS * 1000000.0 / (double)sendTime.count() << " sends/s, "
+                  << (double)_allocations / (double)ROUNDS << " allocs/send, "
+                  << (double)ROUNDS * 1000000.0 / (double)elapsed.count() << " msgs/s delivered" << std::endl;
+        if (++_phase == _phases.size()) {
+            reactor()->stop();
+        } else {
+            reactor()->addCallback([this]() {
+                startPhase();
+            });
+        }
+    }
+
+    static constexpr size_t ROUNDS = 200000;
+    static constexpr size_t BATCH = 500;
+protected:
+    struct Phase {
+        const char *name;
+        WebSocketProtocolPtr sender;
+        size_t size;
+    };
+
+    std::shared_ptr<SendTestClientFactory> _clientFactory;
+    WebSocketProtocolPtr _server;
+    WebSocketProtocolPtr _client;
+    std::vector<Phase> _phases;
+    size_t _phase{0};
+    ByteArray _payload;
+    size_t _sent{0};
+    size_t _received{0};
+    size_t _allocations{0};
+    bool _ok{true};
+    Duration _sendTime;
+    Timestamp _start;
+};
+
+
+void SendTestServerProtocol::onOpen() {
+    getFactory<SendTestServerFactory>()->getTest()->onServerOpen(shared_from_this());
+}
+
+void SendTestServerProtocol::onMessage(ByteArray payload, bool isBinary) {
+    getFactory<SendTestServerFactory>()->getTest()->onReceived(payload);
+}
+
+
+void SendTestClientProtocol::onOpen() {
+    getFactory<SendTestClientFactory>()->getTest()->onClientOpen(shared_from_this());
+}
+
+void SendTestClientProtocol::onMessage(ByteArray payload, bool isBinary) {
+    getFactory<SendTestClientFactory>()->getTest()->onReceived(payload);
+}
+
+
+int main(int argc, char **argv) {
+    SendTest app;
+    app.run(argc, argv);
+    return 0;
+}
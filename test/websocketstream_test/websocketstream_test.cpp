@@ -0,0 +1,293 @@
+//
+// Created by yuwenyong.vincent on 2019-03-23.
+//
+
+#include "net4cxx/net4cxx.h"
+
+using namespace net4cxx;
+
+
+class StreamTest;
+
+
+static Byte makeByte(uint64_t pos) {
+    return (Byte)(pos * 31u + (pos >> 10u));
+}
+
+
+class StreamTestServerProtocol: public WebSocketServerProtocol {
+public:
+    void onMessage(ByteArray payload, bool isBinary) override;
+};
+
+
+class StreamTestServerFactory: public WebSocketServerFactory {
+public:
+    StreamTestServerFactory(std::string url, StreamTest *test)
+            : WebSocketServerFactory(std::move(url))
+            , _test(test) {
+
+    }
+
+    ProtocolPtr buildProtocol(const Address &address) override {
+        return std::make_shared<StreamTestServerProtocol>();
+    }
+
+    StreamTest* getTest() {
+        return _test;
+    }
+protected:
+    StreamTest *_test;
+};
+
+
+class StreamTestClientProtocol: public WebSocketClientProtocol {
+public:
+    StreamTestClientProtocol(std::string name, bool streaming)
+            : _name(std::move(name))
+            , _streaming(streaming) {
+
+    }
+
+    void onOpen() override {
+        sendMessage(_name);
+    }
+
+    void onMessage(ByteArray payload, bool isBinary) override;
+
+    void onMessageBegin(bool isBinary) override {
+        if (_streaming) {
+            // Only the binary message is streamed, the text one following it is ignored
+            _inBinary = isBinary;
+            if (isBinary) {
+                _received = 0;
+                _ok = true;
+            }
+        } else {
+            WebSocketClientProtocol::onMessageBegin(isBinary);
+        }
+    }
+
+    void onMessageFrameData(const Byte *payload, size_t length) override {
+        if (_streaming) {
+            if (!_inBinary) {
+                return;
+            }
+            for (size_t i = 0; i != length; ++i) {
+                _ok = _ok && payload[i] == makeByte(_received + i);
+            }
+            _received += length;
+            _maxChunk = std::max(_maxChunk, length);
+        } else {
+            WebSocketClientProtocol::onMessageFrameData(payload, length);
+        }
+    }
+
+    void onMessageEnd() override;
+
+    const std::string& getName() const {
+        return _name;
+    }
+
+    uint64_t getReceived() const {
+        return _received;
+    }
+
+    bool isOk() const {
+        return _ok;
+    }
+
+    size_t getMaxChunk() const {
+        return _maxChunk;
+    }
+protected:
+    std::string _name;
+    bool _streaming;
+    bool _inBinary{false};
+    uint64_t _received{0};
+    bool _ok{false};
+    size_t _maxChunk{0};
+};
+
+
+class StreamTestClientFactory: public WebSocketClientFactory {
+public:
+    StreamTestClientFactory(std::string url, StreamTest *test, std::string name, bool streaming)
+            : WebSocketClientFactory(std::move(url))
+            , _test(test)
+            , _name(std::move(name))
+            , _streaming(streaming) {
+
+    }
+
+    ProtocolPtr buildProtocol(const Address &address) override {
+        _client = std::make_shared<StreamTestClientProtocol>(_name, _streaming);
+        return _client;
+    }
+
+    StreamTest* getTest() {
+        return _test;
+    }
+
+    const std::shared_ptr<StreamTestClientProtocol>& getClient() const {
+        return _client;
+    }
+
+    void reset() {
+        _client.reset();
+    }
+protected:
+    StreamTest *_test;
+    std::string _name;
+    bool _streaming;
+    std::shared_ptr<StreamTestClientProtocol> _client;
+};
+
+
+class StreamTest: public Bootstrapper {
+public:
+    using Bootstrapper::Bootstrapper;
+
+    void onRun() override {
+        auto serverFactory = std::make_shared<StreamTestServerFactory>("ws://127.0.0.1:9101", this);
+        serverFactory->setPerMessageCompressionAccept([](std::vector<PerMessageCompressOfferPtr> offers) {
+            PerMessageCompressOfferAcceptPtr accept;
+            for (auto &offer: offers) {
+                if (std::dynamic_pointer_cast<PerMessageDeflateOffer>(offer)) {
+                    accept = std::make_shared<PerMessageDeflateOfferAccept>(offer);
+                    break;
+                }
+            }
+            return accept;
+        });
+        listenWS(reactor(), serverFactory);
+
+        _clients.emplace_back(std::make_shared<StreamTestClientFactory>("ws://127.0.0.1:9101", this, "streamed",
+                                                                        true));
+        auto deflate = std::make_shared<StreamTestClientFactory>("ws://127.0.0.1:9101", this, "streamed deflate",
+                                                                 true);
+        deflate->setPerMessageCompressionOffers({std::make_shared<PerMessageDeflateOffer>()});
+        deflate->setPerMessageCompressionAccept([](PerMessageCompressResponsePtr response) {
+            return std::make_shared<PerMessageDeflateResponseAccept>(std::move(response));
+        });
+        _clients.emplace_back(std::move(deflate));
+        _clients.emplace_back(std::make_shared<StreamTestClientFactory>("ws://127.0.0.1:9101", this, "assembled",
+                                                                        false));
+        _start = TimestampClock::now();
+        for (auto &client: _clients) {
+            connectWS(reactor(), client);
+        }
+    }
+
+    void onQuit() override {
+        // Connections must go before the reactor owning their sockets
+        _servers.clear();
+        for (auto &client: _clients) {
+            client->reset();
+        }
+        _clients.clear();
+    }
+
+    void onServerMessage(const WebSocketServerProtocolPtr &protocol, const std::string &name) {
+        _servers.emplace_back(protocol);
+        uint64_t size = name == "assembled" ? SMALL_MESSAGE_SIZE : LARGE_MESSAGE_SIZE;
+        auto position = std::make_shared<uint64_t>(0);
+        auto writer = std::make_shared<WebSocketMessageWriter>(protocol, [this, p=protocol.get(), position, size](
+                Byte *buffer, size_t length) {
+            length = (size_t)std::min<uint64_t>(length, size - *position);
+            for (size_t i = 0; i != length; ++i) {
+                buffer[i] = makeByte(*position + i);
+            }
+            *position += length;
+            _maxPending = std::max(_maxPending, p->getPendingWriteSize());
+            return length;
+        }, true);
+        writer->start()->addCallbacks([this, protocol](DeferredValue value) {
+            try {
+                protocol->sendMessage("interleaved");
+            } catch (std::exception &) {
+                ++_rejectedWhileStreaming;
+            }
+            return value;
+        }, [](DeferredValue value) {
+            std::cout << "writer failed" << std::endl;
+            return DeferredValue(nullptr);
+        });
+        // The writer owns the message until its last fragment is queued
+        try {
+            if (!writer->finished()) {
+                protocol->sendMessage("interleaved");
+            }
+        } catch (std::exception &) {
+            ++_rejectedWhileStreaming;
+        }
+    }
+
+    void onClientDone(StreamTestClientProtocol *client) {
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(TimestampClock::now() - _start);
+        uint64_t size = client->getName() == "assembled" ? SMALL_MESSAGE_SIZE : LARGE_MESSAGE_SIZE;
+        bool ok = client->isOk() && client->getReceived() == size;
+        std::cout << client->getName() << ": " << (ok ? "OK" : "FAILED") << ", " << client->getReceived()
+                  << " bytes, " << (double)client->getReceived() / (double)elapsed.count() << "MB/s";
+        if (client->getMaxChunk()) {
+            std::cout << ", largest piece " << client->getMaxChunk() << " bytes";
+        }
+        std::cout << std::endl;
+        if (++_done == _clients.size()) {
+            std::cout << "largest pending write: " << _maxPending << " bytes" << std::endl;
+            std::cout << "sends rejected while streaming: "
+                      << (_rejectedWhileStreaming == _clients.size() ? "OK" : "FAILED") << std::endl;
+            reactor()->stop();
+        }
+    }
+
+    static constexpr uint64_t LARGE_MESSAGE_SIZE = 64 * 1024 * 1024;
+    static constexpr uint64_t SMALL_MESSAGE_SIZE = 1024 * 1024;
+protected:
+    std::vector<std::shared_ptr<StreamTestClientFactory>> _clients;
+    std::vector<WebSocketServerProtocolPtr> _servers;
+    size_t _maxPending{0};
+    size_t _rejectedWhileStreaming{0};
+    size_t _done{0};
+    Timestamp _start;
+};
+
+
+void StreamTestServerProtocol::onMessage(ByteArray payload, bool isBinary) {
+    getFactory<StreamTestServerFactory>()->getTest()->onServerMessage(getSelf<StreamTestServerProtocol>(),
+                                                                      TypeCast<std::string>(payload));
+}
+
+
+void StreamTestClientProtocol::onMessage(ByteArray payload, bool isBinary) {
+    if (TypeCast<std::string>(payload) == "interleaved") {
+        return;
+    }
+    _ok = isBinary;
+    for (size_t i = 0; i != payload.size(); ++i) {
+        _ok = _ok && payload[i] == makeByte(i);
+    }
+    _received = payload.size();
+}
+
+
+void StreamTestClientProtocol::onMessageEnd() {
+    if (_streaming) {
+        if (_inBinary) {
+            getFactory<StreamTestClientFactory>()->getTest()->onClientDone(this);
+        }
+    } else {
+        WebSocketClientProtocol::onMessageEnd();
+        if (_received) {
+            getFactory<StreamTestClientFactory>()->getTest()->onClientDone(this);
+            _received = 0;
+        }
+    }
+}
+
+
+int main(int argc, char **argv) {
+    StreamTest app;
+    app.run(argc, argv);
+    return 0;
+}
@@ -0,0 +1,104 @@
+//
+// Created by yuwenyong.vincent on 2019-03-20.
+//
+
+#include "net4cxx/net4cxx.h"
+
+using namespace net4cxx;
+
+
+class XorMaskerTest: public Bootstrapper {
+public:
+    using Bootstrapper::Bootstrapper;
+
+    void onRun() override {
+        std::vector<XorMaskerWide::Kernel> kernels{XorMaskerWide::PORTABLE};
+        if (XorMaskerWide::bestKernel() >= XorMaskerWide::SSE2) {
+            kernels.emplace_back(XorMaskerWide::SSE2);
+        }
+        if (XorMaskerWide::bestKernel() >= XorMaskerWide::AVX2) {
+            kernels.emplace_back(XorMaskerWide::AVX2);
+        }
+        for (auto kernel: kernels) {
+            std::cout << "fuzz " << kernelName(kernel) << ": " << (fuzz(kernel, 20000) ? "OK" : "FAILED")
+                      << std::endl;
+        }
+
+        ByteArray payload(1024 * 1024);
+        fill(payload);
+        WebSocketMask mask;
+        Random::randBytes(mask);
+        const size_t rounds = 200;
+        benchmark("simple", payload, rounds, [&mask]() {
+            return std::unique_ptr<XorMasker>(new XorMaskerSimple(mask));
+        });
+        benchmark("shifted1", payload, rounds, [&mask]() {
+            return std::unique_ptr<XorMasker>(new XorMaskerShifted1(mask));
+        });
+        for (auto kernel: kernels) {
+            benchmark(kernelName(kernel), payload, rounds, [&mask, kernel]() {
+                return std::unique_ptr<XorMasker>(new XorMaskerWide(mask, kernel));
+            });
+        }
+    }
+
+    static const char* kernelName(XorMaskerWide::Kernel kernel) {
+        switch (kernel) {
+            case XorMaskerWide::AVX2:
+                return "wide avx2";
+            case XorMaskerWide::SSE2:
+                return "wide sse2";
+            default:
+                return "wide portable";
+        }
+    }
+
+    static void fill(ByteArray &data) {
+        for (auto &c: data) {
+            c = (Byte)Random::randRange(256);
+        }
+    }
+
+    // Masks random payloads in random pieces, so the wide kernels start at every phase and alignment
+    static bool fuzz(XorMaskerWide::Kernel kernel, size_t rounds) {
+        for (size_t i = 0; i != rounds; ++i) {
+            WebSocketMask mask;
+            Random::randBytes(mask);
+            ByteArray expected((size_t)Random::randRange(0, 600) + 8);
+            fill(expected);
+            ByteArray result(expected);
+            size_t offset = (size_t)Random::randRange(0, 8);
+            XorMaskerSimple simple(mask);
+            simple.process(expected.data() + offset, expected.size() - offset);
+            XorMaskerWide wide(mask, kernel);
+            size_t pos = offset;
+            while (pos < result.size()) {
+                size_t len = std::min((size_t)Random::randRange(0, 80), result.size() - pos);
+                wide.process(result.data() + pos, len);
+                pos += len;
+            }
+            if (result != expected || wide.pointer() != simple.pointer()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    template <typename FactoryT>
+    static void benchmark(const char *name, ByteArray payload, size_t rounds, FactoryT &&factory) {
+        auto start = TimestampClock::now();
+        for (size_t i = 0; i != rounds; ++i) {
+            factory()->process(payload.data(), payload.size());
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(TimestampClock::now() - start);
+        std::cout << name << ": " << (double)(payload.size() * rounds) / (double)elapsed.count() << "MB/s"
+                  << std::endl;
+    }
+};
+
+
+int main(int argc, char **argv) {
+    XorMaskerTest app{false};
+    app.run(argc, argv);
+    return 0;
+}